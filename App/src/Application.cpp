@@ -1,12 +1,29 @@
 #include "Application.hpp"
+#include "BvhBenchmark.hpp"
+#include "Hash.hpp"
+#include "ImageWriter.hpp"
+#include "JobBenchmark.hpp"
+#include "JobSystem.hpp"
+#include "LogBenchmark.hpp"
 #include "Logger.hpp"
-#include "SimpleMeshParser.hpp"
+#include "MathBatch.hpp"
+#include "MathBenchmark.hpp"
+#include "MeshCache.hpp"
+#include "ParserBenchmark.hpp"
+#include "Profiler.hpp"
+#include "SceneBenchmark.hpp"
 #include "Uniforms.hpp"
 
 #define SDL_MAIN_HANDLED
 #include <sdl2webgpu.h>
 #include <SDL2/SDL.h>
 
+#include <algorithm>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <thread>
 #include <vector>
 
 namespace atcp {
@@ -24,6 +41,30 @@ void wgpuPollEvents([[maybe_unused]] wgpu::Device device, [[maybe_unused]] bool
 #endif
 }
 
+bool ParsePresentMode(const char* name, wgpu::PresentMode& mode)
+{
+	if (std::strcmp(name, "fifo") == 0)
+		mode = wgpu::PresentMode::Fifo;
+	else if (std::strcmp(name, "mailbox") == 0)
+		mode = wgpu::PresentMode::Mailbox;
+	else if (std::strcmp(name, "immediate") == 0)
+		mode = wgpu::PresentMode::Immediate;
+	else
+		return false;
+	return true;
+}
+
+const char* PresentModeName(wgpu::PresentMode mode)
+{
+	switch (mode)
+	{
+	case wgpu::PresentMode::Fifo: return "fifo";
+	case wgpu::PresentMode::Mailbox: return "mailbox";
+	case wgpu::PresentMode::Immediate: return "immediate";
+	default: return "unknown";
+	}
+}
+
 /**
  * Round 'value' up to the next multiplier of 'step'.
  */
@@ -38,20 +79,156 @@ Application::Application()
 
 Application::~Application()
 {
-	m_Pipeline.release();
-	m_Adapter.release();
-	m_Surface.release();
-	m_Device.release();
-	m_Queue.release();
-	m_Instance.release();
-	m_VertexBuffer.release();
+	m_Simulation.Shutdown();
+	InvalidateRenderBundles();
+	m_UniformRing.Release();
+	JobSystem::Wait(m_PipelineJobs);
+	m_Assets.Release();
+	m_Uploads.Release();
+	m_PipelineCache.Clear();
+	// Everything still alive or waiting on a frame, before the device goes
+	m_Resources.Release();
+	// Which of these exist depends on the mode and how far Init got
+	if (m_OffscreenTexture)
+		m_OffscreenTexture.release();
+	if (m_Adapter)
+		m_Adapter.release();
+	if (m_Surface)
+		m_Surface.release();
+	if (m_Device)
+		m_Device.release();
+	if (m_Queue)
+		m_Queue.release();
+	if (m_Instance)
+		m_Instance.release();
+	if (m_Window)
+		SDL_DestroyWindow(m_Window);
 	SDL_Quit();
 }
 
-int Application::Init(int, char* argv[])
+int Application::Init(int argc, char* argv[])
 {
+	PROFILE_FUNCTION();
+
+	m_StartTime = GetTime();
+	for (int i = 1; i < argc; ++i)
+	{
+		if (std::strcmp(argv[i], "--benchmark") == 0)
+		{
+			m_Benchmark = true;
+			m_Headless = true;
+		}
+		else if (std::strcmp(argv[i], "--job-benchmark") == 0)
+		{
+			m_JobBenchmark = true;
+		}
+		else if (std::strcmp(argv[i], "--scene-benchmark") == 0)
+		{
+			m_SceneBenchmark = true;
+		}
+		else if (std::strcmp(argv[i], "--math-benchmark") == 0)
+		{
+			m_MathBenchmark = true;
+		}
+		else if (std::strcmp(argv[i], "--bvh-benchmark") == 0)
+		{
+			m_BvhBenchmark = true;
+		}
+		else if (std::strcmp(argv[i], "--parser-benchmark") == 0)
+		{
+			m_ParserBenchmark = true;
+		}
+		else if (std::strcmp(argv[i], "--parser-check") == 0)
+		{
+			m_ParserCheck = true;
+		}
+		else if (std::strcmp(argv[i], "--log-benchmark") == 0)
+		{
+			m_LogBenchmark = true;
+		}
+		else if (std::strcmp(argv[i], "--no-bundles") == 0)
+		{
+			m_UseRenderBundles = false;
+		}
+		else if (std::strcmp(argv[i], "--no-culling") == 0)
+		{
+			m_Culling = false;
+		}
+		else if (std::strcmp(argv[i], "--headless") == 0)
+		{
+			m_Headless = true;
+		}
+		else if (std::strcmp(argv[i], "--fallback-adapter") == 0)
+		{
+			m_FallbackAdapter = true;
+		}
+		else if (std::strcmp(argv[i], "--pipelined") == 0)
+		{
+			m_PipelinedSimulation = true;
+		}
+		else if (std::strcmp(argv[i], "--tick-rate") == 0 && i + 1 < argc)
+		{
+			const double tickRate = std::strtod(argv[++i], nullptr);
+			if (tickRate <= 0.0)
+			{
+				LOG_ERROR("Invalid tick rate {0}, expected updates per second", argv[i]);
+				return 1;
+			}
+			m_FixedUpdateInterval = static_cast<float>(1.0 / tickRate);
+		}
+		else if (std::strcmp(argv[i], "--present-mode") == 0 && i + 1 < argc)
+		{
+			if (!ParsePresentMode(argv[++i], m_PresentMode))
+			{
+				LOG_ERROR("Invalid present mode {0}, expected fifo, mailbox or immediate", argv[i]);
+				return 1;
+			}
+		}
+		else if (std::strcmp(argv[i], "--fps-limit") == 0 && i + 1 < argc)
+		{
+			m_FrameLimiter.SetTargetRate(std::strtod(argv[++i], nullptr));
+		}
+		else if (std::strcmp(argv[i], "--upload-budget") == 0 && i + 1 < argc)
+		{
+			// Kilobytes per frame, 0 uploads everything as soon as it has loaded
+			m_UploadBudget = std::strtoull(argv[++i], nullptr, 10) * 1024;
+		}
+		else if (std::strcmp(argv[i], "--hash") == 0)
+		{
+			m_HashCapture = true;
+		}
+		else if (std::strcmp(argv[i], "--frames") == 0 && i + 1 < argc)
+		{
+			m_HeadlessFrames = static_cast<uint32_t>(std::max(1l, std::strtol(argv[++i], nullptr, 10)));
+		}
+		else if (std::strcmp(argv[i], "--capture") == 0 && i + 1 < argc)
+		{
+			m_CapturePath = argv[++i];
+		}
+		else if (std::strcmp(argv[i], "--size") == 0 && i + 1 < argc)
+		{
+			unsigned width = 0, height = 0;
+			if (std::sscanf(argv[++i], "%ux%u", &width, &height) != 2 || width == 0 || height == 0)
+			{
+				LOG_ERROR("Invalid size {0}, expected WIDTHxHEIGHT", argv[i]);
+				return 1;
+			}
+			m_Width = width;
+			m_Height = height;
+		}
+		else
+		{
+			LOG_WARN("Unknown argument {0}", argv[i]);
+		}
+	}
+
 	m_WorkingDirectory = std::filesystem::weakly_canonical(std::filesystem::path(argv[0])).parent_path();
 	std::filesystem::current_path(m_WorkingDirectory);
+
+	LOG_DEBUG("Batch math uses {0} kernels", MathBatch::GetLevelName(MathBatch::GetLevel()));
+	// Only exercises the CPU, nothing else needs to be created
+	if (m_JobBenchmark || m_SceneBenchmark || m_MathBenchmark || m_BvhBenchmark || m_ParserBenchmark || m_ParserCheck || m_LogBenchmark)
+		return 0;
 	m_Instance = wgpu::createInstance(wgpu::InstanceDescriptor{});
 
 	if (!m_Instance)
@@ -61,7 +238,8 @@ int Application::Init(int, char* argv[])
 	}
 
 	SDL_SetMainReady();
-	if (SDL_Init(SDL_INIT_VIDEO) < 0) {
+	// Build agents have no display, headless runs only use SDL's timer which needs no initialization
+	if (!m_Headless && SDL_Init(SDL_INIT_VIDEO) < 0) {
 		LOG_ERROR("Could not initialize SDL! Error: {0}", SDL_GetError());
 		return 1;
 	}
@@ -70,18 +248,26 @@ int Application::Init(int, char* argv[])
 
 	SDL_SetHint(SDL_HINT_IME_SHOW_UI, "1");
 
-	int windowFlags = 0;
-	int windowWidth = 640;
-	int windowHeight = 480;
-	SDL_Window* window = SDL_CreateWindow("Atterop", SDL_WINDOWPOS_UNDEFINED, SDL_WINDOWPOS_UNDEFINED, windowWidth, windowHeight, windowFlags);
+	if (!m_Headless)
+	{
+		int windowFlags = SDL_WINDOW_RESIZABLE;
+		m_Window = SDL_CreateWindow("Atterop", SDL_WINDOWPOS_UNDEFINED, SDL_WINDOWPOS_UNDEFINED, m_Width, m_Height, windowFlags);
 
-	m_Surface = SDL_GetWGPUSurface(m_Instance, window);
+		m_Surface = SDL_GetWGPUSurface(m_Instance, m_Window);
+	}
 
 	LOG_TRACE("Requesting adapter...");
 	wgpu::RequestAdapterOptions adapterOpts{};
 	adapterOpts.compatibleSurface = m_Surface;
+	// Software implementation such as a CPU Vulkan driver, for machines without a GPU
+	adapterOpts.forceFallbackAdapter = m_FallbackAdapter;
 
 	m_Adapter = m_Instance.requestAdapter(adapterOpts);
+	if (!m_Adapter)
+	{
+		LOG_CRITICAL("Could not find a {0}WebGPU adapter!", m_FallbackAdapter ? "fallback " : "");
+		return 1;
+	}
 
 	wgpu::AdapterProperties properties = {};
 	m_Adapter.getProperties(&properties);
@@ -110,154 +296,84 @@ int Application::Init(int, char* argv[])
 		{
 			LOG_ERROR("Uncaptured device error: type {0}", (int)type);
 			if (message)
-				LOG_ERROR(message);
+				LOG_ERROR("{0}", message);
 		};
 
 	m_ErrorCallbackHandle = m_Device.setUncapturedErrorCallback(std::move(onDeviceError));
 	m_Queue = m_Device.getQueue();
 
-	wgpu::SurfaceConfiguration surfaceConfig = {};
-
-	surfaceConfig.width = windowWidth;
-	surfaceConfig.height = windowHeight;
-	surfaceConfig.usage = wgpu::TextureUsage::RenderAttachment;
-	wgpu::TextureFormat surfaceFormat = m_Surface.getPreferredFormat(m_Adapter);
-	surfaceConfig.format = surfaceFormat;
-
-	surfaceConfig.viewFormatCount = 0;
-	surfaceConfig.viewFormats = nullptr;
-	surfaceConfig.device = m_Device;
-	surfaceConfig.presentMode = wgpu::PresentMode::Fifo;
-	surfaceConfig.alphaMode = wgpu::CompositeAlphaMode::Auto;
-
-	m_Surface.configure(surfaceConfig);
-
-	wgpu::ShaderModuleDescriptor shaderDesc;
+	if (m_Headless)
+	{
+		m_SurfaceFormat = wgpu::TextureFormat::BGRA8Unorm;
+
+		wgpu::TextureDescriptor textureDesc;
+		textureDesc.label = "Offscreen Target";
+		textureDesc.usage = wgpu::TextureUsage::RenderAttachment | wgpu::TextureUsage::CopySrc;
+		textureDesc.dimension = wgpu::TextureDimension::_2D;
+		textureDesc.size = { m_Width, m_Height, 1 };
+		textureDesc.format = m_SurfaceFormat;
+		textureDesc.mipLevelCount = 1;
+		textureDesc.sampleCount = 1;
+		textureDesc.viewFormatCount = 0;
+		textureDesc.viewFormats = nullptr;
+		m_OffscreenTexture = m_Device.createTexture(textureDesc);
+	}
+	else
+	{
+		m_SurfaceFormat = m_Surface.getPreferredFormat(m_Adapter);
 
-#ifdef WEBGPU_BACKEND_WGPU
-	shaderDesc.hintCount = 0;
-	shaderDesc.hints = nullptr;
-#endif
+		wgpu::SurfaceCapabilities capabilities;
+		m_Surface.getCapabilities(m_Adapter, &capabilities);
+		const wgpu::PresentMode* supportedModes = capabilities.presentModes;
+		if (std::find(supportedModes, supportedModes + capabilities.presentModeCount, m_PresentMode) == supportedModes + capabilities.presentModeCount)
+		{
+			// Fifo is the only mode every surface has to support
+			LOG_WARN("Present mode {0} is not supported, using fifo", PresentModeName(m_PresentMode));
+			m_PresentMode = wgpu::PresentMode::Fifo;
+		}
+		capabilities.freeMembers();
 
-	wgpu::ShaderModuleWGSLDescriptor shaderCodeDesc;
-	shaderCodeDesc.chain.next = nullptr;
-	shaderCodeDesc.chain.sType = wgpu::SType::ShaderModuleWGSLDescriptor;
-	shaderDesc.nextInChain = &shaderCodeDesc.chain;
-
-	wgpu::ShaderModule shaderModule = LoadShaderModule(m_WorkingDirectory / "resources" / "shader.wgsl");
-
-	wgpu::RenderPipelineDescriptor pipelineDesc;
-
-	wgpu::VertexBufferLayout vertexBufferLayout;
-	std::vector<wgpu::VertexAttribute> vertexAttribs(2);
-	wgpu::VertexAttribute& positionAttrib = vertexAttribs[0];
-	positionAttrib.shaderLocation = 0;
-	positionAttrib.format = wgpu::VertexFormat::Float32x2;
-	positionAttrib.offset = 0;
-
-	wgpu::VertexAttribute& colorAttrib = vertexAttribs[1];
-	colorAttrib.shaderLocation = 1;
-	colorAttrib.format = wgpu::VertexFormat::Float32x3;
-	colorAttrib.offset = 2 * sizeof(float);
-
-	vertexBufferLayout.attributeCount = static_cast<uint32_t>(vertexAttribs.size());
-	vertexBufferLayout.attributes = vertexAttribs.data();
-	vertexBufferLayout.arrayStride = 5 * sizeof(float);
-	vertexBufferLayout.stepMode = wgpu::VertexStepMode::Vertex;
-
-	pipelineDesc.vertex.bufferCount = 1;
-	pipelineDesc.vertex.buffers = &vertexBufferLayout;
-	pipelineDesc.vertex.module = shaderModule;
-	pipelineDesc.vertex.entryPoint = "vs_main";
-	pipelineDesc.vertex.constantCount = 0;
-	pipelineDesc.vertex.constants = nullptr;
-
-	pipelineDesc.primitive.topology = wgpu::PrimitiveTopology::TriangleList;
-	pipelineDesc.primitive.stripIndexFormat = wgpu::IndexFormat::Undefined;
-	pipelineDesc.primitive.frontFace = wgpu::FrontFace::CCW;
-	pipelineDesc.primitive.cullMode = wgpu::CullMode::None;
-
-	wgpu::FragmentState fragmentState;
-	fragmentState.module = shaderModule;
-	fragmentState.entryPoint = "fs_main";
-	fragmentState.constantCount = 0;
-	fragmentState.constants = nullptr;
-
-	pipelineDesc.fragment = &fragmentState;
-
-	pipelineDesc.depthStencil = nullptr;
-
-	wgpu::BlendState blendState;
-	blendState.color.srcFactor = wgpu::BlendFactor::SrcAlpha;
-	blendState.color.dstFactor = wgpu::BlendFactor::OneMinusSrcAlpha;
-	blendState.color.operation = wgpu::BlendOperation::Add;
-
-	wgpu::ColorTargetState colorTarget;
-	colorTarget.format = surfaceFormat;
-	colorTarget.blend = &blendState;
-	colorTarget.writeMask = wgpu::ColorWriteMask::All;
-
-	fragmentState.targetCount = 1;
-	fragmentState.targets = &colorTarget;
-
-	pipelineDesc.multisample.count = 1;
-	pipelineDesc.multisample.mask = ~0u;
-	pipelineDesc.multisample.alphaToCoverageEnabled = false;
-
-	wgpu::BindGroupLayoutEntry bindingLayout = wgpu::Default;
-	bindingLayout.binding = 0;
-	bindingLayout.visibility = wgpu::ShaderStage::Vertex | wgpu::ShaderStage::Fragment;
-	bindingLayout.buffer.type = wgpu::BufferBindingType::Uniform;
-	bindingLayout.buffer.minBindingSize = sizeof(MyUniform);
-	bindingLayout.buffer.hasDynamicOffset = true;
-
-	wgpu::BindGroupLayoutDescriptor bindGroupLayoutDesc{};
-	bindGroupLayoutDesc.entryCount = 1;
-	bindGroupLayoutDesc.entries = &bindingLayout;
-	wgpu::BindGroupLayout bindGroupLayout = m_Device.createBindGroupLayout(bindGroupLayoutDesc);
-
-	wgpu::PipelineLayoutDescriptor layoutDesc{};
-	layoutDesc.bindGroupLayoutCount = 1;
-	layoutDesc.bindGroupLayouts = (WGPUBindGroupLayout*)&bindGroupLayout;
-	wgpu::PipelineLayout layout = m_Device.createPipelineLayout(layoutDesc);
-
-	pipelineDesc.layout = layout;
-
-	m_Pipeline = m_Device.createRenderPipeline(pipelineDesc);
-
-	uint32_t uniformStride = ceilToNextMultiple(
-		(uint32_t)sizeof(MyUniform),
-		(uint32_t)m_DeviceLimits.minUniformBufferOffsetAlignment
-	);
+		ConfigureSurface();
+		LOG_DEBUG("Presenting with {0}", PresentModeName(m_PresentMode));
+	}
 
-	wgpu::BufferDescriptor bufferDesc;
-	bufferDesc.label = "Uniform Buffer";
-	bufferDesc.usage = wgpu::BufferUsage::CopyDst | wgpu::BufferUsage::Uniform;
-	bufferDesc.size = uniformStride + sizeof(MyUniform);
-	bufferDesc.mappedAtCreation = false;
-	m_UniformBuffer = m_Device.createBuffer(bufferDesc);
+	m_Resources.Init(m_Device, m_Queue);
+	m_PipelineCache.Init(m_Device, m_Resources);
+	if (!m_Uploads.Init(m_Device, m_Queue, StagingBlockSize, MaxStagingBlocks))
+		return 1;
+	m_Assets.Init(m_Resources, m_Uploads, m_PipelineCache, m_DeviceLimits.maxBufferSize, m_UploadBudget);
+	LoadAssets();
 
-	MyUniform uniforms;
-	uniforms.time = 1.0f;
-	uniforms.colour = { 0.4f, 0.0f, 1.0f, 1.0f };
-	m_Queue.writeBuffer(m_UniformBuffer, 0, &uniforms, sizeof(MyUniform));
+	std::array<wgpu::BindGroupLayoutEntry, 2> bindingLayouts = { wgpu::Default, wgpu::Default };
+	bindingLayouts[0].binding = 0;
+	bindingLayouts[0].visibility = wgpu::ShaderStage::Vertex | wgpu::ShaderStage::Fragment;
+	bindingLayouts[0].buffer.type = wgpu::BufferBindingType::Uniform;
+	bindingLayouts[0].buffer.minBindingSize = sizeof(MyUniform);
+	bindingLayouts[0].buffer.hasDynamicOffset = true;
 
-	uniforms.time = -1.0f;
-	uniforms.colour = { 0.0f, 1.0f, 0.4f, 1.0f };
-	m_Queue.writeBuffer(m_UniformBuffer, uniformStride, &uniforms, sizeof(MyUniform));
+	bindingLayouts[1].binding = 1;
+	bindingLayouts[1].visibility = wgpu::ShaderStage::Vertex;
+	bindingLayouts[1].buffer.type = wgpu::BufferBindingType::ReadOnlyStorage;
+	bindingLayouts[1].buffer.minBindingSize = sizeof(InstanceData);
+	bindingLayouts[1].buffer.hasDynamicOffset = false;
 
+	m_BindGroupLayout = m_PipelineCache.GetBindGroupLayout(bindingLayouts.data(), bindingLayouts.size());
 
-	wgpu::BindGroupEntry binding{};
-	binding.binding = 0;
-	binding.buffer = m_UniformBuffer;
-	binding.offset = 0;
-	binding.size = sizeof(MyUniform);
+	if (!m_UniformRing.Init(m_Device, m_Queue, FramesInFlight, UniformSlotsPerFrame, sizeof(MyUniform), m_DeviceLimits.minUniformBufferOffsetAlignment))
+		return 1;
 
-	wgpu::BindGroupDescriptor bindGroupDesc{};
-	bindGroupDesc.layout = bindGroupLayout;
-	bindGroupDesc.entryCount = bindGroupLayoutDesc.entryCount;
-	bindGroupDesc.entries = &binding;
-	m_BindGroup = m_Device.createBindGroup(bindGroupDesc);
+	// The two quads that orbit in opposite directions, the scene is empty so both land in one chunk
+	m_Scene.Create<Transform, Colour, MeshRef, Animation>(2, [this](uint32_t, uint32_t, Transform* transforms,
+		Colour* colours, MeshRef* meshes, Animation* animations) {
+		transforms[0] = { { 0.0f, 0.0f }, 1.0f };
+		transforms[1] = { { 0.0f, 0.0f }, 1.0f };
+		colours[0] = { { 0.4f, 0.0f, 1.0f, 1.0f } };
+		colours[1] = { { 0.0f, 1.0f, 0.4f, 1.0f } };
+		meshes[0] = { m_MeshAsset };
+		meshes[1] = { m_MeshAsset };
+		animations[0] = { 1.0f, 0.0f };
+		animations[1] = { -1.0f, -1.0f };
+	});
 
 	wgpu::CommandEncoder encoder = m_Device.createCommandEncoder(wgpu::Default);
 
@@ -266,12 +382,12 @@ int Application::Init(int, char* argv[])
 	m_Queue.submit(1, &command);
 	command.release();
 
-	InitializeBuffers();
+	CreatePlaceholderMesh();
 
 	return 0;
 }
 
-void Application::Run()
+int Application::Run()
 {
 	if (m_Running) {
 		LOG_ERROR("Application is already running");
@@ -279,30 +395,109 @@ void Application::Run()
 
 	m_Running = true;
 
+	if (m_JobBenchmark)
+	{
+		int result = JobBenchmark::Run();
+		m_Running = false;
+		return result;
+	}
+	if (m_SceneBenchmark)
+	{
+		int result = SceneBenchmark::Run();
+		m_Running = false;
+		return result;
+	}
+	if (m_MathBenchmark)
+	{
+		int result = MathBenchmark::Run();
+		m_Running = false;
+		return result;
+	}
+	if (m_BvhBenchmark)
+	{
+		int result = BvhBenchmark::Run();
+		m_Running = false;
+		return result;
+	}
+	if (m_ParserBenchmark)
+	{
+		int result = ParserBenchmark::Run();
+		m_Running = false;
+		return result;
+	}
+	if (m_ParserCheck)
+	{
+		int result = ParserBenchmark::Check();
+		m_Running = false;
+		return result;
+	}
+	if (m_LogBenchmark)
+	{
+		int result = LogBenchmark::Run();
+		m_Running = false;
+		return result;
+	}
+	if (m_Benchmark)
+	{
+		m_Running = false;
+		if (!WaitForAssets())
+			return 1;
+		RunBenchmark();
+		return 0;
+	}
+
+	m_Simulation.Init(m_FixedUpdateInterval, MaxSimulationStepsPerFrame, m_PipelinedSimulation);
+
+	if (m_Headless)
+	{
+		// Every frame shows the same thing from one run to the next
+		if (!WaitForAssets())
+			return 1;
+		int result = RunHeadless();
+		m_Running = false;
+		return result;
+	}
+
 	SDL_Event event;
+	double lastTime = GetTime();
+	double lastPresentTime = -1.0;
+	double lastStatsTime = lastTime;
 
 	while (m_Running)
 	{
-		while (SDL_PollEvent(&event))
+		// Events recorded last frame are written while nothing else is being timed
+		PROFILE_FLUSH();
+
+		// Waiting before polling keeps input as fresh as possible when it is drawn
+		m_FrameLimiter.Wait();
+
+		PROFILE_SCOPE("Frame");
+
 		{
-			if (event.type == SDL_QUIT)
+			PROFILE_SCOPE("PollEvents");
+			while (SDL_PollEvent(&event))
 			{
-				m_Running = false;
+				HandleEvent(event);
 			}
-			//else if(event.type == SDL_WINDOWEVENT_CLOSE && event.window.windowID == SDL_GetWindowID())
 		}
 
-		uint32_t uniformStride = ceilToNextMultiple(
-			(uint32_t)sizeof(MyUniform),
-			(uint32_t)m_DeviceLimits.minUniformBufferOffsetAlignment
-		);
-
-		MyUniform uniforms;
-		uniforms.time = static_cast<float>(GetTime());
-		m_Queue.writeBuffer(m_UniformBuffer, offsetof(MyUniform, time), &uniforms.time, sizeof(float));
+		if (m_Width == 0 || m_Height == 0)
+		{
+			// Minimized, nothing to draw into until the window comes back
+			SDL_WaitEvent(nullptr);
+			lastPresentTime = -1.0;
+			continue;
+		}
+		if (m_SurfaceOutdated)
+		{
+			ConfigureSurface();
+		}
+		UpdateAssets();
 
-		uniforms.time = -static_cast<float>(GetTime()) - 1.0f;
-		m_Queue.writeBuffer(m_UniformBuffer, uniformStride + offsetof(MyUniform, time), &uniforms.time, sizeof(float));
+		const double currentTime = GetTime();
+		const FrameState& frameState = m_Simulation.Advance(currentTime - lastTime);
+		lastTime = currentTime;
+		PROFILE_COUNTER("Simulation steps", frameState.steps);
 
 		wgpu::TextureView targetView = GetNextSurfaceTextureView();
 		if (!targetView)
@@ -310,71 +505,481 @@ void Application::Run()
 			continue;
 		}
 
-		wgpu::CommandEncoderDescriptor encoderDesc = {};
-		encoderDesc.label = "Command encoder";
-		wgpu::CommandEncoder encoder = m_Device.createCommandEncoder(encoderDesc);
+		RenderFrame(targetView, frameState.time);
+		targetView.release();
+		if (m_Surface)
+		{
+			PROFILE_SCOPE("Present");
+			m_Surface.present();
+		}
 
-		wgpu::RenderPassDescriptor renderPassDesc = {};
+		const double presentTime = GetTime();
+		if (m_FirstFrameTime < 0.0)
+		{
+			m_FirstFrameTime = presentTime - m_StartTime;
+			LOG_INFO("First frame presented {0:.1f} ms after start", m_FirstFrameTime * 1000.0);
+		}
+		if (lastPresentTime >= 0.0)
+			m_FrameTimes.Add(presentTime - lastPresentTime);
+		lastPresentTime = presentTime;
+		if (m_PendingInputTime >= 0.0)
+		{
+			m_InputLatency.Add(presentTime - m_PendingInputTime);
+			m_PendingInputTime = -1.0;
+		}
 
-		wgpu::RenderPassColorAttachment renderPassColorAttachment = {};
-		renderPassColorAttachment.view = targetView;
-		renderPassColorAttachment.resolveTarget = nullptr;
-		renderPassColorAttachment.loadOp = wgpu::LoadOp::Clear;
-		renderPassColorAttachment.storeOp = wgpu::StoreOp::Store;
-		renderPassColorAttachment.clearValue = wgpu::Color{ 0.1, 0.4, 0.1, 1.0 };
+		if (presentTime - lastStatsTime >= FrameStatsInterval)
+		{
+			m_FrameTimes.Log("Frame time");
+			m_InputLatency.Log("Input to present latency");
+			m_FrameTimes.Clear();
+			m_InputLatency.Clear();
+			LogCullingStats();
+			lastStatsTime = presentTime;
+		}
 
-		renderPassDesc.colorAttachmentCount = 1;
-		renderPassDesc.colorAttachments = &renderPassColorAttachment;
-		renderPassDesc.depthStencilAttachment = nullptr;
-		renderPassDesc.timestampWrites = nullptr;
-		renderPassDesc.nextInChain = nullptr;
+		PROFILE_SCOPE("PollDevice");
+#if defined(WEBGPU_BACKEND_DAWN)
+		m_Device.tick();
+#elif defined(WEBGPU_BACKEND_WGPU)
+		m_Device.poll(false);
+#endif
+	}
 
-		wgpu::RenderPassEncoder renderPass = encoder.beginRenderPass(renderPassDesc);
-		renderPass.setPipeline(m_Pipeline);
-		renderPass.setVertexBuffer(0, m_VertexBuffer, 0, m_VertexBuffer.getSize());
-		renderPass.setIndexBuffer(m_IndexBuffer, wgpu::IndexFormat::Uint16, 0, m_IndexCount * sizeof(uint16_t));
+	m_FrameTimes.Log("Frame time");
+	m_InputLatency.Log("Input to present latency");
+	LogCullingStats();
+	LOG_DEBUG("Uniform ring stalled {0} times, {1} bytes uploaded in the last frame", m_UniformRing.GetStallCount(), m_UniformRing.GetBytesUploaded());
+	m_Uploads.LogStats();
+	m_Resources.LogStats();
+	LogSimulationStats();
+	return 0;
+}
 
-		uint32_t dynamicOffset = 0;
+void Application::RunBenchmark()
+{
+	for (uint32_t instanceCount : BenchmarkInstanceCounts)
+	{
+		CreateInstanceGrid(instanceCount);
 
-		dynamicOffset = 0 * uniformStride;
-		renderPass.setBindGroup(0, m_BindGroup, 1, &dynamicOffset);
-		renderPass.drawIndexed(m_IndexCount, 1, 0, 0, 0);
+		for (bool useRenderBundles : { false, true })
+		{
+			m_UseRenderBundles = useRenderBundles;
 
-		dynamicOffset = 1 * uniformStride;
-		renderPass.setBindGroup(0, m_BindGroup, 1, &dynamicOffset);
-		renderPass.drawIndexed(m_IndexCount, 1, 0, 0, 0);
+			double totalEncodeTime = 0.0;
+			double worstEncodeTime = 0.0;
+			const double startTime = GetTime();
+			for (uint32_t frame = 0; frame < BenchmarkFrames; ++frame)
+			{
+				PROFILE_FLUSH();
+				PROFILE_SCOPE("Frame");
+				wgpu::TextureView targetView = GetNextSurfaceTextureView();
+				RenderFrame(targetView, static_cast<float>(GetTime()));
+				targetView.release();
+				wgpuPollEvents(m_Device, false);
+
+				totalEncodeTime += m_EncodeTime;
+				worstEncodeTime = std::max(worstEncodeTime, m_EncodeTime);
+			}
+			const double frameTime = (GetTime() - startTime) / BenchmarkFrames;
 
-		renderPass.end();
-		renderPass.release();
+			// The worst frame with bundles includes recording them
+			LOG_INFO("{0} instances{1}: {2:.4f} ms to encode a frame (worst {3:.4f} ms), {4:.3f} ms per frame",
+				instanceCount, useRenderBundles ? " with render bundles" : "", totalEncodeTime / BenchmarkFrames * 1000.0,
+				worstEncodeTime * 1000.0, frameTime * 1000.0);
+		}
+		LogCullingStats();
+	}
+	// Each instance count replaced the instance buffer and bind group while frames were in flight
+	m_Resources.LogStats();
+}
 
-		// Encode commands into a command buffer
-		wgpu::CommandBufferDescriptor cmdBufferDescriptor = {};
-		cmdBufferDescriptor.label = "Command buffer";
-		wgpu::CommandBuffer command = encoder.finish(cmdBufferDescriptor);
-		encoder.release();
+int Application::RunHeadless()
+{
+	TimingStats cpuTimes;
+	TimingStats gpuTimes;
+	cpuTimes.Reserve(m_HeadlessFrames);
+	gpuTimes.Reserve(m_HeadlessFrames);
 
-		m_Queue.submit(command);
-		command.release();
+	for (uint32_t frame = 0; frame < m_HeadlessFrames; ++frame)
+	{
+		PROFILE_FLUSH();
+		PROFILE_SCOPE("Frame");
+		const double frameStart = GetTime();
+		const FrameState& frameState = m_Simulation.Advance(HeadlessTimeStep);
+		wgpu::TextureView targetView = GetNextSurfaceTextureView();
+		RenderFrame(targetView, frameState.time);
 		targetView.release();
-		m_Surface.present();
+		const double submitTime = GetTime();
 
-#if defined(WEBGPU_BACKEND_DAWN)
-		m_Device.tick();
-#elif defined(WEBGPU_BACKEND_WGPU)
-		m_Device.poll(false);
-#endif
+		// Frames are not overlapped so the wait measures how long the GPU took with this frame
+		{
+			PROFILE_SCOPE("WaitForGPU");
+			WaitForGPU();
+		}
+		cpuTimes.Add(submitTime - frameStart);
+		gpuTimes.Add(GetTime() - submitTime);
+		if (m_FirstFrameTime < 0.0)
+		{
+			m_FirstFrameTime = GetTime() - m_StartTime;
+			LOG_INFO("First frame rendered {0:.1f} ms after start", m_FirstFrameTime * 1000.0);
+		}
 	}
+
+	cpuTimes.Log("CPU frame time");
+	gpuTimes.Log("GPU frame time");
+	LogCullingStats();
+	LogSimulationStats();
+
+	if (m_CapturePath.empty() && !m_HashCapture)
+		return 0;
+
+	std::vector<uint8_t> rgba;
+	if (!ReadbackFrame(rgba))
+		return 1;
+
+	if (m_HashCapture)
+	{
+		LOG_INFO("Frame {0} hash: {1:016x}", m_HeadlessFrames - 1, HashBytes(rgba.data(), rgba.size()));
+	}
+	if (!m_CapturePath.empty())
+	{
+		if (!ImageWriter::WritePNG(m_CapturePath, m_Width, m_Height, rgba.data()))
+			return 1;
+		LOG_INFO("Wrote frame {0} to {1}", m_HeadlessFrames - 1, m_CapturePath.string());
+	}
+	return 0;
 }
-wgpu::TextureView Application::GetNextSurfaceTextureView()
+
+void Application::LogSimulationStats()
+{
+	const bool pipelined = m_Simulation.IsPipelined();
+	m_Simulation.Shutdown();
+	LOG_DEBUG("Simulation ran {0} steps of {1:.2f} ms, {2} frames hit the step limit", m_Simulation.GetStepCount(),
+		m_FixedUpdateInterval * 1000.0f, m_Simulation.GetClampedFrameCount());
+	if (pipelined)
+	{
+		LOG_DEBUG("Render thread waited {0:.2f} ms in total for the simulation thread", m_Simulation.GetWaitTime() * 1000.0);
+	}
+}
+
+void Application::HandleEvent(const SDL_Event& event)
+{
+	switch (event.type)
+	{
+	case SDL_QUIT:
+		m_Running = false;
+		break;
+	case SDL_WINDOWEVENT:
+		if (event.window.event == SDL_WINDOWEVENT_SIZE_CHANGED)
+		{
+			m_Width = static_cast<uint32_t>(std::max(event.window.data1, 0));
+			m_Height = static_cast<uint32_t>(std::max(event.window.data2, 0));
+			m_SurfaceOutdated = true;
+		}
+		break;
+	case SDL_KEYDOWN:
+	case SDL_KEYUP:
+	case SDL_MOUSEBUTTONDOWN:
+	case SDL_MOUSEBUTTONUP:
+	case SDL_MOUSEMOTION:
+	case SDL_MOUSEWHEEL:
+		if (m_PendingInputTime < 0.0)
+		{
+			// Event timestamps are SDL ticks in milliseconds, measure how long ago it happened on that clock
+			const Uint32 age = SDL_GetTicks() - event.common.timestamp;
+			m_PendingInputTime = GetTime() - age / 1000.0;
+		}
+		break;
+	default:
+		break;
+	}
+}
+
+void Application::ConfigureSurface()
+{
+	m_SurfaceOutdated = false;
+	if (m_Width == 0 || m_Height == 0)
+		return;
+
+	wgpu::SurfaceConfiguration surfaceConfig = {};
+
+	surfaceConfig.width = m_Width;
+	surfaceConfig.height = m_Height;
+	surfaceConfig.usage = wgpu::TextureUsage::RenderAttachment;
+	surfaceConfig.format = m_SurfaceFormat;
+
+	surfaceConfig.viewFormatCount = 0;
+	surfaceConfig.viewFormats = nullptr;
+	surfaceConfig.device = m_Device;
+	surfaceConfig.presentMode = m_PresentMode;
+	surfaceConfig.alphaMode = wgpu::CompositeAlphaMode::Auto;
+
+	m_Surface.configure(surfaceConfig);
+	LOG_TRACE("Surface configured at {0}x{1}", m_Width, m_Height);
+}
+
+void Application::WaitForGPU()
+{
+	bool done = false;
+	auto callbackHandle = m_Queue.onSubmittedWorkDone([&done](wgpu::QueueWorkDoneStatus) { done = true; });
+	while (!done)
+	{
+		wgpuPollEvents(m_Device, true);
+	}
+}
+
+bool Application::ReadbackFrame(std::vector<uint8_t>& rgba)
 {
-	wgpu::SurfaceTexture surfaceTexture;
-	m_Surface.getCurrentTexture(&surfaceTexture);
-	if (surfaceTexture.status != wgpu::SurfaceGetCurrentTextureStatus::Success) {
-		LOG_ERROR("Could not get surface texture");
-		return nullptr;
+	// Rows of a texture copy must start on 256 byte boundaries
+	const uint32_t bytesPerRow = ceilToNextMultiple(m_Width * 4, 256);
+	const uint64_t bufferSize = uint64_t(bytesPerRow) * m_Height;
+
+	wgpu::BufferDescriptor bufferDesc;
+	bufferDesc.label = "Readback Buffer";
+	bufferDesc.usage = wgpu::BufferUsage::CopyDst | wgpu::BufferUsage::MapRead;
+	bufferDesc.size = bufferSize;
+	bufferDesc.mappedAtCreation = false;
+	wgpu::Buffer readbackBuffer = m_Device.createBuffer(bufferDesc);
+
+	wgpu::ImageCopyTexture source;
+	source.texture = m_OffscreenTexture;
+	source.mipLevel = 0;
+	source.aspect = wgpu::TextureAspect::All;
+	wgpu::ImageCopyBuffer destination;
+	destination.buffer = readbackBuffer;
+	destination.layout.offset = 0;
+	destination.layout.bytesPerRow = bytesPerRow;
+	destination.layout.rowsPerImage = m_Height;
+
+	wgpu::CommandEncoder encoder = m_Device.createCommandEncoder(wgpu::Default);
+	encoder.copyTextureToBuffer(source, destination, { m_Width, m_Height, 1 });
+	wgpu::CommandBuffer command = encoder.finish(wgpu::Default);
+	encoder.release();
+	m_Queue.submit(command);
+	command.release();
+
+	bool mapped = false;
+	bool done = false;
+	auto callbackHandle = readbackBuffer.mapAsync(wgpu::MapMode::Read, 0, static_cast<size_t>(bufferSize), [&](wgpu::BufferMapAsyncStatus status) {
+		mapped = status == wgpu::BufferMapAsyncStatus::Success;
+		done = true;
+	});
+	while (!done)
+	{
+		wgpuPollEvents(m_Device, true);
 	}
 
-	wgpu::Texture texture = surfaceTexture.texture;
+	if (!mapped)
+	{
+		LOG_ERROR("Could not map the readback buffer");
+		readbackBuffer.release();
+		return false;
+	}
+
+	// The offscreen target is BGRA, images are written as RGBA
+	const uint8_t* data = static_cast<const uint8_t*>(readbackBuffer.getConstMappedRange(0, static_cast<size_t>(bufferSize)));
+	rgba.resize(size_t(m_Width) * m_Height * 4);
+	for (uint32_t y = 0; y < m_Height; ++y)
+	{
+		const uint8_t* row = data + size_t(y) * bytesPerRow;
+		uint8_t* out = rgba.data() + size_t(y) * m_Width * 4;
+		for (uint32_t x = 0; x < m_Width; ++x)
+		{
+			out[x * 4 + 0] = row[x * 4 + 2];
+			out[x * 4 + 1] = row[x * 4 + 1];
+			out[x * 4 + 2] = row[x * 4 + 0];
+			out[x * 4 + 3] = row[x * 4 + 3];
+		}
+	}
+
+	readbackBuffer.unmap();
+	readbackBuffer.destroy();
+	readbackBuffer.release();
+	return true;
+}
+
+void Application::RenderFrame(wgpu::TextureView targetView, float time)
+{
+	PROFILE_FUNCTION();
+
+	if (m_Scene.GetVersion() != m_InstanceVersion)
+		UpdateInstances();
+	// Bounds come from the mesh being drawn, everything is drawn until there is one
+	if (m_Culling && m_DrawMesh)
+		CullInstances(time);
+
+	m_UniformRing.BeginFrame();
+
+	MyUniform uniforms;
+	uniforms.colour = { 1.0f, 1.0f, 1.0f, 1.0f };
+	uniforms.positionTransform = m_DrawMesh ? m_DrawMesh->positionTransform : std::array<float, 4>{ 1.0f, 1.0f, 0.0f, 0.0f };
+	uniforms.time = time;
+	const uint32_t uniformOffset = m_UniformRing.Push(uniforms);
+
+	m_UniformRing.Upload();
+	PROFILE_COUNTER("Uniform bytes uploaded", m_UniformRing.GetBytesUploaded());
+	PROFILE_COUNTER("Staging bytes in use", m_Uploads.GetStagingInUse());
+	// Copies go in their own submission ahead of the frame's commands
+	m_Uploads.Submit();
+
+	const double encodeStart = GetTime();
+
+	wgpu::CommandEncoderDescriptor encoderDesc = {};
+	encoderDesc.label = "Command encoder";
+	wgpu::CommandEncoder encoder = m_Device.createCommandEncoder(encoderDesc);
+
+	wgpu::RenderPassDescriptor renderPassDesc = {};
+
+	wgpu::RenderPassColorAttachment renderPassColorAttachment = {};
+	renderPassColorAttachment.view = targetView;
+	renderPassColorAttachment.resolveTarget = nullptr;
+	renderPassColorAttachment.loadOp = wgpu::LoadOp::Clear;
+	renderPassColorAttachment.storeOp = wgpu::StoreOp::Store;
+	renderPassColorAttachment.clearValue = wgpu::Color{ 0.1, 0.4, 0.1, 1.0 };
+
+	renderPassDesc.colorAttachmentCount = 1;
+	renderPassDesc.colorAttachments = &renderPassColorAttachment;
+	renderPassDesc.depthStencilAttachment = nullptr;
+	renderPassDesc.timestampWrites = nullptr;
+	renderPassDesc.nextInChain = nullptr;
+
+	wgpu::RenderPassEncoder renderPass = encoder.beginRenderPass(renderPassDesc);
+	if (!m_Pipeline)
+	{
+		// The shader is still loading, only clear
+	}
+	else if (uniformOffset == UINT32_MAX)
+	{
+		// The uniform ring is full and has warned, an invalid dynamic offset would fail validation
+	}
+	else if (m_InstanceCount == 0)
+	{
+		// No entities, or every one of them culled
+	}
+	else if (m_UseRenderBundles)
+	{
+		std::vector<wgpu::RenderBundle>& bundles = m_RenderBundles[m_UniformRing.GetFrameIndex()];
+		if (bundles.empty())
+			bundles = RecordRenderBundles(uniformOffset);
+		renderPass.executeBundles(bundles.size(), (WGPURenderBundle*)bundles.data());
+	}
+	else
+	{
+		const GpuMesh& mesh = *m_DrawMesh;
+		wgpu::Buffer vertexBuffer = m_Resources.Get(mesh.vertexBuffer);
+		wgpu::Buffer indexBuffer = m_Resources.Get(mesh.indexBuffer);
+		renderPass.setPipeline(m_Pipeline);
+		renderPass.setVertexBuffer(0, vertexBuffer, 0, vertexBuffer.getSize());
+		renderPass.setIndexBuffer(indexBuffer, mesh.indexFormat, 0, indexBuffer.getSize());
+
+		// Every instance is drawn by one call, the shader looks its data up with the instance index
+		renderPass.setBindGroup(0, m_Resources.Get(m_BindGroup), 1, &uniformOffset);
+		renderPass.drawIndexed(mesh.indexCount, m_InstanceCount, 0, 0, 0);
+	}
+
+	renderPass.end();
+	renderPass.release();
+
+	// Encode commands into a command buffer
+	wgpu::CommandBufferDescriptor cmdBufferDescriptor = {};
+	cmdBufferDescriptor.label = "Command buffer";
+	wgpu::CommandBuffer command = encoder.finish(cmdBufferDescriptor);
+	encoder.release();
+
+	m_EncodeTime = GetTime() - encodeStart;
+
+	{
+		PROFILE_SCOPE("Submit");
+		m_Queue.submit(command);
+	}
+	command.release();
+	m_UniformRing.EndFrame();
+	m_Resources.EndFrame();
+}
+std::vector<wgpu::RenderBundle> Application::RecordRenderBundles(uint32_t uniformOffset)
+{
+	PROFILE_FUNCTION();
+
+	const uint32_t bundleCount = std::clamp(m_InstanceCount / MinInstancesPerBundle, 1u, JobSystem::GetThreadCount());
+	const uint32_t instancesPerBundle = (m_InstanceCount + bundleCount - 1) / bundleCount;
+
+	std::vector<wgpu::RenderBundle> bundles(bundleCount, nullptr);
+	const GpuMesh& mesh = *m_DrawMesh;
+	wgpu::Buffer vertexBuffer = m_Resources.Get(mesh.vertexBuffer);
+	wgpu::Buffer indexBuffer = m_Resources.Get(mesh.indexBuffer);
+	wgpu::BindGroup bindGroup = m_Resources.Get(m_BindGroup);
+	auto recordBundle = [&](uint32_t index) {
+		PROFILE_SCOPE("Record render bundle");
+		const uint32_t firstInstance = index * instancesPerBundle;
+		const uint32_t instanceCount = std::min(instancesPerBundle, m_InstanceCount - std::min(firstInstance, m_InstanceCount));
+
+		wgpu::RenderBundleEncoderDescriptor bundleEncoderDesc;
+		bundleEncoderDesc.label = "Static draws";
+		bundleEncoderDesc.colorFormatCount = 1;
+		bundleEncoderDesc.colorFormats = &m_SurfaceFormat;
+		bundleEncoderDesc.depthStencilFormat = wgpu::TextureFormat::Undefined;
+		bundleEncoderDesc.sampleCount = 1;
+		wgpu::RenderBundleEncoder bundleEncoder = m_Device.createRenderBundleEncoder(bundleEncoderDesc);
+
+		bundleEncoder.setPipeline(m_Pipeline);
+		bundleEncoder.setVertexBuffer(0, vertexBuffer, 0, vertexBuffer.getSize());
+		bundleEncoder.setIndexBuffer(indexBuffer, mesh.indexFormat, 0, indexBuffer.getSize());
+		bundleEncoder.setBindGroup(0, bindGroup, 1, &uniformOffset);
+		bundleEncoder.drawIndexed(mesh.indexCount, instanceCount, 0, 0, firstInstance);
+
+		wgpu::RenderBundleDescriptor bundleDesc;
+		bundleDesc.label = "Static draws";
+		bundles[index] = bundleEncoder.finish(bundleDesc);
+		bundleEncoder.release();
+	};
+
+	JobSystem::ParallelFor(bundleCount, [&recordBundle](uint32_t begin, uint32_t end) {
+		for (uint32_t i = begin; i < end; ++i)
+			recordBundle(i);
+	});
+
+	LOG_TRACE("Recorded {0} render bundles for {1} instances", bundleCount, m_InstanceCount);
+	return bundles;
+}
+void Application::InvalidateRenderBundles()
+{
+	for (std::vector<wgpu::RenderBundle>& bundles : m_RenderBundles)
+	{
+		for (wgpu::RenderBundle& bundle : bundles)
+			bundle.release();
+		bundles.clear();
+	}
+}
+wgpu::TextureView Application::GetNextSurfaceTextureView()
+{
+	wgpu::Texture texture = m_OffscreenTexture;
+	if (!m_Headless)
+	{
+		wgpu::SurfaceTexture surfaceTexture;
+		m_Surface.getCurrentTexture(&surfaceTexture);
+		switch (surfaceTexture.status)
+		{
+		case wgpu::SurfaceGetCurrentTextureStatus::Success:
+			break;
+		case wgpu::SurfaceGetCurrentTextureStatus::Timeout:
+			return nullptr;
+		case wgpu::SurfaceGetCurrentTextureStatus::Outdated:
+		case wgpu::SurfaceGetCurrentTextureStatus::Lost:
+			// The window changed since the surface was configured, skip the frame and configure it again
+			if (surfaceTexture.texture)
+				surfaceTexture.texture.release();
+			m_SurfaceOutdated = true;
+			return nullptr;
+		default:
+			LOG_ERROR("Could not get surface texture");
+			return nullptr;
+		}
+		texture = surfaceTexture.texture;
+		// Still usable this frame, but a new configuration would match the window better
+		if (surfaceTexture.suboptimal)
+			m_SurfaceOutdated = true;
+	}
 
 	wgpu::TextureViewDescriptor viewDescriptor;
 	viewDescriptor.label = "Surface texture view";
@@ -400,8 +1005,10 @@ wgpu::RequiredLimits Application::GetRequiredLimits(wgpu::Adapter adapter)
 
 	requiredLimits.limits.maxVertexAttributes = 2;
 	requiredLimits.limits.maxVertexBuffers = 1;
-	requiredLimits.limits.maxBufferSize = 15 * 5 * sizeof(float);
-	requiredLimits.limits.maxVertexBufferArrayStride = 5 * sizeof(float);
+
+	// Meshes load and entities spawn after the device exists so their sizes are unknown here, allow whatever the adapter can do
+	requiredLimits.limits.maxBufferSize = supportedLimits.limits.maxBufferSize;
+	requiredLimits.limits.maxVertexBufferArrayStride = supportedLimits.limits.maxVertexBufferArrayStride;
 	requiredLimits.limits.minStorageBufferOffsetAlignment = supportedLimits.limits.minStorageBufferOffsetAlignment;
 	requiredLimits.limits.minUniformBufferOffsetAlignment = supportedLimits.limits.minUniformBufferOffsetAlignment;
 	requiredLimits.limits.maxTextureDimension2D = supportedLimits.limits.maxTextureDimension2D;
@@ -410,60 +1017,292 @@ wgpu::RequiredLimits Application::GetRequiredLimits(wgpu::Adapter adapter)
 	requiredLimits.limits.maxUniformBuffersPerShaderStage = 1;
 	requiredLimits.limits.maxUniformBufferBindingSize = 16 * 4;
 	requiredLimits.limits.maxDynamicUniformBuffersPerPipelineLayout = 1;
+	requiredLimits.limits.maxStorageBuffersPerShaderStage = 1;
+	requiredLimits.limits.maxStorageBufferBindingSize = supportedLimits.limits.maxStorageBufferBindingSize;
 
 	return requiredLimits;
 }
-void Application::InitializeBuffers()
+void Application::LoadAssets()
 {
-	std::vector<float> vertexData;
+	MeshImportOptions importOptions;
+	importOptions.weld = true;
+	importOptions.weldTolerance = 0.0f;
+	importOptions.optimize = true;
 
-	std::vector<uint16_t> indexData;
+	importOptions.quantize = true;
 
-	bool success = SimpleMeshParser::LoadGeometry(m_WorkingDirectory / "resources" / "simple_mesh.txt", vertexData, indexData);
-	if (!success) {
-		LOG_ERROR("Could not load geometry!");
+	m_ShaderAsset = m_Assets.LoadShader(m_WorkingDirectory / "resources" / "shader.wgsl");
+	m_MeshAsset = m_Assets.LoadMesh(m_WorkingDirectory / "resources" / "simple_mesh.txt", m_WorkingDirectory / "cache" / "simple_mesh.meshcache", importOptions);
+}
+void Application::CreatePlaceholderMesh()
+{
+	// A white quad in the unquantized layout
+	const float vertices[] = {
+		-0.5f, -0.5f, 1.0f, 1.0f, 1.0f,
+		 0.5f, -0.5f, 1.0f, 1.0f, 1.0f,
+		 0.5f,  0.5f, 1.0f, 1.0f, 1.0f,
+		-0.5f,  0.5f, 1.0f, 1.0f, 1.0f,
+	};
+	const uint16_t indices[] = { 0, 1, 2, 0, 2, 3 };
+
+	m_PlaceholderMesh.vertexBuffer = m_Resources.Add(m_Uploads.CreateBuffer("Placeholder Vertex Buffer", wgpu::BufferUsage::Vertex, vertices, sizeof(vertices)));
+	m_PlaceholderMesh.indexBuffer = m_Resources.Add(m_Uploads.CreateBuffer("Placeholder Index Buffer", wgpu::BufferUsage::Index, indices, sizeof(indices)));
+	m_PlaceholderMesh.vertexCount = 4;
+	m_PlaceholderMesh.indexCount = 6;
+	m_PlaceholderMesh.indexFormat = wgpu::IndexFormat::Uint16;
+	m_PlaceholderMesh.layout = MeshLayout::PositionColour();
+	m_PlaceholderMesh.bounds = { { -0.5f, -0.5f, 0.0f }, { 0.5f, 0.5f, 0.0f } };
+}
+void Application::UpdateAssets()
+{
+	PROFILE_FUNCTION();
+
+	m_Assets.Update();
+
+	// Wait for the pipeline job to finish before looking at its result or starting another
+	if (m_AssetsLoaded || !m_PipelineJobs.IsDone())
+		return;
+
+	if (m_PendingMesh)
+	{
+		if (!m_PendingPipeline)
+		{
+			LOG_ERROR("Could not create a pipeline for the {0} mesh", m_PendingMesh == &m_PlaceholderMesh ? "placeholder" : "loaded");
+		}
+		InvalidateRenderBundles();
+		m_Pipeline = m_PendingPipeline;
+		m_DrawMesh = m_PendingMesh;
+		m_PendingPipeline = nullptr;
+		m_PendingMesh = nullptr;
+	}
+
+	const AssetState shaderState = m_Assets.GetState(m_ShaderAsset);
+	const AssetState meshState = m_Assets.GetState(m_MeshAsset);
+	if (shaderState == AssetState::Loading)
+		return;
+	if (shaderState == AssetState::Failed || (m_DrawMesh && meshState == AssetState::Failed) || (m_DrawMesh && m_DrawMesh == m_Assets.GetMesh(m_MeshAsset)))
+	{
+		m_AssetsLoaded = true;
+		LOG_INFO("Assets loaded {0:.1f} ms after start", (GetTime() - m_StartTime) * 1000.0);
+		m_PipelineCache.LogStats();
+		m_Uploads.LogStats();
+		m_Resources.LogStats();
 		return;
 	}
 
-	m_VertexCount = static_cast<uint32_t>(vertexData.size() / 5);
-	m_IndexCount = static_cast<uint32_t>(indexData.size());
+	if (!m_PipelinesPrewarmed)
+	{
+		m_PipelinesPrewarmed = true;
+		PrewarmPipelines();
+		return;
+	}
 
-	wgpu::BufferDescriptor bufferDesc;
-	bufferDesc.size = vertexData.size() * sizeof(float);
-	bufferDesc.usage = wgpu::BufferUsage::CopyDst | wgpu::BufferUsage::Vertex;
-	bufferDesc.mappedAtCreation = false;
-	m_VertexBuffer = m_Device.createBuffer(bufferDesc);
+	// Draw the placeholder until the mesh is ready
+	const GpuMesh* mesh = m_Assets.GetMesh(m_MeshAsset);
+	if (!mesh)
+		mesh = &m_PlaceholderMesh;
+	if (mesh == m_DrawMesh)
+		return;
 
-	m_Queue.writeBuffer(m_VertexBuffer, 0, vertexData.data(), bufferDesc.size);
+	m_PendingPipelineState = GetPipelineState(mesh->layout);
+	m_PendingMesh = mesh;
+	// Creating a pipeline can take long enough to drop frames, the current one keeps drawing meanwhile
+	JobSystem::Run([this] { m_PendingPipeline = m_PipelineCache.GetRenderPipeline(m_PendingPipelineState); }, &m_PipelineJobs);
+}
+RenderPipelineState Application::GetPipelineState(const MeshLayout& vertexLayout) const
+{
+	RenderPipelineState state;
+	state.shaderHash = m_Assets.GetShaderHash(m_ShaderAsset);
+	state.vertexLayout = vertexLayout;
+	state.colourFormat = m_SurfaceFormat;
+	state.bindGroupLayout = m_BindGroupLayout;
+	return state;
+}
+void Application::PrewarmPipelines()
+{
+	// The placeholder and meshes imported without quantization use the unquantized layout, the mesh's own is
+	// known if it has loaded on the CPU by now
+	m_PrewarmStates = { GetPipelineState(MeshLayout::PositionColour()) };
+	MeshLayout meshLayout;
+	if (m_Assets.GetMeshLayout(m_MeshAsset, meshLayout) && meshLayout != MeshLayout::PositionColour())
+		m_PrewarmStates.push_back(GetPipelineState(meshLayout));
+	JobSystem::Run([this] { m_PipelineCache.Prewarm(m_PrewarmStates); }, &m_PipelineJobs);
+}
+bool Application::WaitForAssets()
+{
+	while (!m_AssetsLoaded)
+	{
+		m_Assets.WaitForLoads();
+		JobSystem::Wait(m_PipelineJobs);
+		UpdateAssets();
+		m_Uploads.Submit();
+	}
+	if (!m_Pipeline)
+	{
+		LOG_ERROR("Nothing to draw, the shader or its pipeline failed to load");
+		return false;
+	}
+	return true;
+}
+void Application::SetInstances(const std::vector<InstanceData>& instances)
+{
+	// Bundles reference the bind group being replaced, frames in flight keep using it until the GPU is done
+	InvalidateRenderBundles();
+	m_Resources.Destroy(m_BindGroup);
+	m_Resources.Destroy(m_InstanceBuffer);
+	// Buffers and bindings can't be empty, without entities one unused instance is bound and nothing is drawn
+	const InstanceData placeholder = {};
+	const uint64_t instanceBufferSize = std::max<size_t>(instances.size(), 1) * sizeof(InstanceData);
+	m_InstanceBuffer = m_Resources.Add(m_Uploads.CreateBuffer("Instance Buffer", wgpu::BufferUsage::CopyDst | wgpu::BufferUsage::Storage,
+		instances.empty() ? &placeholder : instances.data(), instanceBufferSize));
+	m_InstanceCount = static_cast<uint32_t>(instances.size());
+
+	std::array<wgpu::BindGroupEntry, 2> bindings{};
+	bindings[0].binding = 0;
+	bindings[0].buffer = m_UniformRing.GetBuffer();
+	bindings[0].offset = 0;
+	bindings[0].size = sizeof(MyUniform);
+
+	bindings[1].binding = 1;
+	bindings[1].buffer = m_Resources.Get(m_InstanceBuffer);
+	bindings[1].offset = 0;
+	bindings[1].size = instanceBufferSize;
 
-	bufferDesc.size = indexData.size() * sizeof(uint16_t);
-	bufferDesc.usage = wgpu::BufferUsage::CopyDst | wgpu::BufferUsage::Index;
-	m_IndexBuffer = m_Device.createBuffer(bufferDesc);
+	wgpu::BindGroupDescriptor bindGroupDesc{};
+	bindGroupDesc.layout = m_BindGroupLayout;
+	bindGroupDesc.entryCount = bindings.size();
+	bindGroupDesc.entries = bindings.data();
+	m_BindGroup = m_Resources.CreateBindGroup(bindGroupDesc);
+}
+void Application::UpdateInstances()
+{
+	PROFILE_FUNCTION();
+
+	// The shader animates instances from their speed and phase, so the list only changes with the entities.
+	// Every entity draws the one mesh, drawn with the placeholder until it has loaded.
+	std::vector<InstanceData>& instances = m_SceneInstances;
+	instances.resize(m_Scene.Count<Transform, Colour, MeshRef, Animation>());
+	m_Scene.ParallelEach<Transform, Colour, MeshRef, Animation>([&instances](uint32_t first, uint32_t count,
+		const Transform* transforms, const Colour* colours, const MeshRef*, const Animation* animations) {
+		for (uint32_t i = 0; i < count; ++i)
+			instances[first + i] = { transforms[i].position, transforms[i].scale, animations[i].speed, colours[i].value, animations[i].phase, {} };
+	});
+	// Sized for every instance so culling only ever writes a prefix of it
+	SetInstances(instances);
+	m_InstanceVersion = m_Scene.GetVersion();
+
+	// The tree is built from the first culled frame's bounds
+	m_Bvh.Clear();
+	m_InstanceLeaves.clear();
+	m_DrawnVisible.assign(instances.size(), 1);
+}
+void Application::CullInstances(float time)
+{
+	PROFILE_FUNCTION();
+	const double startTime = GetTime();
+
+	// Where shader.wgsl draws each instance at 'time': the mesh scaled around a point orbiting the offset
+	const Aabb meshBounds = m_DrawMesh->bounds;
+	const uint32_t instanceCount = static_cast<uint32_t>(m_SceneInstances.size());
+	const bool built = !m_InstanceLeaves.empty();
+	m_InstanceTransforms.resize(instanceCount);
+	m_InstanceBounds.resize(instanceCount);
+	JobSystem::ParallelFor(instanceCount, [this, time, built, &meshBounds](uint32_t begin, uint32_t end) {
+		for (uint32_t i = begin; i < end; ++i)
+		{
+			const InstanceData& instance = m_SceneInstances[i];
+			const float angle = time * instance.speed + instance.phase;
+			const float radius = 0.3f * instance.scale;
+			const Vec3 centre = { instance.offset[0] + radius * std::cos(angle), instance.offset[1] + radius * std::sin(angle), 0.0f };
+			// Translation(centre) * Scale(scale) without the multiply
+			m_InstanceTransforms[i] = Mat4::Scale({ instance.scale, instance.scale, instance.scale });
+			m_InstanceTransforms[i].columns[3] = { centre.x, centre.y, centre.z, 1.0f };
+			m_InstanceBounds[i] = meshBounds;
+		}
+		MathBatch::TransformBounds(m_InstanceTransforms.data() + begin, m_InstanceBounds.data() + begin, m_InstanceBounds.data() + begin, end - begin);
+		if (built)
+		{
+			for (uint32_t i = begin; i < end; ++i)
+				m_Bvh.SetBounds(m_InstanceLeaves[i], m_InstanceBounds[i]);
+		}
+	}, CullingGrain);
 
-	m_Queue.writeBuffer(m_IndexBuffer, 0, indexData.data(), bufferDesc.size);
+	if (built)
+	{
+		m_Bvh.Update();
+	}
+	else
+	{
+		m_InstanceLeaves.resize(instanceCount);
+		m_Bvh.Build(m_InstanceBounds.data(), instanceCount, m_InstanceLeaves.data());
+	}
+
+	// Clip space, widened so rounding differences with the shader never cull an instance just reaching into it
+	const Aabb view = { { -1.0f - ViewMargin, -1.0f - ViewMargin, 0.0f }, { 1.0f + ViewMargin, 1.0f + ViewMargin, 0.0f } };
+	m_InstanceVisible.assign(instanceCount, 0);
+	m_Bvh.ParallelQuery(view, [this](uint32_t index) { m_InstanceVisible[index] = 1; });
+
+	// Rewritten only when the visible set changes, in scene order so the draw order stays the same
+	if (m_InstanceVisible != m_DrawnVisible)
+	{
+		m_VisibleInstances.clear();
+		for (uint32_t i = 0; i < instanceCount; ++i)
+		{
+			if (m_InstanceVisible[i])
+				m_VisibleInstances.push_back(m_SceneInstances[i]);
+		}
+		if (!m_VisibleInstances.empty())
+			m_Uploads.Write(m_Resources.Get(m_InstanceBuffer), 0, m_VisibleInstances.data(), m_VisibleInstances.size() * sizeof(InstanceData));
+		m_DrawnVisible.swap(m_InstanceVisible);
+
+		const uint32_t visibleCount = static_cast<uint32_t>(m_VisibleInstances.size());
+		if (visibleCount != m_InstanceCount)
+		{
+			// Bundles hold the instance count
+			InvalidateRenderBundles();
+			m_InstanceCount = visibleCount;
+		}
+	}
+
+	m_VisibleTotal += m_InstanceCount;
+	m_CulledTotal += instanceCount - m_InstanceCount;
+	m_CullTimes.Add(GetTime() - startTime);
+	PROFILE_COUNTER("Visible instances", m_InstanceCount);
+	PROFILE_COUNTER("Culled instances", instanceCount - m_InstanceCount);
+}
+void Application::LogCullingStats()
+{
+	const size_t frames = m_CullTimes.GetCount();
+	if (frames == 0)
+		return;
+
+	m_CullTimes.Log("Culling");
+	LOG_INFO("{0:.0f} instances visible and {1:.0f} culled per frame on average, BVH rebuilt {2} times",
+		static_cast<double>(m_VisibleTotal) / frames, static_cast<double>(m_CulledTotal) / frames, m_Bvh.GetRebuildCount());
+	m_CullTimes.Clear();
+	m_VisibleTotal = 0;
+	m_CulledTotal = 0;
 }
-wgpu::ShaderModule Application::LoadShaderModule(const std::filesystem::path& path)
+void Application::CreateInstanceGrid(uint32_t count)
 {
-	std::ifstream file(path);
-	if (!file.is_open()) {
-		LOG_CRITICAL("Could not load shader from {0}", path.string());
-		return nullptr;
-	}
-	file.seekg(0, std::ios::end);
-	size_t size = file.tellg();
-	std::string shaderSource(size, ' ');
-	file.seekg(0);
-	file.read(shaderSource.data(), size);
-
-	wgpu::ShaderModuleWGSLDescriptor shaderCodeDesc{};
-	shaderCodeDesc.chain.next = nullptr;
-	shaderCodeDesc.chain.sType = wgpu::SType::ShaderModuleWGSLDescriptor;
-	shaderCodeDesc.code = shaderSource.c_str();
-	wgpu::ShaderModuleDescriptor shaderDesc{};
-	shaderDesc.hintCount = 0;
-	shaderDesc.hints = nullptr;
-	shaderDesc.nextInChain = &shaderCodeDesc.chain;
-	return m_Device.createShaderModule(shaderDesc);
+	// Spread the instances over a square grid filling clip space
+	const uint32_t side = static_cast<uint32_t>(std::ceil(std::sqrt(static_cast<double>(count))));
+	const float cell = 2.0f / side;
+
+	m_Scene.Clear();
+	m_Scene.Create<Transform, Colour, MeshRef, Animation>(count, [this, side, cell](uint32_t first, uint32_t runCount,
+		Transform* transforms, Colour* colours, MeshRef* meshes, Animation* animations) {
+		for (uint32_t run = 0; run < runCount; ++run)
+		{
+			const uint32_t i = first + run;
+			const uint32_t x = i % side;
+			const uint32_t y = i / side;
+			transforms[run] = { { -1.0f + cell * (x + 0.5f), -1.0f + cell * (y + 0.5f) }, cell * 0.5f };
+			colours[run] = { { (x % 7) / 6.0f, (y % 5) / 4.0f, (i % 3) / 2.0f, 1.0f } };
+			meshes[run] = { m_MeshAsset };
+			animations[run] = { (i & 1) ? -1.0f : 1.0f, i * 0.1f };
+		}
+	});
 }
 double Application::GetTime()
 {
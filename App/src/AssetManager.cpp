@@ -0,0 +1,264 @@
+#include "AssetManager.hpp"
+#include "Logger.hpp"
+#include "MeshQuantizer.hpp"
+#include "PipelineCache.hpp"
+#include "Profiler.hpp"
+#include "UploadManager.hpp"
+
+#include <algorithm>
+#include <cstring>
+#include <limits>
+
+namespace atcp {
+namespace {
+template<typename T>
+T Load(const unsigned char* source)
+{
+	T value;
+	std::memcpy(&value, source, sizeof(T));
+	return value;
+}
+
+// Decodes the positions the way the vertex shader does
+Aabb ComputePositionBounds(const MappedMesh& mapped)
+{
+	const MeshCacheHeader& header = mapped.Header();
+	const VertexAttributeFormat format = header.layout.attributes[0].format;
+	const unsigned char* vertex = static_cast<const unsigned char*>(mapped.VertexData()) + header.layout.attributes[0].offset;
+
+	const float infinity = std::numeric_limits<float>::infinity();
+	Aabb bounds = { { infinity, infinity, 0.0f }, { -infinity, -infinity, 0.0f } };
+	for (uint32_t v = 0; v < header.vertexCount; ++v, vertex += header.layout.stride)
+	{
+		float position[2];
+		for (int c = 0; c < 2; ++c)
+		{
+			switch (format)
+			{
+			case VertexAttributeFormat::Snorm16x2:
+				position[c] = std::max(Load<int16_t>(vertex + c * sizeof(int16_t)) / 32767.0f, -1.0f);
+				break;
+			case VertexAttributeFormat::Float16x2:
+				position[c] = MeshQuantizer::HalfToFloat(Load<uint16_t>(vertex + c * sizeof(uint16_t)));
+				break;
+			default:
+				position[c] = Load<float>(vertex + c * sizeof(float));
+				break;
+			}
+			position[c] = position[c] * header.positionTransform[c] + header.positionTransform[2 + c];
+		}
+		const Vec3 point = { position[0], position[1], 0.0f };
+		bounds = { Min(bounds.min, point), Max(bounds.max, point) };
+	}
+	return header.vertexCount > 0 ? bounds : Aabb();
+}
+}
+
+AssetManager::~AssetManager()
+{
+	Release();
+}
+
+void AssetManager::Init(GpuResources& resources, UploadManager& uploads, PipelineCache& pipelineCache, uint64_t maxBufferSize, uint64_t uploadBudget)
+{
+	Release();
+
+	m_Resources = &resources;
+	m_Uploads = &uploads;
+	m_PipelineCache = &pipelineCache;
+	m_MaxBufferSize = maxBufferSize;
+	// Writes are a multiple of 4 bytes, a smaller budget would never make progress
+	m_UploadBudget = uploadBudget == 0 ? 0 : std::max<uint64_t>(uploadBudget, 4);
+}
+
+void AssetManager::Release()
+{
+	WaitForLoads();
+
+	for (MeshEntry& mesh : m_Meshes)
+	{
+		m_Resources->Destroy(mesh.gpu.vertexBuffer);
+		m_Resources->Destroy(mesh.gpu.indexBuffer);
+	}
+	m_Meshes.clear();
+	m_Shaders.clear();
+	m_BytesUploaded = 0;
+}
+
+MeshHandle AssetManager::LoadMesh(const std::filesystem::path& sourcePath, const std::filesystem::path& cachePath, const MeshImportOptions& options)
+{
+	MeshEntry& mesh = m_Meshes.emplace_back();
+	mesh.sourcePath = sourcePath;
+	mesh.cachePath = cachePath;
+	mesh.options = options;
+
+	JobSystem::Run([&mesh] {
+		PROFILE_SCOPE("Load mesh");
+		if (MeshCache::LoadOrImport(mesh.sourcePath, mesh.cachePath, mesh.options, mesh.mapped))
+		{
+			mesh.gpu.bounds = ComputePositionBounds(mesh.mapped);
+			mesh.state.store(AssetState::Uploading, std::memory_order_release);
+		}
+		else
+		{
+			LOG_ERROR("Could not load mesh {0}", mesh.sourcePath.string());
+			mesh.state.store(AssetState::Failed, std::memory_order_release);
+		}
+	}, &m_Loads);
+
+	return MeshHandle{ static_cast<uint32_t>(m_Meshes.size() - 1) };
+}
+
+ShaderHandle AssetManager::LoadShader(const std::filesystem::path& path)
+{
+	ShaderEntry& shader = m_Shaders.emplace_back();
+	shader.path = path;
+
+	JobSystem::Run([&shader, pipelineCache = m_PipelineCache] {
+		PROFILE_SCOPE("Load shader");
+		if (pipelineCache->GetShaderModule(shader.path, &shader.hash))
+			shader.state.store(AssetState::Ready, std::memory_order_release);
+		else
+			shader.state.store(AssetState::Failed, std::memory_order_release);
+	}, &m_Loads);
+
+	return ShaderHandle{ static_cast<uint32_t>(m_Shaders.size() - 1) };
+}
+
+void AssetManager::Update()
+{
+	PROFILE_FUNCTION();
+
+	uint64_t budget = m_UploadBudget == 0 ? UINT64_MAX : m_UploadBudget;
+	m_BytesUploaded = 0;
+	for (MeshEntry& mesh : m_Meshes)
+	{
+		if (budget == 0)
+			break;
+		if (mesh.state.load(std::memory_order_acquire) != AssetState::Uploading)
+			continue;
+
+		if (!mesh.gpu.vertexBuffer.IsValid() && !CreateBuffers(mesh))
+		{
+			mesh.state.store(AssetState::Failed, std::memory_order_relaxed);
+			continue;
+		}
+
+		// Vertices then indices, as if they were one blob
+		const MeshCacheHeader& header = mesh.mapped.Header();
+		const uint64_t totalSize = header.vertexSize + header.indexSize;
+		while (mesh.uploadedBytes < totalSize && budget > 0)
+		{
+			const bool vertices = mesh.uploadedBytes < header.vertexSize;
+			const uint64_t regionSize = vertices ? header.vertexSize : header.indexSize;
+			const uint64_t offset = vertices ? mesh.uploadedBytes : mesh.uploadedBytes - header.vertexSize;
+
+			uint64_t count = std::min(regionSize - offset, budget);
+			// Every write but the last of a region stays a multiple of 4 so the next offset is aligned
+			if (count != regionSize - offset)
+				count &= ~uint64_t(3);
+			if (count == 0)
+				break;
+
+			const unsigned char* data = static_cast<const unsigned char*>(vertices ? mesh.mapped.VertexData() : mesh.mapped.IndexData());
+			if (!m_Uploads->Write(m_Resources->Get(vertices ? mesh.gpu.vertexBuffer : mesh.gpu.indexBuffer), offset, data + offset, count))
+				break;
+			mesh.uploadedBytes += count;
+			m_BytesUploaded += count;
+			budget -= count;
+		}
+
+		if (mesh.uploadedBytes == totalSize)
+		{
+			LOG_DEBUG("Uploaded {0}: {1} vertices and {2} {3}-bit indices", mesh.sourcePath.filename().string(),
+				mesh.gpu.vertexCount, mesh.gpu.indexCount, header.indexStride * 8);
+			// The GPU has its own copy now
+			mesh.mapped = MappedMesh();
+			mesh.state.store(AssetState::Ready, std::memory_order_relaxed);
+		}
+	}
+	PROFILE_COUNTER("Asset bytes uploaded", m_BytesUploaded);
+}
+
+void AssetManager::WaitForLoads()
+{
+	JobSystem::Wait(m_Loads);
+}
+
+AssetState AssetManager::GetState(MeshHandle mesh) const
+{
+	if (mesh.index >= m_Meshes.size())
+		return AssetState::Failed;
+	return m_Meshes[mesh.index].state.load(std::memory_order_acquire);
+}
+
+AssetState AssetManager::GetState(ShaderHandle shader) const
+{
+	if (shader.index >= m_Shaders.size())
+		return AssetState::Failed;
+	return m_Shaders[shader.index].state.load(std::memory_order_acquire);
+}
+
+const GpuMesh* AssetManager::GetMesh(MeshHandle mesh) const
+{
+	return GetState(mesh) == AssetState::Ready ? &m_Meshes[mesh.index].gpu : nullptr;
+}
+
+bool AssetManager::GetMeshLayout(MeshHandle mesh, MeshLayout& layout) const
+{
+	const AssetState state = GetState(mesh);
+	if (state == AssetState::Uploading)
+		layout = m_Meshes[mesh.index].mapped.Header().layout;
+	else if (state == AssetState::Ready)
+		layout = m_Meshes[mesh.index].gpu.layout;
+	else
+		return false;
+	return true;
+}
+
+uint64_t AssetManager::GetShaderHash(ShaderHandle shader) const
+{
+	return GetState(shader) == AssetState::Ready ? m_Shaders[shader.index].hash : 0;
+}
+
+bool AssetManager::IsIdle() const
+{
+	if (!m_Loads.IsDone())
+		return false;
+	return std::none_of(m_Meshes.begin(), m_Meshes.end(), [](const MeshEntry& mesh) {
+		return mesh.state.load(std::memory_order_acquire) == AssetState::Uploading;
+	});
+}
+
+bool AssetManager::CreateBuffers(MeshEntry& mesh)
+{
+	const MeshCacheHeader& header = mesh.mapped.Header();
+	if (header.vertexSize > m_MaxBufferSize || header.indexSize > m_MaxBufferSize)
+	{
+		LOG_ERROR("{0} needs a {1} byte buffer but the device supports at most {2}", mesh.sourcePath.string(),
+			std::max(header.vertexSize, header.indexSize), m_MaxBufferSize);
+		return false;
+	}
+
+	wgpu::BufferDescriptor bufferDesc;
+	bufferDesc.mappedAtCreation = false;
+
+	bufferDesc.label = "Vertex Buffer";
+	// Buffer sizes must be a multiple of 4 bytes
+	bufferDesc.size = (header.vertexSize + 3) & ~uint64_t(3);
+	bufferDesc.usage = wgpu::BufferUsage::CopyDst | wgpu::BufferUsage::Vertex;
+	mesh.gpu.vertexBuffer = m_Resources->CreateBuffer(bufferDesc);
+
+	bufferDesc.label = "Index Buffer";
+	bufferDesc.size = (header.indexSize + 3) & ~uint64_t(3);
+	bufferDesc.usage = wgpu::BufferUsage::CopyDst | wgpu::BufferUsage::Index;
+	mesh.gpu.indexBuffer = m_Resources->CreateBuffer(bufferDesc);
+
+	mesh.gpu.vertexCount = header.vertexCount;
+	mesh.gpu.indexCount = header.indexCount;
+	mesh.gpu.indexFormat = header.indexStride == sizeof(uint16_t) ? wgpu::IndexFormat::Uint16 : wgpu::IndexFormat::Uint32;
+	mesh.gpu.layout = header.layout;
+	std::copy(std::begin(header.positionTransform), std::end(header.positionTransform), mesh.gpu.positionTransform.begin());
+	return true;
+}
+}
@@ -0,0 +1,157 @@
+#include "AsyncLogSink.hpp"
+
+#include <chrono>
+
+namespace atcp {
+AsyncLogSink::AsyncLogSink(std::vector<spdlog::sink_ptr> sinks, size_t capacity, LogOverflowPolicy overflowPolicy)
+	: m_Sinks(std::move(sinks)), m_Queue(capacity), m_OverflowPolicy(overflowPolicy)
+{
+	// Reserve every payload up front so typical messages never allocate on the logging thread
+	for (size_t i = 0; i < m_Queue.Capacity(); ++i)
+	{
+		m_Queue.TryPush([](Record& record) { record.payload.reserve(ReservedPayloadSize); });
+	}
+	while (m_Queue.TryPop([](Record&) {}))
+	{
+	}
+
+	m_Worker = std::thread(&AsyncLogSink::WorkerThread, this);
+}
+
+AsyncLogSink::~AsyncLogSink()
+{
+	{
+		std::lock_guard<std::mutex> lock(m_WakeMutex);
+		m_Running.store(false);
+	}
+	m_WakeCondition.notify_one();
+	if (m_Worker.joinable())
+		m_Worker.join();
+}
+
+void AsyncLogSink::log(const spdlog::details::log_msg& msg)
+{
+	if (TryPush(msg))
+	{
+		m_Enqueued.fetch_add(1, std::memory_order_relaxed);
+	}
+	else
+	{
+		switch (m_OverflowPolicy)
+		{
+		case LogOverflowPolicy::Block:
+			m_Blocked.fetch_add(1, std::memory_order_relaxed);
+			do
+			{
+				m_WakeCondition.notify_one();
+				std::this_thread::yield();
+			} while (!TryPush(msg));
+			m_Enqueued.fetch_add(1, std::memory_order_relaxed);
+			break;
+		case LogOverflowPolicy::DropNewest:
+			m_Dropped.fetch_add(1, std::memory_order_relaxed);
+			break;
+		case LogOverflowPolicy::DropOldest:
+			do
+			{
+				if (m_Queue.TryPop([](Record&) {}))
+				{
+					m_Dropped.fetch_add(1, std::memory_order_relaxed);
+					m_Written.fetch_add(1, std::memory_order_relaxed);
+				}
+			} while (!TryPush(msg));
+			m_Enqueued.fetch_add(1, std::memory_order_relaxed);
+			break;
+		}
+	}
+
+	if (m_WorkerSleeping.load(std::memory_order_relaxed))
+		m_WakeCondition.notify_one();
+}
+
+void AsyncLogSink::flush()
+{
+	const uint64_t target = m_Enqueued.load(std::memory_order_acquire);
+	while (m_Written.load(std::memory_order_acquire) < target)
+	{
+		m_WakeCondition.notify_one();
+		std::this_thread::yield();
+	}
+}
+
+void AsyncLogSink::set_pattern(const std::string& pattern)
+{
+	for (auto& sink : m_Sinks)
+		sink->set_pattern(pattern);
+}
+
+void AsyncLogSink::set_formatter(std::unique_ptr<spdlog::formatter> sinkFormatter)
+{
+	for (auto& sink : m_Sinks)
+		sink->set_formatter(sinkFormatter->clone());
+}
+
+bool AsyncLogSink::TryPush(const spdlog::details::log_msg& msg)
+{
+	return m_Queue.TryPush([&msg](Record& record) {
+		record.time = msg.time;
+		record.source = msg.source;
+		record.level = msg.level;
+		record.threadId = msg.thread_id;
+		record.loggerName = msg.logger_name;
+		record.payload.assign(msg.payload.data(), msg.payload.size());
+	});
+}
+
+void AsyncLogSink::WorkerThread()
+{
+	for (;;)
+	{
+		if (WriteBatch() > 0)
+			continue;
+
+		if (!m_Running.load())
+		{
+			// Drain anything logged while shutting down
+			while (WriteBatch() > 0)
+			{
+			}
+			return;
+		}
+
+		// Producers only notify when they see the worker asleep, the timeout bounds a missed wake up
+		std::unique_lock<std::mutex> lock(m_WakeMutex);
+		m_WorkerSleeping.store(true);
+		m_WakeCondition.wait_for(lock, std::chrono::milliseconds(10), [this]() {
+			return !m_Running.load() || m_Written.load() < m_Enqueued.load();
+		});
+		m_WorkerSleeping.store(false);
+	}
+}
+
+size_t AsyncLogSink::WriteBatch()
+{
+	size_t count = 0;
+	while (count < MaxBatchSize && m_Queue.TryPop([this](Record& record) {
+		spdlog::details::log_msg msg(record.time, record.source, record.loggerName, record.level,
+			spdlog::string_view_t(record.payload.data(), record.payload.size()));
+		msg.thread_id = record.threadId;
+		for (auto& sink : m_Sinks)
+		{
+			if (sink->should_log(msg.level))
+				sink->log(msg);
+		}
+	}))
+	{
+		++count;
+	}
+
+	if (count > 0)
+	{
+		for (auto& sink : m_Sinks)
+			sink->flush();
+		m_Written.fetch_add(count, std::memory_order_release);
+	}
+	return count;
+}
+}
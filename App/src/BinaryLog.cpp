@@ -0,0 +1,191 @@
+#include "BinaryLog.hpp"
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstdio>
+#include <mutex>
+
+namespace atcp {
+namespace {
+constexpr size_t ThreadBufferSize = 64 * 1024;
+// Leave room for a typical message so the buffer rarely grows past its reservation
+constexpr size_t FlushThreshold = ThreadBufferSize - 4 * 1024;
+
+struct ThreadBuffer;
+
+std::mutex s_FileMutex;
+FILE* s_File = nullptr;
+uint64_t s_WrittenSize = 0;
+std::atomic<bool> s_Open{ false };
+std::atomic<uint32_t> s_NextSiteId{ 0 };
+std::atomic<uint32_t> s_NextThreadId{ 0 };
+std::vector<ThreadBuffer*> s_ThreadBuffers;
+
+void WriteToFile(const std::vector<char>& data)
+{
+	if (s_File && !data.empty())
+		s_WrittenSize += std::fwrite(data.data(), 1, data.size(), s_File);
+}
+
+struct ThreadBuffer {
+	// Held by the owning thread while it appends a message, so other threads can flush the buffer
+	std::mutex mutex;
+	std::vector<char> data;
+	uint32_t threadId;
+
+	ThreadBuffer()
+		: threadId(s_NextThreadId.fetch_add(1))
+	{
+		data.reserve(ThreadBufferSize);
+		std::lock_guard<std::mutex> lock(s_FileMutex);
+		s_ThreadBuffers.push_back(this);
+	}
+
+	~ThreadBuffer()
+	{
+		std::lock_guard<std::mutex> lock(s_FileMutex);
+		WriteToFile(data);
+		s_ThreadBuffers.erase(std::remove(s_ThreadBuffers.begin(), s_ThreadBuffers.end(), this), s_ThreadBuffers.end());
+	}
+
+	// The file mutex must be held
+	void Flush()
+	{
+		// Swap the messages out so the owning thread is only blocked for the swap, not the write
+		std::vector<char> pending;
+		pending.reserve(ThreadBufferSize);
+		{
+			std::lock_guard<std::mutex> lock(mutex);
+			pending.swap(data);
+		}
+		WriteToFile(pending);
+	}
+};
+
+ThreadBuffer& GetThreadBuffer()
+{
+	thread_local ThreadBuffer buffer;
+	return buffer;
+}
+
+// The file mutex must be held
+void FlushThreadBuffers()
+{
+	for (ThreadBuffer* buffer : s_ThreadBuffers)
+		buffer->Flush();
+}
+
+template<typename T>
+void AppendValue(std::vector<char>& buffer, const T& value)
+{
+	const char* bytes = reinterpret_cast<const char*>(&value);
+	buffer.insert(buffer.end(), bytes, bytes + sizeof(T));
+}
+} // namespace
+
+bool BinaryLog::Open(const std::filesystem::path& path, const std::string& loggerName)
+{
+	Close();
+
+	std::lock_guard<std::mutex> lock(s_FileMutex);
+	s_File = std::fopen(path.string().c_str(), "wb");
+	if (!s_File)
+		return false;
+	s_WrittenSize = 0;
+
+	std::vector<char> header;
+	header.insert(header.end(), BinaryLogMagic, BinaryLogMagic + sizeof(BinaryLogMagic));
+	AppendValue(header, BinaryLogVersion);
+	AppendValue(header, static_cast<uint32_t>(loggerName.size()));
+	header.insert(header.end(), loggerName.begin(), loggerName.end());
+	WriteToFile(header);
+
+	s_Open.store(true, std::memory_order_release);
+	return true;
+}
+
+void BinaryLog::Close()
+{
+	s_Open.store(false, std::memory_order_release);
+
+	std::lock_guard<std::mutex> lock(s_FileMutex);
+	FlushThreadBuffers();
+	if (s_File)
+	{
+		std::fclose(s_File);
+		s_File = nullptr;
+	}
+}
+
+void BinaryLog::Flush()
+{
+	std::lock_guard<std::mutex> lock(s_FileMutex);
+	FlushThreadBuffers();
+	if (s_File)
+		std::fflush(s_File);
+}
+
+uint64_t BinaryLog::GetWrittenSize()
+{
+	std::lock_guard<std::mutex> lock(s_FileMutex);
+	return s_WrittenSize;
+}
+
+bool BinaryLog::IsOpen()
+{
+	return s_Open.load(std::memory_order_relaxed);
+}
+
+uint32_t BinaryLog::RegisterSite(spdlog::level::level_enum level, const char* file, int line, const char* format, const uint8_t* argTypes, size_t argCount)
+{
+	const uint32_t siteId = s_NextSiteId.fetch_add(1);
+	std::string_view fileName(file ? file : "");
+	std::string_view formatString(format ? format : "");
+
+	std::vector<char> record;
+	AppendValue(record, static_cast<uint8_t>(BinaryLogRecord::Site));
+	AppendValue(record, siteId);
+	AppendValue(record, static_cast<uint8_t>(level));
+	AppendValue(record, static_cast<uint32_t>(line));
+	AppendValue(record, static_cast<uint8_t>(argCount));
+	record.insert(record.end(), argTypes, argTypes + argCount);
+	AppendValue(record, static_cast<uint32_t>(fileName.size()));
+	record.insert(record.end(), fileName.begin(), fileName.end());
+	AppendValue(record, static_cast<uint32_t>(formatString.size()));
+	record.insert(record.end(), formatString.begin(), formatString.end());
+
+	// Written straight to the file so it always precedes the site's messages, which sit in thread buffers
+	std::lock_guard<std::mutex> lock(s_FileMutex);
+	WriteToFile(record);
+	return siteId;
+}
+
+std::vector<char>& BinaryLog::BeginMessage(uint32_t siteId)
+{
+	ThreadBuffer& buffer = GetThreadBuffer();
+	buffer.mutex.lock();
+	const int64_t timestamp = std::chrono::duration_cast<std::chrono::nanoseconds>(
+		std::chrono::system_clock::now().time_since_epoch()).count();
+
+	AppendValue(buffer.data, static_cast<uint8_t>(BinaryLogRecord::Message));
+	AppendValue(buffer.data, siteId);
+	AppendValue(buffer.data, timestamp);
+	AppendValue(buffer.data, buffer.threadId);
+	return buffer.data;
+}
+
+void BinaryLog::EndMessage()
+{
+	ThreadBuffer& buffer = GetThreadBuffer();
+	const bool full = buffer.data.size() >= FlushThreshold;
+	buffer.mutex.unlock();
+
+	// Always the file mutex before a buffer's, like Flush and Close
+	if (full)
+	{
+		std::lock_guard<std::mutex> lock(s_FileMutex);
+		buffer.Flush();
+	}
+}
+}
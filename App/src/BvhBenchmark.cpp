@@ -0,0 +1,163 @@
+#include "BvhBenchmark.hpp"
+#include "DynamicBvh.hpp"
+#include "JobSystem.hpp"
+#include "Logger.hpp"
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <random>
+#include <vector>
+
+namespace atcp {
+namespace {
+using Clock = std::chrono::steady_clock;
+
+constexpr uint32_t ObjectCount = 100000;
+constexpr uint32_t Frames = 100;
+constexpr float TimeStep = 1.0f / 60.0f;
+// Removed and inserted again every frame
+constexpr uint32_t ReinsertedPerFrame = ObjectCount / 100;
+// Objects spread over a world 4 times wider and taller than the view, so most are culled
+constexpr float WorldHalfSize = 4.0f;
+constexpr uint32_t BoundsGrain = 1024;
+
+// Orbits like the instances drawn by shader.wgsl
+struct MovingObject {
+	Vec3 centre;
+	float radius;
+	float halfSize;
+	float speed;
+	float phase;
+};
+
+double SecondsSince(Clock::time_point start)
+{
+	return std::chrono::duration<double>(Clock::now() - start).count();
+}
+
+Aabb GetBounds(const MovingObject& object, float time)
+{
+	const float angle = time * object.speed + object.phase;
+	const Vec3 centre = object.centre + Vec3{ std::cos(angle), std::sin(angle), 0.0f } * object.radius;
+	const Vec3 halfSize = { object.halfSize, object.halfSize, 0.0f };
+	return { centre - halfSize, centre + halfSize };
+}
+
+struct Timings {
+	double bounds = 0.0;
+	double reinsert = 0.0;
+	double update = 0.0;
+	double query = 0.0;
+	double parallelQuery = 0.0;
+	double bruteForce = 0.0;
+};
+}
+
+int BvhBenchmark::Run()
+{
+	std::mt19937 random(1234);
+	std::uniform_real_distribution<float> position(-WorldHalfSize, WorldHalfSize);
+	std::uniform_real_distribution<float> size(0.002f, 0.02f);
+	std::uniform_real_distribution<float> speed(-2.0f, 2.0f);
+	std::uniform_real_distribution<float> phase(0.0f, 6.2831853f);
+
+	std::vector<MovingObject> objects(ObjectCount);
+	for (MovingObject& object : objects)
+	{
+		// The shader orbits at 0.3 of the scale and the placeholder quad reaches 0.5 of it from its centre
+		const float halfSize = size(random);
+		object = { { position(random), position(random), 0.0f }, 0.6f * halfSize, halfSize, speed(random), phase(random) };
+	}
+
+	std::vector<Aabb> bounds(ObjectCount);
+	for (uint32_t i = 0; i < ObjectCount; ++i)
+		bounds[i] = GetBounds(objects[i], 0.0f);
+
+	DynamicBvh bvh;
+	std::vector<uint32_t> leaves(ObjectCount);
+	auto startTime = Clock::now();
+	bvh.Build(bounds.data(), ObjectCount, leaves.data());
+	LOG_INFO("Built a tree over {0} objects in {1:.2f} ms, cost {2:.1f}", ObjectCount, SecondsSince(startTime) * 1000.0, bvh.GetCost());
+
+	const Aabb view = { { -1.0f, -1.0f, 0.0f }, { 1.0f, 1.0f, 0.0f } };
+	std::vector<uint8_t> visible(ObjectCount);
+	std::vector<uint8_t> expected(ObjectCount);
+	Timings total;
+	uint64_t visibleTotal = 0;
+	uint32_t failures = 0;
+	uint32_t reinsertNext = 0;
+
+	for (uint32_t frame = 1; frame <= Frames; ++frame)
+	{
+		const float time = frame * TimeStep;
+
+		startTime = Clock::now();
+		JobSystem::ParallelFor(ObjectCount, [&](uint32_t begin, uint32_t end) {
+			for (uint32_t i = begin; i < end; ++i)
+			{
+				bounds[i] = GetBounds(objects[i], time);
+				bvh.SetBounds(leaves[i], bounds[i]);
+			}
+		}, BoundsGrain);
+		total.bounds += SecondsSince(startTime);
+
+		startTime = Clock::now();
+		for (uint32_t n = 0; n < ReinsertedPerFrame; ++n)
+		{
+			const uint32_t i = reinsertNext;
+			reinsertNext = (reinsertNext + 1) % ObjectCount;
+			bvh.Remove(leaves[i]);
+			leaves[i] = bvh.Insert(bounds[i], i);
+		}
+		total.reinsert += SecondsSince(startTime);
+
+		startTime = Clock::now();
+		bvh.Update();
+		total.update += SecondsSince(startTime);
+
+		startTime = Clock::now();
+		uint32_t visibleCount = 0;
+		bvh.Query(view, [&visibleCount](uint32_t) { ++visibleCount; });
+		total.query += SecondsSince(startTime);
+
+		std::fill(visible.begin(), visible.end(), uint8_t(0));
+		startTime = Clock::now();
+		bvh.ParallelQuery(view, [&visible](uint32_t index) { visible[index] = 1; });
+		total.parallelQuery += SecondsSince(startTime);
+
+		startTime = Clock::now();
+		for (uint32_t i = 0; i < ObjectCount; ++i)
+			expected[i] = Overlaps(bounds[i], view) ? 1 : 0;
+		total.bruteForce += SecondsSince(startTime);
+
+		uint32_t expectedCount = 0;
+		for (uint32_t i = 0; i < ObjectCount; ++i)
+		{
+			expectedCount += expected[i];
+			if (visible[i] != expected[i])
+				++failures;
+		}
+		if (visibleCount != expectedCount)
+			++failures;
+		visibleTotal += expectedCount;
+	}
+
+	const double milliseconds = 1000.0 / Frames;
+	const double averageVisible = static_cast<double>(visibleTotal) / Frames;
+	LOG_INFO("{0} moving objects, {1:.0f} visible and {2:.0f} culled per frame on average, {3} threads", ObjectCount,
+		averageVisible, ObjectCount - averageVisible, JobSystem::GetThreadCount());
+	LOG_INFO("Per frame: move {0:.3f} ms, reinsert {1} {2:.3f} ms, refit or rebuild {3:.3f} ms ({4} rebuilds, cost {5:.1f})",
+		total.bounds * milliseconds, ReinsertedPerFrame, total.reinsert * milliseconds, total.update * milliseconds,
+		bvh.GetRebuildCount(), bvh.GetCost());
+	LOG_INFO("Per frame: query {0:.3f} ms, parallel query {1:.3f} ms, testing every box {2:.3f} ms",
+		total.query * milliseconds, total.parallelQuery * milliseconds, total.bruteForce * milliseconds);
+
+	if (failures != 0)
+	{
+		LOG_ERROR("BVH queries disagreed with testing every box {0} times", failures);
+		return 1;
+	}
+	return 0;
+}
+}
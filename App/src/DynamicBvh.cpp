@@ -0,0 +1,361 @@
+#include "DynamicBvh.hpp"
+
+#include <algorithm>
+#include <limits>
+
+namespace atcp {
+namespace {
+float GetAxis(const Vec3& v, int axis)
+{
+	return axis == 0 ? v.x : axis == 1 ? v.y : v.z;
+}
+
+Vec3 GetCentre(const Aabb& box)
+{
+	return (box.min + box.max) * 0.5f;
+}
+
+Aabb EmptyBounds()
+{
+	const float infinity = std::numeric_limits<float>::infinity();
+	return { { infinity, infinity, infinity }, { -infinity, -infinity, -infinity } };
+}
+}
+
+void DynamicBvh::Build(const Aabb* bounds, uint32_t count, uint32_t* leaves)
+{
+	Clear();
+	if (count == 0)
+		return;
+
+	m_Nodes.reserve(2 * count - 1);
+	m_BuildItems.clear();
+	m_BuildItems.reserve(count);
+	for (uint32_t i = 0; i < count; ++i)
+	{
+		leaves[i] = AllocateNode();
+		m_Nodes[leaves[i]].bounds = bounds[i];
+		m_Nodes[leaves[i]].userData = i;
+		m_BuildItems.push_back({ bounds[i], GetCentre(bounds[i]), leaves[i] });
+	}
+	m_LeafCount = count;
+	BuildRoot();
+}
+
+uint32_t DynamicBvh::Insert(const Aabb& bounds, uint32_t userData)
+{
+	const uint32_t leaf = AllocateNode();
+	m_Nodes[leaf].bounds = bounds;
+	m_Nodes[leaf].userData = userData;
+	InsertLeaf(leaf);
+	++m_LeafCount;
+	return leaf;
+}
+
+void DynamicBvh::Remove(uint32_t leaf)
+{
+	RemoveLeaf(leaf);
+	FreeNode(leaf);
+	--m_LeafCount;
+}
+
+bool DynamicBvh::Update()
+{
+	Refit();
+	if (m_Cost <= m_RebuiltCost * RebuildCostRatio)
+		return false;
+	Rebuild();
+	return true;
+}
+
+void DynamicBvh::Refit()
+{
+	m_Cost = 0.0f;
+	if (m_Root == NullNode)
+		return;
+
+	m_RefitOrder.clear();
+	if (!m_Nodes[m_Root].IsLeaf())
+		m_RefitOrder.push_back(m_Root);
+	for (size_t i = 0; i < m_RefitOrder.size(); ++i)
+	{
+		for (uint32_t child : m_Nodes[m_RefitOrder[i]].children)
+		{
+			if (!m_Nodes[child].IsLeaf())
+				m_RefitOrder.push_back(child);
+		}
+	}
+
+	// Children come after their parent so walking backwards refits them first
+	float internalArea = 0.0f;
+	for (auto it = m_RefitOrder.rbegin(); it != m_RefitOrder.rend(); ++it)
+	{
+		Node& node = m_Nodes[*it];
+		node.bounds = Union(m_Nodes[node.children[0]].bounds, m_Nodes[node.children[1]].bounds);
+		internalArea += HalfArea(node.bounds);
+	}
+
+	const float rootArea = HalfArea(m_Nodes[m_Root].bounds);
+	m_Cost = rootArea > 0.0f ? internalArea / rootArea : 0.0f;
+}
+
+void DynamicBvh::Rebuild()
+{
+	if (m_Root == NullNode)
+		return;
+
+	m_BuildItems.clear();
+	m_BuildItems.reserve(m_LeafCount);
+	std::vector<uint32_t> stack = { m_Root };
+	while (!stack.empty())
+	{
+		const uint32_t index = stack.back();
+		stack.pop_back();
+		if (m_Nodes[index].IsLeaf())
+		{
+			m_BuildItems.push_back({ m_Nodes[index].bounds, GetCentre(m_Nodes[index].bounds), index });
+			continue;
+		}
+		stack.push_back(m_Nodes[index].children[0]);
+		stack.push_back(m_Nodes[index].children[1]);
+		FreeNode(index);
+	}
+
+	BuildRoot();
+	++m_RebuildCount;
+}
+
+void DynamicBvh::Clear()
+{
+	m_Nodes.clear();
+	m_Root = NullNode;
+	m_FreeList = NullNode;
+	m_LeafCount = 0;
+	m_Cost = 0.0f;
+	m_RebuiltCost = 0.0f;
+}
+
+uint32_t DynamicBvh::AllocateNode()
+{
+	if (m_FreeList == NullNode)
+	{
+		m_Nodes.emplace_back();
+		return static_cast<uint32_t>(m_Nodes.size() - 1);
+	}
+
+	const uint32_t node = m_FreeList;
+	m_FreeList = m_Nodes[node].parent;
+	m_Nodes[node] = Node();
+	return node;
+}
+
+void DynamicBvh::FreeNode(uint32_t node)
+{
+	m_Nodes[node] = Node();
+	m_Nodes[node].parent = m_FreeList;
+	m_FreeList = node;
+}
+
+// Picks the sibling the way Box2D's dynamic tree does, descending while a child is cheaper than pairing here
+void DynamicBvh::InsertLeaf(uint32_t leaf)
+{
+	if (m_Root == NullNode)
+	{
+		m_Root = leaf;
+		m_Nodes[leaf].parent = NullNode;
+		return;
+	}
+
+	const Aabb bounds = m_Nodes[leaf].bounds;
+	uint32_t sibling = m_Root;
+	while (!m_Nodes[sibling].IsLeaf())
+	{
+		const Node& node = m_Nodes[sibling];
+		const float area = HalfArea(node.bounds);
+		const float combinedArea = HalfArea(Union(node.bounds, bounds));
+		// A new parent of this node and the leaf
+		const float cost = 2.0f * combinedArea;
+		// This node grows whichever child the leaf goes under
+		const float inheritedCost = 2.0f * (combinedArea - area);
+
+		float childCosts[2];
+		for (int c = 0; c < 2; ++c)
+		{
+			const Node& child = m_Nodes[node.children[c]];
+			const float enlargedArea = HalfArea(Union(child.bounds, bounds));
+			childCosts[c] = (child.IsLeaf() ? enlargedArea : enlargedArea - HalfArea(child.bounds)) + inheritedCost;
+		}
+
+		if (cost < childCosts[0] && cost < childCosts[1])
+			break;
+		sibling = node.children[childCosts[1] < childCosts[0] ? 1 : 0];
+	}
+
+	const uint32_t oldParent = m_Nodes[sibling].parent;
+	const uint32_t newParent = AllocateNode();
+	m_Nodes[newParent].parent = oldParent;
+	m_Nodes[newParent].children = { sibling, leaf };
+	m_Nodes[newParent].bounds = Union(m_Nodes[sibling].bounds, bounds);
+	m_Nodes[sibling].parent = newParent;
+	m_Nodes[leaf].parent = newParent;
+
+	if (oldParent == NullNode)
+	{
+		m_Root = newParent;
+		return;
+	}
+	Node& parent = m_Nodes[oldParent];
+	parent.children[parent.children[0] == sibling ? 0 : 1] = newParent;
+	RefitAncestors(oldParent);
+}
+
+void DynamicBvh::RemoveLeaf(uint32_t leaf)
+{
+	if (leaf == m_Root)
+	{
+		m_Root = NullNode;
+		return;
+	}
+
+	// The leaf's sibling takes its parent's place
+	const uint32_t parent = m_Nodes[leaf].parent;
+	const uint32_t grandParent = m_Nodes[parent].parent;
+	const uint32_t sibling = m_Nodes[parent].children[m_Nodes[parent].children[0] == leaf ? 1 : 0];
+	FreeNode(parent);
+	m_Nodes[sibling].parent = grandParent;
+
+	if (grandParent == NullNode)
+	{
+		m_Root = sibling;
+		return;
+	}
+	Node& node = m_Nodes[grandParent];
+	node.children[node.children[0] == parent ? 0 : 1] = sibling;
+	RefitAncestors(grandParent);
+}
+
+void DynamicBvh::RefitAncestors(uint32_t node)
+{
+	for (; node != NullNode; node = m_Nodes[node].parent)
+		m_Nodes[node].bounds = Union(m_Nodes[m_Nodes[node].children[0]].bounds, m_Nodes[m_Nodes[node].children[1]].bounds);
+}
+
+// Splits along the longest axis of the leaves' centres, at the bin boundary with the lowest surface area cost
+uint32_t DynamicBvh::BuildSubtree(BuildItem* items, uint32_t count)
+{
+	if (count == 1)
+		return items[0].leaf;
+
+	Aabb centres = EmptyBounds();
+	for (uint32_t i = 0; i < count; ++i)
+		centres = Union(centres, { items[i].centre, items[i].centre });
+	const Vec3 size = centres.max - centres.min;
+	const int axis = size.x >= size.y && size.x >= size.z ? 0 : size.y >= size.z ? 1 : 2;
+	const float axisMin = GetAxis(centres.min, axis);
+	const float axisSize = GetAxis(size, axis);
+
+	uint32_t leftCount = 0;
+	if (axisSize > 0.0f)
+	{
+		struct Bin {
+			Aabb bounds = EmptyBounds();
+			uint32_t count = 0;
+		};
+		std::array<Bin, SahBins> bins;
+		auto getBin = [&](const BuildItem& item) {
+			const float t = (GetAxis(item.centre, axis) - axisMin) / axisSize;
+			return std::min(static_cast<uint32_t>(t * SahBins), SahBins - 1);
+		};
+		for (uint32_t i = 0; i < count; ++i)
+		{
+			Bin& bin = bins[getBin(items[i])];
+			bin.bounds = Union(bin.bounds, items[i].bounds);
+			++bin.count;
+		}
+
+		// Cost of the leaves right of each split, swept from the right
+		std::array<float, SahBins> rightCosts{};
+		Aabb rightBounds = EmptyBounds();
+		uint32_t rightCount = 0;
+		for (uint32_t b = SahBins - 1; b > 0; --b)
+		{
+			rightBounds = Union(rightBounds, bins[b].bounds);
+			rightCount += bins[b].count;
+			rightCosts[b] = rightCount > 0 ? HalfArea(rightBounds) * rightCount : 0.0f;
+		}
+
+		float bestCost = std::numeric_limits<float>::max();
+		uint32_t bestSplit = 0;
+		Aabb leftBounds = EmptyBounds();
+		uint32_t leftSum = 0;
+		for (uint32_t b = 1; b < SahBins; ++b)
+		{
+			leftBounds = Union(leftBounds, bins[b - 1].bounds);
+			leftSum += bins[b - 1].count;
+			if (leftSum == 0 || leftSum == count)
+				continue;
+			const float cost = HalfArea(leftBounds) * leftSum + rightCosts[b];
+			if (cost < bestCost)
+			{
+				bestCost = cost;
+				bestSplit = b;
+			}
+		}
+
+		if (bestSplit != 0)
+			leftCount = static_cast<uint32_t>(std::partition(items, items + count, [&](const BuildItem& item) { return getBin(item) < bestSplit; }) - items);
+	}
+
+	// Every centre in one place, or in one bin, split the leaves in half
+	if (leftCount == 0 || leftCount == count)
+	{
+		leftCount = count / 2;
+		std::nth_element(items, items + leftCount, items + count, [axis](const BuildItem& a, const BuildItem& b) {
+			return GetAxis(a.centre, axis) < GetAxis(b.centre, axis);
+		});
+	}
+
+	const uint32_t left = BuildSubtree(items, leftCount);
+	const uint32_t right = BuildSubtree(items + leftCount, count - leftCount);
+	const uint32_t node = AllocateNode();
+	m_Nodes[node].children = { left, right };
+	m_Nodes[node].bounds = Union(m_Nodes[left].bounds, m_Nodes[right].bounds);
+	m_Nodes[left].parent = node;
+	m_Nodes[right].parent = node;
+	return node;
+}
+
+void DynamicBvh::BuildRoot()
+{
+	m_Root = BuildSubtree(m_BuildItems.data(), static_cast<uint32_t>(m_BuildItems.size()));
+	m_Nodes[m_Root].parent = NullNode;
+	Refit();
+	m_RebuiltCost = m_Cost;
+}
+
+std::vector<uint32_t> DynamicBvh::GetSubtrees(const Aabb& region, uint32_t target) const
+{
+	std::vector<uint32_t> subtrees;
+	if (m_Root == NullNode)
+		return subtrees;
+
+	// Breadth first, so the subtrees are of similar size
+	std::vector<uint32_t> queue = { m_Root };
+	size_t head = 0;
+	while (head < queue.size() && subtrees.size() + (queue.size() - head) < target)
+	{
+		const Node& node = m_Nodes[queue[head++]];
+		if (!Overlaps(node.bounds, region))
+			continue;
+		if (node.IsLeaf() || Contains(region, node.bounds))
+		{
+			subtrees.push_back(queue[head - 1]);
+			continue;
+		}
+		queue.push_back(node.children[0]);
+		queue.push_back(node.children[1]);
+	}
+	subtrees.insert(subtrees.end(), queue.begin() + head, queue.end());
+	return subtrees;
+}
+}
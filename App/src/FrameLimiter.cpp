@@ -0,0 +1,38 @@
+#include "FrameLimiter.hpp"
+#include "Profiler.hpp"
+
+#include <thread>
+
+namespace atcp {
+void FrameLimiter::SetTargetRate(double framesPerSecond)
+{
+	m_TargetRate = framesPerSecond > 0.0 ? framesPerSecond : 0.0;
+	m_Period = m_TargetRate > 0.0
+		? std::chrono::duration_cast<Clock::duration>(std::chrono::duration<double>(1.0 / m_TargetRate))
+		: Clock::duration::zero();
+	m_NextFrame = Clock::time_point();
+}
+
+void FrameLimiter::Wait()
+{
+	if (m_Period == Clock::duration::zero())
+		return;
+
+	PROFILE_FUNCTION();
+
+	Clock::time_point now = Clock::now();
+	if (m_NextFrame == Clock::time_point() || now - m_NextFrame > m_Period)
+	{
+		// First frame, or a full period behind: start again from now rather than rushing frames to catch up
+		m_NextFrame = now + m_Period;
+		return;
+	}
+
+	if (m_NextFrame - now > SpinThreshold)
+		std::this_thread::sleep_for(m_NextFrame - now - SpinThreshold);
+	while (Clock::now() < m_NextFrame)
+		std::this_thread::yield();
+
+	m_NextFrame += m_Period;
+}
+}
@@ -0,0 +1,273 @@
+#include "GpuResources.hpp"
+#include "Logger.hpp"
+
+namespace atcp {
+namespace {
+void ReleaseResource(wgpu::Buffer buffer)
+{
+	// Frees the memory now rather than whenever the last reference goes
+	buffer.destroy();
+	buffer.release();
+}
+
+template<typename Resource>
+void ReleaseResource(Resource resource)
+{
+	resource.release();
+}
+
+const char* TypeName(GpuResourceType type)
+{
+	switch (type)
+	{
+	case GpuResourceType::Buffer: return "buffers";
+	case GpuResourceType::BindGroup: return "bind groups";
+	case GpuResourceType::RenderPipeline: return "render pipelines";
+	case GpuResourceType::ShaderModule: return "shader modules";
+	default: return "unknown";
+	}
+}
+}
+
+GpuResources::~GpuResources()
+{
+	Release();
+}
+
+void GpuResources::Init(wgpu::Device device, wgpu::Queue queue)
+{
+	Release();
+	m_Device = device;
+	m_Queue = queue;
+}
+
+void GpuResources::Release()
+{
+	// Frame callbacks still pending would be called after this is destroyed, and would tell when the GPU is idle
+	while (m_CompletedFrames.load(std::memory_order_acquire) < m_FrameCount && Poll())
+	{
+	}
+
+	std::lock_guard<std::mutex> lock(m_Mutex);
+	ReleaseLive(m_Buffers);
+	ReleaseLive(m_BindGroups);
+	ReleaseLive(m_RenderPipelines);
+	ReleaseLive(m_ShaderModules);
+	CollectAll(true);
+	m_FrameCallbacks.clear();
+}
+
+BufferHandle GpuResources::CreateBuffer(const wgpu::BufferDescriptor& desc)
+{
+	return Add(m_Device.createBuffer(desc));
+}
+
+BindGroupHandle GpuResources::CreateBindGroup(const wgpu::BindGroupDescriptor& desc)
+{
+	wgpu::BindGroup bindGroup = m_Device.createBindGroup(desc);
+	std::lock_guard<std::mutex> lock(m_Mutex);
+	return AddTo(m_BindGroups, bindGroup, 0);
+}
+
+BufferHandle GpuResources::Add(wgpu::Buffer buffer)
+{
+	const uint64_t size = buffer ? buffer.getSize() : 0;
+	std::lock_guard<std::mutex> lock(m_Mutex);
+	return AddTo(m_Buffers, buffer, size);
+}
+
+RenderPipelineHandle GpuResources::Add(wgpu::RenderPipeline pipeline)
+{
+	std::lock_guard<std::mutex> lock(m_Mutex);
+	return AddTo(m_RenderPipelines, pipeline, 0);
+}
+
+ShaderModuleHandle GpuResources::Add(wgpu::ShaderModule shaderModule)
+{
+	std::lock_guard<std::mutex> lock(m_Mutex);
+	return AddTo(m_ShaderModules, shaderModule, 0);
+}
+
+wgpu::Buffer GpuResources::Get(BufferHandle handle) const
+{
+	return GetFrom(m_Buffers, handle);
+}
+
+wgpu::BindGroup GpuResources::Get(BindGroupHandle handle) const
+{
+	return GetFrom(m_BindGroups, handle);
+}
+
+wgpu::RenderPipeline GpuResources::Get(RenderPipelineHandle handle) const
+{
+	return GetFrom(m_RenderPipelines, handle);
+}
+
+wgpu::ShaderModule GpuResources::Get(ShaderModuleHandle handle) const
+{
+	return GetFrom(m_ShaderModules, handle);
+}
+
+void GpuResources::Destroy(BufferHandle handle)
+{
+	DestroyIn(m_Buffers, handle);
+}
+
+void GpuResources::Destroy(BindGroupHandle handle)
+{
+	DestroyIn(m_BindGroups, handle);
+}
+
+void GpuResources::Destroy(RenderPipelineHandle handle)
+{
+	DestroyIn(m_RenderPipelines, handle);
+}
+
+void GpuResources::Destroy(ShaderModuleHandle handle)
+{
+	DestroyIn(m_ShaderModules, handle);
+}
+
+void GpuResources::EndFrame()
+{
+	std::lock_guard<std::mutex> lock(m_Mutex);
+
+	// Work is done in submission order, so one callback per frame tells how many frames have completed
+	const uint64_t frame = m_FrameCount++;
+	m_FrameCallbacks.push_back(m_Queue.onSubmittedWorkDone([this, frame](wgpu::QueueWorkDoneStatus) {
+		m_CompletedFrames.store(frame + 1, std::memory_order_release);
+	}));
+
+	const uint64_t completedFrames = m_CompletedFrames.load(std::memory_order_acquire);
+	while (!m_FrameCallbacks.empty() && m_FrameCount - m_FrameCallbacks.size() < completedFrames)
+		m_FrameCallbacks.pop_front();
+
+	CollectAll(false);
+}
+
+GpuResourceStats GpuResources::GetStats(GpuResourceType type) const
+{
+	std::lock_guard<std::mutex> lock(m_Mutex);
+	GpuResourceStats stats = m_Stats[static_cast<size_t>(type)];
+	switch (type)
+	{
+	case GpuResourceType::Buffer:
+		stats.live = m_Buffers.live.Size();
+		stats.pending = static_cast<uint32_t>(m_Buffers.retired.size());
+		break;
+	case GpuResourceType::BindGroup:
+		stats.live = m_BindGroups.live.Size();
+		stats.pending = static_cast<uint32_t>(m_BindGroups.retired.size());
+		break;
+	case GpuResourceType::RenderPipeline:
+		stats.live = m_RenderPipelines.live.Size();
+		stats.pending = static_cast<uint32_t>(m_RenderPipelines.retired.size());
+		break;
+	case GpuResourceType::ShaderModule:
+		stats.live = m_ShaderModules.live.Size();
+		stats.pending = static_cast<uint32_t>(m_ShaderModules.retired.size());
+		break;
+	default:
+		break;
+	}
+	return stats;
+}
+
+void GpuResources::LogStats() const
+{
+	for (size_t i = 0; i < static_cast<size_t>(GpuResourceType::Count); ++i)
+	{
+		const GpuResourceType type = static_cast<GpuResourceType>(i);
+		[[maybe_unused]] const GpuResourceStats stats = GetStats(type);
+		LOG_DEBUG("GPU {0}: {1} live ({2:.2f} MB), {3} waiting for the GPU, {4} created, {5} destroyed", TypeName(type),
+			stats.live, stats.liveBytes / 1e6, stats.pending, stats.created, stats.destroyed);
+	}
+}
+
+template<typename Resource, typename HandleType>
+HandleType GpuResources::AddTo(Pool<Resource, HandleType>& pool, Resource resource, uint64_t size)
+{
+	if (!resource)
+		return HandleType();
+
+	GpuResourceStats& stats = m_Stats[static_cast<size_t>(pool.type)];
+	++stats.created;
+	stats.liveBytes += size;
+	return pool.live.Add({ resource, size });
+}
+
+template<typename Resource, typename HandleType>
+Resource GpuResources::GetFrom(const Pool<Resource, HandleType>& pool, HandleType handle) const
+{
+	std::lock_guard<std::mutex> lock(m_Mutex);
+	const Entry<Resource>* entry = pool.live.Get(handle);
+	return entry ? entry->resource : nullptr;
+}
+
+template<typename Resource, typename HandleType>
+void GpuResources::DestroyIn(Pool<Resource, HandleType>& pool, HandleType handle)
+{
+	std::lock_guard<std::mutex> lock(m_Mutex);
+	Entry<Resource> entry;
+	if (!pool.live.Remove(handle, entry))
+		return;
+
+	// Frames up to and including the one being recorded may still use it
+	pool.retired.push_back({ entry.resource, entry.size, m_FrameCount + 1 });
+	m_Stats[static_cast<size_t>(pool.type)].liveBytes -= entry.size;
+}
+
+template<typename Resource, typename HandleType>
+void GpuResources::Collect(Pool<Resource, HandleType>& pool, bool all)
+{
+	const uint64_t completedFrames = m_CompletedFrames.load(std::memory_order_acquire);
+	GpuResourceStats& stats = m_Stats[static_cast<size_t>(pool.type)];
+	for (size_t i = 0; i < pool.retired.size();)
+	{
+		if (!all && pool.retired[i].frame > completedFrames)
+		{
+			++i;
+			continue;
+		}
+		ReleaseResource(pool.retired[i].resource);
+		++stats.destroyed;
+		pool.retired[i] = pool.retired.back();
+		pool.retired.pop_back();
+	}
+}
+
+template<typename Resource, typename HandleType>
+void GpuResources::ReleaseLive(Pool<Resource, HandleType>& pool)
+{
+	GpuResourceStats& stats = m_Stats[static_cast<size_t>(pool.type)];
+	for (const Entry<Resource>& entry : pool.live.Values())
+	{
+		ReleaseResource(entry.resource);
+		++stats.destroyed;
+	}
+	stats.liveBytes = 0;
+	pool.live.Clear();
+}
+
+void GpuResources::CollectAll(bool all)
+{
+	Collect(m_Buffers, all);
+	Collect(m_BindGroups, all);
+	Collect(m_RenderPipelines, all);
+	Collect(m_ShaderModules, all);
+}
+
+bool GpuResources::Poll()
+{
+#if defined(WEBGPU_BACKEND_DAWN)
+	m_Device.tick();
+	return true;
+#elif defined(WEBGPU_BACKEND_WGPU)
+	m_Device.poll(true);
+	return true;
+#else
+	// The browser only reports completed work once control returns to it
+	return false;
+#endif
+}
+}
@@ -0,0 +1,101 @@
+#include "ImageWriter.hpp"
+#include "Logger.hpp"
+
+#include <algorithm>
+#include <array>
+#include <fstream>
+#include <vector>
+
+namespace atcp {
+namespace {
+uint32_t Crc32(const uint8_t* data, size_t size, uint32_t crc = 0)
+{
+	static const std::array<uint32_t, 256> table = [] {
+		std::array<uint32_t, 256> result{};
+		for (uint32_t i = 0; i < 256; ++i) {
+			uint32_t value = i;
+			for (int bit = 0; bit < 8; ++bit)
+				value = (value & 1) ? 0xEDB88320u ^ (value >> 1) : value >> 1;
+			result[i] = value;
+		}
+		return result;
+	}();
+
+	crc = ~crc;
+	for (size_t i = 0; i < size; ++i)
+		crc = table[(crc ^ data[i]) & 0xFF] ^ (crc >> 8);
+	return ~crc;
+}
+
+void AppendBigEndian(std::vector<uint8_t>& out, uint32_t value)
+{
+	out.push_back(static_cast<uint8_t>(value >> 24));
+	out.push_back(static_cast<uint8_t>(value >> 16));
+	out.push_back(static_cast<uint8_t>(value >> 8));
+	out.push_back(static_cast<uint8_t>(value));
+}
+
+void AppendChunk(std::vector<uint8_t>& out, const char type[4], const std::vector<uint8_t>& data)
+{
+	AppendBigEndian(out, static_cast<uint32_t>(data.size()));
+	const size_t typeStart = out.size();
+	out.insert(out.end(), type, type + 4);
+	out.insert(out.end(), data.begin(), data.end());
+	AppendBigEndian(out, Crc32(out.data() + typeStart, out.size() - typeStart));
+}
+} // namespace
+
+bool ImageWriter::WritePNG(const std::filesystem::path& path, uint32_t width, uint32_t height, const uint8_t* rgba)
+{
+	std::vector<uint8_t> header;
+	AppendBigEndian(header, width);
+	AppendBigEndian(header, height);
+	// 8 bits per channel, RGBA, deflate, adaptive filtering, no interlace
+	header.insert(header.end(), { 8, 6, 0, 0, 0 });
+
+	// Every scanline starts with filter type 0 (none)
+	std::vector<uint8_t> scanlines;
+	const size_t rowSize = size_t(width) * 4;
+	scanlines.reserve((rowSize + 1) * height);
+	for (uint32_t y = 0; y < height; ++y) {
+		scanlines.push_back(0);
+		scanlines.insert(scanlines.end(), rgba + y * rowSize, rgba + (y + 1) * rowSize);
+	}
+
+	// zlib stream made of stored deflate blocks, images are for comparison so size does not matter
+	std::vector<uint8_t> compressed = { 0x78, 0x01 };
+	constexpr size_t MaxBlockSize = 65535;
+	size_t offset = 0;
+	do {
+		const size_t blockSize = std::min(MaxBlockSize, scanlines.size() - offset);
+		const bool last = offset + blockSize == scanlines.size();
+		compressed.push_back(last ? 1 : 0);
+		compressed.push_back(static_cast<uint8_t>(blockSize));
+		compressed.push_back(static_cast<uint8_t>(blockSize >> 8));
+		compressed.push_back(static_cast<uint8_t>(~blockSize));
+		compressed.push_back(static_cast<uint8_t>(~blockSize >> 8));
+		compressed.insert(compressed.end(), scanlines.begin() + offset, scanlines.begin() + offset + blockSize);
+		offset += blockSize;
+	} while (offset < scanlines.size());
+
+	uint32_t a = 1, b = 0;
+	for (uint8_t byte : scanlines) {
+		a = (a + byte) % 65521;
+		b = (b + a) % 65521;
+	}
+	AppendBigEndian(compressed, (b << 16) | a);
+
+	std::vector<uint8_t> png = { 0x89, 'P', 'N', 'G', '\r', '\n', 0x1A, '\n' };
+	AppendChunk(png, "IHDR", header);
+	AppendChunk(png, "IDAT", compressed);
+	AppendChunk(png, "IEND", {});
+
+	std::ofstream file(path, std::ios::binary);
+	if (!file.is_open()) {
+		LOG_ERROR("Could not write image to {0}", path.string());
+		return false;
+	}
+	file.write(reinterpret_cast<const char*>(png.data()), png.size());
+	return file.good();
+}
+}
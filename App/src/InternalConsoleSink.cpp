@@ -1,8 +1,121 @@
 #include "InternalConsoleSink.hpp"
 
+#include <algorithm>
+#include <cstring>
+
 namespace atcp {
-uint16_t InternalConsole::s_MessageBufferCapacity = 256;
-uint16_t InternalConsole::s_MessageBufferSize = 0;
-uint16_t InternalConsole::s_MessageBufferBegin = 0;
-std::vector<InternalConsole::Message> InternalConsole::s_MessageBuffer(s_MessageBufferCapacity);
+std::mutex InternalConsole::s_Mutex;
+std::vector<char> InternalConsole::s_Arena;
+std::vector<InternalConsole::Entry> InternalConsole::s_Entries;
+size_t InternalConsole::s_FirstEntry = 0;
+size_t InternalConsole::s_EntryCount = 0;
+uint64_t InternalConsole::s_WritePosition = 0;
+uint64_t InternalConsole::s_TotalMessages = 0;
+
+void InternalConsole::Init(size_t entryCapacity, size_t arenaSize)
+{
+	std::lock_guard<std::mutex> lock(s_Mutex);
+	s_Arena.assign(std::max<size_t>(arenaSize, 1), '\0');
+	s_Entries.assign(std::max<size_t>(entryCapacity, 1), Entry{});
+	s_FirstEntry = 0;
+	s_EntryCount = 0;
+	s_WritePosition = 0;
+}
+
+void InternalConsole::AddMessage(std::string_view message, spdlog::level::level_enum level)
+{
+	std::lock_guard<std::mutex> lock(s_Mutex);
+	if (s_Arena.empty())
+	{
+		s_Arena.assign(512 * 1024, '\0');
+		s_Entries.assign(4096, Entry{});
+	}
+
+	// A single message may not take more than a quarter of the history
+	const uint64_t arenaSize = s_Arena.size();
+	const size_t length = std::min<size_t>(message.size(), arenaSize / 4);
+
+	// Messages are never split across the end of the arena
+	uint64_t begin = s_WritePosition;
+	if (begin % arenaSize + length > arenaSize)
+		begin += arenaSize - begin % arenaSize;
+	s_WritePosition = begin + length;
+
+	Evict(s_WritePosition);
+	if (s_EntryCount == s_Entries.size())
+	{
+		s_FirstEntry = (s_FirstEntry + 1) % s_Entries.size();
+		--s_EntryCount;
+	}
+
+	std::memcpy(s_Arena.data() + begin % arenaSize, message.data(), length);
+	s_Entries[(s_FirstEntry + s_EntryCount) % s_Entries.size()] = { begin, static_cast<uint32_t>(length), level };
+	++s_EntryCount;
+	++s_TotalMessages;
+}
+
+void InternalConsole::Clear()
+{
+	std::lock_guard<std::mutex> lock(s_Mutex);
+	s_FirstEntry = 0;
+	s_EntryCount = 0;
+}
+
+void InternalConsole::Snapshot(ConsoleSnapshot& snapshot, spdlog::level::level_enum minLevel, std::string_view filter)
+{
+	snapshot.m_Text.clear();
+	snapshot.m_Entries.clear();
+
+	// Views are pointed at the copied text once the text buffer can no longer reallocate
+	{
+		std::lock_guard<std::mutex> lock(s_Mutex);
+		snapshot.m_Text.reserve(s_Arena.size());
+		snapshot.m_Entries.reserve(s_Entries.size());
+
+		for (size_t i = 0; i < s_EntryCount; ++i)
+		{
+			const Entry& entry = s_Entries[(s_FirstEntry + i) % s_Entries.size()];
+			if (entry.level < minLevel)
+				continue;
+
+			std::string_view text(s_Arena.data() + entry.begin % s_Arena.size(), entry.length);
+			if (!filter.empty() && text.find(filter) == std::string_view::npos)
+				continue;
+
+			snapshot.m_Entries.push_back({ text, entry.level });
+			snapshot.m_Text.insert(snapshot.m_Text.end(), text.begin(), text.end());
+		}
+	}
+
+	size_t offset = 0;
+	for (ConsoleSnapshot::Entry& entry : snapshot.m_Entries)
+	{
+		size_t length = entry.text.size();
+		entry.text = std::string_view(snapshot.m_Text.data() + offset, length);
+		offset += length;
+	}
+}
+
+size_t InternalConsole::GetSize()
+{
+	std::lock_guard<std::mutex> lock(s_Mutex);
+	return s_EntryCount;
+}
+
+uint64_t InternalConsole::GetTotalMessageCount()
+{
+	std::lock_guard<std::mutex> lock(s_Mutex);
+	return s_TotalMessages;
+}
+
+void InternalConsole::Evict(uint64_t writeEnd)
+{
+	// Entries starting before this position have been overwritten
+	const uint64_t oldestValid = writeEnd > s_Arena.size() ? writeEnd - s_Arena.size() : 0;
+	while (s_EntryCount > 0 && s_Entries[s_FirstEntry].begin < oldestValid)
+	{
+		s_FirstEntry = (s_FirstEntry + 1) % s_Entries.size();
+		--s_EntryCount;
+	}
+}
 }
@@ -0,0 +1,195 @@
+#include "JobBenchmark.hpp"
+#include "JobSystem.hpp"
+#include "Logger.hpp"
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <random>
+#include <thread>
+#include <vector>
+
+namespace atcp {
+namespace {
+using Clock = std::chrono::steady_clock;
+
+constexpr uint32_t ParallelForCount = 1 << 22;
+constexpr uint32_t ParallelForGrain = 1024;
+constexpr uint32_t TimingRepeats = 3;
+// Queued in batches that fit in a worker's deque
+constexpr uint32_t EmptyJobCount = 1 << 18;
+constexpr uint32_t EmptyJobBatch = 2048;
+
+constexpr uint32_t GraphJobCount = 2048;
+constexpr uint32_t MaxDependencies = 4;
+constexpr uint32_t GraphIterations = 100;
+constexpr uint32_t NestedCount = 1 << 20;
+constexpr uint32_t NestedLeafSize = 1024;
+constexpr uint32_t NestedIterations = 20;
+
+double SecondsSince(Clock::time_point start)
+{
+	return std::chrono::duration<double>(Clock::now() - start).count();
+}
+
+// Some arithmetic per element so the timings measure scheduling rather than memory bandwidth
+uint32_t Work(uint32_t value)
+{
+	for (int i = 0; i < 64; ++i)
+	{
+		value = value * 1664525u + 1013904223u;
+		value ^= value >> 13;
+	}
+	return value;
+}
+
+double TimeParallelFor(std::vector<uint32_t>& output)
+{
+	double best = 0.0;
+	for (uint32_t repeat = 0; repeat < TimingRepeats; ++repeat)
+	{
+		auto startTime = Clock::now();
+		JobSystem::ParallelFor(ParallelForCount, [&output](uint32_t begin, uint32_t end) {
+			for (uint32_t i = begin; i < end; ++i)
+				output[i] = Work(i);
+		}, ParallelForGrain);
+		const double elapsed = SecondsSince(startTime);
+		best = repeat == 0 ? elapsed : std::min(best, elapsed);
+	}
+	return best;
+}
+
+double TimeEmptyJobs()
+{
+	auto startTime = Clock::now();
+	for (uint32_t batch = 0; batch < EmptyJobCount; batch += EmptyJobBatch)
+	{
+		JobCounter counter;
+		for (uint32_t i = 0; i < EmptyJobBatch; ++i)
+			JobSystem::Run([] {}, &counter);
+		JobSystem::Wait(counter);
+	}
+	return SecondsSince(startTime) / EmptyJobCount;
+}
+
+/**
+ * Random acyclic graph, each job depends on up to MaxDependencies earlier ones and is submitted in random order.
+ * Returns the number of jobs that ran before one of their dependencies or did not run at all.
+ */
+uint32_t CheckDependencies(std::mt19937& random)
+{
+	struct Node {
+		std::atomic<bool> done{ false };
+		std::vector<uint32_t> dependencies;
+	};
+	std::vector<Node> nodes(GraphJobCount);
+	std::atomic<uint32_t> violations{ 0 };
+
+	JobCounter counter;
+	std::vector<Job*> jobs(GraphJobCount);
+	for (uint32_t i = 0; i < GraphJobCount; ++i)
+	{
+		jobs[i] = JobSystem::Create([&nodes, &violations, i] {
+			for (uint32_t dependency : nodes[i].dependencies)
+			{
+				if (!nodes[dependency].done.load(std::memory_order_acquire))
+					violations.fetch_add(1, std::memory_order_relaxed);
+			}
+			nodes[i].done.store(true, std::memory_order_release);
+		}, &counter);
+
+		const uint32_t dependencyCount = i == 0 ? 0 : random() % (MaxDependencies + 1);
+		for (uint32_t d = 0; d < dependencyCount; ++d)
+		{
+			const uint32_t dependency = random() % i;
+			nodes[i].dependencies.push_back(dependency);
+			JobSystem::AddDependency(jobs[i], jobs[dependency]);
+		}
+	}
+
+	std::shuffle(jobs.begin(), jobs.end(), random);
+	for (Job* job : jobs)
+		JobSystem::Submit(job);
+	JobSystem::Wait(counter);
+
+	uint32_t failures = violations.load();
+	for (const Node& node : nodes)
+	{
+		if (!node.done.load())
+			++failures;
+	}
+	return failures;
+}
+
+// Splits recursively, every level waits on its child from inside a job
+uint64_t NestedSum(uint32_t begin, uint32_t end)
+{
+	if (end - begin <= NestedLeafSize)
+	{
+		uint64_t sum = 0;
+		for (uint32_t i = begin; i < end; ++i)
+			sum += i;
+		return sum;
+	}
+
+	const uint32_t middle = begin + (end - begin) / 2;
+	uint64_t left = 0;
+	JobCounter counter;
+	JobSystem::Run([&left, begin, middle] { left = NestedSum(begin, middle); }, &counter);
+	const uint64_t right = NestedSum(middle, end);
+	JobSystem::Wait(counter);
+	return left + right;
+}
+}
+
+int JobBenchmark::Run()
+{
+	const unsigned maxThreads = std::max(1u, std::thread::hardware_concurrency());
+	std::vector<unsigned> threadCounts;
+	for (unsigned threads = 1; threads < maxThreads; threads *= 2)
+		threadCounts.push_back(threads);
+	threadCounts.push_back(maxThreads);
+
+	std::vector<uint32_t> output(ParallelForCount);
+	double singleThreadTime = 0.0;
+	for (unsigned threads : threadCounts)
+	{
+		JobSystem::Init(threads);
+		const double parallelForTime = TimeParallelFor(output);
+		const double emptyJobTime = TimeEmptyJobs();
+		if (threads == 1)
+			singleThreadTime = parallelForTime;
+
+		LOG_INFO("{0} threads: ParallelFor over {1} elements {2:.2f} ms ({3:.2f}x), {4:.0f} ns per empty job",
+			threads, ParallelForCount, parallelForTime * 1000.0, singleThreadTime / parallelForTime, emptyJobTime * 1e9);
+	}
+
+	// Stress with every thread, the job system stays initialized like this afterwards
+	std::mt19937 random(1234);
+	uint32_t dependencyFailures = 0;
+	for (uint32_t iteration = 0; iteration < GraphIterations; ++iteration)
+		dependencyFailures += CheckDependencies(random);
+
+	uint32_t nestedFailures = 0;
+	const uint64_t expectedSum = static_cast<uint64_t>(NestedCount) * (NestedCount - 1) / 2;
+	for (uint32_t iteration = 0; iteration < NestedIterations; ++iteration)
+	{
+		uint64_t sum = 0;
+		JobCounter counter;
+		JobSystem::Run([&sum] { sum = NestedSum(0, NestedCount); }, &counter);
+		JobSystem::Wait(counter);
+		if (sum != expectedSum)
+			++nestedFailures;
+	}
+
+	if (dependencyFailures != 0 || nestedFailures != 0)
+	{
+		LOG_ERROR("Job system stress failed: {0} jobs ran out of order or not at all, {1} nested sums were wrong",
+			dependencyFailures, nestedFailures);
+		return 1;
+	}
+	LOG_INFO("Job system stress passed: {0} dependency graphs of {1} jobs, {2} nested fork-join sums",
+		GraphIterations, GraphJobCount, NestedIterations);
+	return 0;
+}
+}
@@ -0,0 +1,292 @@
+#include "JobSystem.hpp"
+#include "BoundedQueue.hpp"
+#include "Profiler.hpp"
+
+#include <condition_variable>
+#include <memory>
+#include <mutex>
+#include <thread>
+
+namespace atcp {
+namespace {
+/**
+ * Chase-Lev deque with a fixed capacity, using the memory orderings from Lê et al., "Correct and Efficient
+ * Work-Stealing for Weak Memory Models" (2013). Push and Pop are only called by the owner, Steal by anyone.
+ */
+class WorkQueue
+{
+public:
+	static constexpr int64_t Capacity = 4096;
+
+	bool Push(Job* job)
+	{
+		const int64_t bottom = m_Bottom.load(std::memory_order_relaxed);
+		const int64_t top = m_Top.load(std::memory_order_acquire);
+		if (bottom - top >= Capacity)
+			return false;
+
+		m_Jobs[bottom & (Capacity - 1)].store(job, std::memory_order_release);
+		std::atomic_thread_fence(std::memory_order_release);
+		m_Bottom.store(bottom + 1, std::memory_order_relaxed);
+		return true;
+	}
+
+	Job* Pop()
+	{
+		const int64_t bottom = m_Bottom.load(std::memory_order_relaxed) - 1;
+		m_Bottom.store(bottom, std::memory_order_relaxed);
+		std::atomic_thread_fence(std::memory_order_seq_cst);
+		int64_t top = m_Top.load(std::memory_order_relaxed);
+
+		if (top > bottom)
+		{
+			m_Bottom.store(bottom + 1, std::memory_order_relaxed);
+			return nullptr;
+		}
+
+		Job* job = m_Jobs[bottom & (Capacity - 1)].load(std::memory_order_relaxed);
+		if (top == bottom)
+		{
+			// Last job, race any thief for it
+			if (!m_Top.compare_exchange_strong(top, top + 1, std::memory_order_seq_cst, std::memory_order_relaxed))
+				job = nullptr;
+			m_Bottom.store(bottom + 1, std::memory_order_relaxed);
+		}
+		return job;
+	}
+
+	Job* Steal()
+	{
+		int64_t top = m_Top.load(std::memory_order_acquire);
+		std::atomic_thread_fence(std::memory_order_seq_cst);
+		const int64_t bottom = m_Bottom.load(std::memory_order_acquire);
+		if (top >= bottom)
+			return nullptr;
+
+		Job* job = m_Jobs[top & (Capacity - 1)].load(std::memory_order_acquire);
+		if (!m_Top.compare_exchange_strong(top, top + 1, std::memory_order_seq_cst, std::memory_order_relaxed))
+			return nullptr;
+		return job;
+	}
+
+private:
+	alignas(64) std::atomic<int64_t> m_Top{ 0 };
+	alignas(64) std::atomic<int64_t> m_Bottom{ 0 };
+	alignas(64) std::atomic<Job*> m_Jobs[Capacity];
+};
+
+struct Worker {
+	WorkQueue queue;
+	std::thread thread;
+	uint32_t index = 0;
+};
+
+// Yields before a worker with nothing to do goes to sleep
+constexpr uint32_t IdleSpinCount = 64;
+// Ranges per worker in ParallelFor, more balance load better but cost more scheduling
+constexpr uint32_t RangesPerWorker = 4;
+
+std::vector<std::unique_ptr<Worker>> s_Workers;
+std::unique_ptr<BoundedQueue<Job*>> s_SharedQueue;
+std::atomic<bool> s_Running{ false };
+// Jobs sitting in a queue, sleeping workers wake while this is above zero. Briefly negative when a job is
+// taken before the thread that queued it has counted it
+std::atomic<int32_t> s_QueuedJobs{ 0 };
+std::atomic<uint32_t> s_SleepingWorkers{ 0 };
+std::mutex s_SleepMutex;
+std::condition_variable s_WakeCondition;
+
+thread_local Worker* s_CurrentWorker = nullptr;
+thread_local uint32_t s_NextVictim = 0;
+
+Job* Steal()
+{
+	const uint32_t workerCount = static_cast<uint32_t>(s_Workers.size());
+	for (uint32_t i = 0; i < workerCount; ++i)
+	{
+		Worker& victim = *s_Workers[s_NextVictim++ % workerCount];
+		if (&victim == s_CurrentWorker)
+			continue;
+		if (Job* job = victim.queue.Steal())
+			return job;
+	}
+	return nullptr;
+}
+}
+
+void JobSystem::Enqueue(Job* job)
+{
+	if (!s_Running.load(std::memory_order_acquire))
+	{
+		Execute(job);
+		return;
+	}
+
+	const bool queued = s_CurrentWorker
+		? s_CurrentWorker->queue.Push(job)
+		: s_SharedQueue->TryPush([job](Job*& slot) { slot = job; });
+	if (!queued)
+	{
+		// Queues are full, the job is ready so running it now is always correct
+		Execute(job);
+		return;
+	}
+
+	// Paired with the sleeping check in WorkerMain, a worker either sees the job or is woken for it
+	s_QueuedJobs.fetch_add(1, std::memory_order_seq_cst);
+	if (s_SleepingWorkers.load(std::memory_order_seq_cst) > 0)
+	{
+		std::lock_guard<std::mutex> lock(s_SleepMutex);
+		s_WakeCondition.notify_one();
+	}
+}
+
+void JobSystem::Execute(Job* job)
+{
+	job->invoke(job->storage);
+	job->destroy(job->storage);
+
+	// Continuations are queued before the counter drops so a waiter never sees them missing
+	for (Job* continuation : job->continuations)
+	{
+		if (continuation->pending.fetch_sub(1, std::memory_order_acq_rel) == 1)
+			Enqueue(continuation);
+	}
+	if (job->counter)
+		job->counter->m_Value.fetch_sub(1, std::memory_order_release);
+	delete job;
+}
+
+bool JobSystem::RunOne()
+{
+	Job* job = s_CurrentWorker ? s_CurrentWorker->queue.Pop() : nullptr;
+	if (!job && s_SharedQueue)
+		s_SharedQueue->TryPop([&job](Job*& slot) { job = slot; });
+	if (!job)
+		job = Steal();
+	if (!job)
+		return false;
+
+	s_QueuedJobs.fetch_sub(1, std::memory_order_relaxed);
+	Execute(job);
+	return true;
+}
+
+void JobSystem::WorkerMain(unsigned index)
+{
+	s_CurrentWorker = s_Workers[index].get();
+	s_NextVictim = index + 1;
+	PROFILE_THREAD("Job worker");
+
+	uint32_t idleSpins = 0;
+	while (s_Running.load(std::memory_order_acquire))
+	{
+		if (RunOne())
+		{
+			idleSpins = 0;
+			continue;
+		}
+		if (++idleSpins < IdleSpinCount)
+		{
+			std::this_thread::yield();
+			continue;
+		}
+
+		s_SleepingWorkers.fetch_add(1, std::memory_order_seq_cst);
+		{
+			std::unique_lock<std::mutex> lock(s_SleepMutex);
+			s_WakeCondition.wait(lock, [] {
+				return s_QueuedJobs.load(std::memory_order_seq_cst) > 0 || !s_Running.load(std::memory_order_acquire);
+			});
+		}
+		s_SleepingWorkers.fetch_sub(1, std::memory_order_relaxed);
+		idleSpins = 0;
+	}
+}
+
+void JobSystem::Init(unsigned threadCount)
+{
+	Shutdown();
+
+	if (threadCount == 0)
+		threadCount = std::max(1u, std::thread::hardware_concurrency());
+
+	s_SharedQueue = std::make_unique<BoundedQueue<Job*>>(WorkQueue::Capacity);
+	s_Workers.reserve(threadCount);
+	for (unsigned i = 0; i < threadCount; ++i)
+	{
+		s_Workers.push_back(std::make_unique<Worker>());
+		s_Workers.back()->index = i;
+	}
+	s_CurrentWorker = s_Workers.front().get();
+	s_NextVictim = 1;
+	s_Running.store(true, std::memory_order_release);
+
+	for (unsigned i = 1; i < threadCount; ++i)
+		s_Workers[i]->thread = std::thread(&JobSystem::WorkerMain, i);
+}
+
+void JobSystem::Shutdown()
+{
+	if (!s_Running.exchange(false, std::memory_order_acq_rel))
+		return;
+
+	{
+		std::lock_guard<std::mutex> lock(s_SleepMutex);
+		s_WakeCondition.notify_all();
+	}
+	for (std::unique_ptr<Worker>& worker : s_Workers)
+	{
+		if (worker->thread.joinable())
+			worker->thread.join();
+	}
+
+	// Anything left is run here, jobs it submits run immediately now the system is stopped
+	while (RunOne())
+	{
+	}
+
+	s_CurrentWorker = nullptr;
+	s_Workers.clear();
+	s_SharedQueue.reset();
+	s_QueuedJobs.store(0, std::memory_order_relaxed);
+}
+
+bool JobSystem::IsInitialized()
+{
+	return s_Running.load(std::memory_order_acquire);
+}
+
+unsigned JobSystem::GetThreadCount()
+{
+	return IsInitialized() ? static_cast<unsigned>(s_Workers.size()) : 1u;
+}
+
+void JobSystem::AddDependency(Job* job, Job* dependency)
+{
+	dependency->continuations.push_back(job);
+	job->pending.fetch_add(1, std::memory_order_relaxed);
+}
+
+void JobSystem::Submit(Job* job)
+{
+	if (job->pending.fetch_sub(1, std::memory_order_acq_rel) == 1)
+		Enqueue(job);
+}
+
+void JobSystem::Wait(const JobCounter& counter)
+{
+	while (!counter.IsDone())
+	{
+		if (!RunOne())
+			std::this_thread::yield();
+	}
+}
+
+uint32_t JobSystem::GetGrainSize(uint32_t count, uint32_t minGrain)
+{
+	const uint32_t rangeCount = GetThreadCount() * RangesPerWorker;
+	const uint32_t grain = count / rangeCount + (count % rangeCount == 0 ? 0 : 1);
+	return std::max({ grain, minGrain, 1u });
+}
+}
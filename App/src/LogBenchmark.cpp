@@ -0,0 +1,132 @@
+#include "LogBenchmark.hpp"
+#include "AsyncLogSink.hpp"
+#include "BinaryLog.hpp"
+#include "Logger.hpp"
+#include "TimingStats.hpp"
+
+#include <chrono>
+#include <filesystem>
+#include <memory>
+#include <thread>
+#include <vector>
+#include <spdlog/sinks/basic_file_sink.h>
+
+namespace atcp {
+namespace {
+using Clock = std::chrono::steady_clock;
+
+constexpr uint32_t ProducerCounts[] = { 1, 8 };
+constexpr uint32_t MessagesPerThread = 20000;
+constexpr size_t AsyncQueueCapacity = 8192;
+constexpr const char* TextPath = "LogBenchmark.txt";
+constexpr const char* BinaryPath = "LogBenchmark.bin";
+
+double SecondsSince(Clock::time_point start)
+{
+	return std::chrono::duration<double>(Clock::now() - start).count();
+}
+
+// The file sink Logger::Init writes Log.txt with
+std::shared_ptr<spdlog::sinks::basic_file_sink_mt> CreateFileSink()
+{
+	auto sink = std::make_shared<spdlog::sinks::basic_file_sink_mt>(TextPath, true);
+	sink->set_pattern("[%d/%m/%Y] [%T] [%l] %n: %v");
+	return sink;
+}
+
+/**
+ * Call 'log' MessagesPerThread times on each of 'producerCount' threads and collect the time each call took. The
+ * clock is read around every call, so the costs include a clock read.
+ */
+template<typename Function>
+double TimeCalls(uint32_t producerCount, TimingStats& stats, Function log)
+{
+	std::vector<std::vector<double>> samples(producerCount, std::vector<double>(MessagesPerThread));
+	std::vector<std::thread> producers;
+	auto startTime = Clock::now();
+	for (uint32_t producer = 0; producer < producerCount; ++producer)
+	{
+		producers.emplace_back([&samples, &log, producer] {
+			for (uint32_t i = 0; i < MessagesPerThread; ++i)
+			{
+				auto callTime = Clock::now();
+				log(producer, i);
+				samples[producer][i] = SecondsSince(callTime);
+			}
+		});
+	}
+	for (std::thread& producer : producers)
+		producer.join();
+	const double elapsed = SecondsSince(startTime);
+
+	stats.Clear();
+	stats.Reserve(producerCount * MessagesPerThread);
+	for (const std::vector<double>& threadSamples : samples)
+	{
+		for (double sample : threadSamples)
+			stats.Add(sample);
+	}
+	return elapsed;
+}
+
+void LogStats(const char* name, uint32_t producerCount, TimingStats& stats, double elapsed)
+{
+	LOG_INFO("{0} with {1} producers: p50 {2:.0f} ns, p99 {3:.0f} ns per call, {4:.0f} messages/s", name, producerCount,
+		stats.GetPercentile(50.0) * 1e9, stats.GetPercentile(99.0) * 1e9, stats.GetCount() / elapsed);
+}
+}
+
+int LogBenchmark::Run()
+{
+	// Binary builds already write every message to Log.bin, the benchmark's messages are measured there
+	const bool openedBinaryLog = !BinaryLog::IsOpen();
+	if (openedBinaryLog && !BinaryLog::Open(BinaryPath, "LogBenchmark"))
+	{
+		LOG_ERROR("Could not open {0}", BinaryPath);
+		return 1;
+	}
+
+	TimingStats stats;
+	for (uint32_t producerCount : ProducerCounts)
+	{
+		uint64_t textSize = 0;
+		{
+			spdlog::logger logger("LogBenchmark", CreateFileSink());
+			const double elapsed = TimeCalls(producerCount, stats, [&logger](uint32_t producer, uint32_t i) {
+				logger.info("Producer {0} message {1}: frame took {2:.3f} ms", producer, i, i * 0.001);
+			});
+			logger.flush();
+			LogStats("Synchronous file sink", producerCount, stats, elapsed);
+			textSize = std::filesystem::file_size(TextPath);
+		}
+		{
+			// Blocks when full like the application's logger, so the p99 includes waiting for the background thread
+			auto asyncSink = std::make_shared<AsyncLogSink>(std::vector<spdlog::sink_ptr>{ CreateFileSink() }, AsyncQueueCapacity, LogOverflowPolicy::Block);
+			spdlog::logger logger("LogBenchmark", asyncSink);
+			const double elapsed = TimeCalls(producerCount, stats, [&logger](uint32_t producer, uint32_t i) {
+				logger.info("Producer {0} message {1}: frame took {2:.3f} ms", producer, i, i * 0.001);
+			});
+			logger.flush();
+			LogStats("Asynchronous sink", producerCount, stats, elapsed);
+			LOG_INFO("Asynchronous sink with {0} producers blocked {1} times on a full queue", producerCount, asyncSink->GetBlockedCount());
+		}
+		{
+			BinaryLog::Flush();
+			const uint64_t startSize = BinaryLog::GetWrittenSize();
+			const double elapsed = TimeCalls(producerCount, stats, [](uint32_t producer, uint32_t i) {
+				BinaryLog::Log([]{}, spdlog::level::info, __FILE__, __LINE__, "Producer {0} message {1}: frame took {2:.3f} ms", producer, i, i * 0.001);
+			});
+			// Producer threads wrote out their buffers as they exited
+			BinaryLog::Flush();
+			const uint64_t binarySize = BinaryLog::GetWrittenSize() - startSize;
+			LogStats("Binary log", producerCount, stats, elapsed);
+			LOG_INFO("{0} messages from {1} producers: text {2:.2f} MB, binary {3:.2f} MB ({4:.1f}x smaller)", stats.GetCount(), producerCount,
+				textSize / (1024.0 * 1024.0), binarySize / (1024.0 * 1024.0), binarySize > 0 ? static_cast<double>(textSize) / binarySize : 0.0);
+		}
+	}
+
+	if (openedBinaryLog)
+		BinaryLog::Close();
+	return 0;
+}
+}
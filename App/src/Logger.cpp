@@ -4,13 +4,20 @@
 #include <spdlog/sinks/basic_file_sink.h>
 #include <spdlog/sinks/msvc_sink.h>
 
+#include "AsyncLogSink.hpp"
+#include "BinaryLog.hpp"
 #include "InternalConsoleSink.hpp"
 
 namespace atcp {
 std::shared_ptr<spdlog::logger> Logger::s_Logger;
-void Logger::Init(const std::string& name)
+std::shared_ptr<AsyncLogSink> Logger::s_AsyncSink;
+void Logger::Init(const std::string& name, const LoggerOptions& options)
 {
 	std::string logFilename = "Log.txt";
+#ifdef ATCP_BINARY_LOG
+	// Everything is written here, only errors also reach the text sinks, decode it with LogDecoder
+	BinaryLog::Open("Log.bin", name);
+#endif
 
 	std::vector<spdlog::sink_ptr>logSinks;
 	//std::cout
@@ -20,6 +27,7 @@ void Logger::Init(const std::string& name)
 	logSinks.emplace_back(std::make_shared<spdlog::sinks::basic_file_sink_mt>(logFilename, true));
 	logSinks.back()->set_pattern("[%d/%m/%Y] [%T] [%l] %n: %v");
 	// Internal Console
+	InternalConsole::Init();
 	logSinks.emplace_back(std::make_shared<InternalConsoleSink_mt>());
 	logSinks.back()->set_pattern("%^[%T] [%l] %n: %v%$");
 #ifdef _MSC_VER
@@ -29,9 +37,40 @@ void Logger::Init(const std::string& name)
 #endif
 
 
-	s_Logger = std::make_shared<spdlog::logger>(name, begin(logSinks), end(logSinks));
+	if (options.async)
+	{
+		s_AsyncSink = std::make_shared<AsyncLogSink>(std::move(logSinks), options.queueCapacity, options.overflowPolicy);
+		s_Logger = std::make_shared<spdlog::logger>(name, s_AsyncSink);
+	}
+	else
+	{
+		s_Logger = std::make_shared<spdlog::logger>(name, begin(logSinks), end(logSinks));
+	}
 	spdlog::register_logger(s_Logger);
 	s_Logger->set_level(spdlog::level::trace);
-	s_Logger->flush_on(spdlog::level::trace);
+	// The background thread flushes every batch, errors still wait until they are written in case a crash follows
+	s_Logger->flush_on(options.async ? spdlog::level::err : spdlog::level::trace);
+}
+
+void Logger::Shutdown()
+{
+	BinaryLog::Close();
+	if (!s_Logger)
+		return;
+
+	s_Logger->flush();
+	if (s_AsyncSink && s_AsyncSink->GetDroppedCount() > 0)
+	{
+		s_Logger->warn("{0} log messages were dropped", s_AsyncSink->GetDroppedCount());
+		s_Logger->flush();
+	}
+	spdlog::drop(s_Logger->name());
+	s_Logger.reset();
+	s_AsyncSink.reset();
+}
+
+uint64_t Logger::GetDroppedMessageCount()
+{
+	return s_AsyncSink ? s_AsyncSink->GetDroppedCount() : 0;
 }
 }
\ No newline at end of file
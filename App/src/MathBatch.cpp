@@ -0,0 +1,383 @@
+#include "MathBatch.hpp"
+
+#include <atomic>
+#include <cmath>
+#include <limits>
+
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#define ATCP_MATH_X86 1
+#include <immintrin.h>
+#if defined(_MSC_VER)
+#include <intrin.h>
+#endif
+#else
+#define ATCP_MATH_X86 0
+#endif
+
+// AVX2 kernels are compiled for it whatever the target, and only called once the CPU is known to support it
+#if defined(__GNUC__) || defined(__clang__)
+#define ATCP_TARGET_AVX2 __attribute__((target("avx2,fma")))
+#else
+#define ATCP_TARGET_AVX2
+#endif
+
+namespace atcp {
+namespace {
+SimdLevel DetectLevel()
+{
+#if ATCP_MATH_X86 && defined(_MSC_VER)
+	int info[4];
+	__cpuid(info, 0);
+	if (info[0] < 7)
+		return SimdLevel::SSE;
+	__cpuid(info, 1);
+	const bool fma = info[2] & (1 << 12);
+	const bool osxsave = info[2] & (1 << 27);
+	const bool avx = info[2] & (1 << 28);
+	__cpuidex(info, 7, 0);
+	const bool avx2 = info[1] & (1 << 5);
+	// The OS must also save the YMM registers on context switches
+	const bool ymmEnabled = osxsave && (_xgetbv(0) & 6) == 6;
+	return fma && avx && avx2 && ymmEnabled ? SimdLevel::AVX2 : SimdLevel::SSE;
+#elif ATCP_MATH_X86
+	__builtin_cpu_init();
+	return __builtin_cpu_supports("avx2") && __builtin_cpu_supports("fma") ? SimdLevel::AVX2 : SimdLevel::SSE;
+#else
+	return SimdLevel::Scalar;
+#endif
+}
+
+std::atomic<SimdLevel>& CurrentLevel()
+{
+	static std::atomic<SimdLevel> level{ MathBatch::GetSupportedLevel() };
+	return level;
+}
+
+void TransformPointsScalar(const Mat4& matrix, const Vec3* points, Vec3* out, size_t count)
+{
+	for (size_t i = 0; i < count; ++i)
+		out[i] = TransformPoint(matrix, points[i]);
+}
+
+void MultiplyMatricesScalar(const Mat4* a, const Mat4* b, Mat4* out, size_t count)
+{
+	for (size_t i = 0; i < count; ++i)
+		out[i] = a[i] * b[i];
+}
+
+// Transforms the centre, the extent only needs the absolute values of the rotation and scale
+void TransformBoundsScalar(const Mat4* matrices, const Aabb* bounds, Aabb* out, size_t count)
+{
+	for (size_t i = 0; i < count; ++i)
+	{
+		const Mat4& m = matrices[i];
+		const Vec3 centre = (bounds[i].min + bounds[i].max) * 0.5f;
+		const Vec3 extent = (bounds[i].max - bounds[i].min) * 0.5f;
+		const Vec3 newCentre = TransformPoint(m, centre);
+		const Vec3 newExtent = {
+			std::fabs(m.columns[0].x) * extent.x + std::fabs(m.columns[1].x) * extent.y + std::fabs(m.columns[2].x) * extent.z,
+			std::fabs(m.columns[0].y) * extent.x + std::fabs(m.columns[1].y) * extent.y + std::fabs(m.columns[2].y) * extent.z,
+			std::fabs(m.columns[0].z) * extent.x + std::fabs(m.columns[1].z) * extent.y + std::fabs(m.columns[2].z) * extent.z,
+		};
+		out[i] = { newCentre - newExtent, newCentre + newExtent };
+	}
+}
+
+Aabb ComputeBoundsScalar(const Vec3* points, size_t count)
+{
+	const float infinity = std::numeric_limits<float>::infinity();
+	Aabb bounds = { { infinity, infinity, infinity }, { -infinity, -infinity, -infinity } };
+	for (size_t i = 0; i < count; ++i)
+	{
+		bounds.min = Min(bounds.min, points[i]);
+		bounds.max = Max(bounds.max, points[i]);
+	}
+	return bounds;
+}
+
+#if ATCP_MATH_X86
+#define ATCP_SPLAT(v, i) _mm_shuffle_ps((v), (v), _MM_SHUFFLE(i, i, i, i))
+
+// Clears the Vec3 padding lane
+__m128 XyzMask()
+{
+	return _mm_castsi128_ps(_mm_set_epi32(0, -1, -1, -1));
+}
+
+__m128 AbsMask()
+{
+	return _mm_castsi128_ps(_mm_set1_epi32(0x7fffffff));
+}
+
+void TransformPointsSSE(const Mat4& matrix, const Vec3* points, Vec3* out, size_t count)
+{
+	const __m128 c0 = _mm_load_ps(&matrix.columns[0].x);
+	const __m128 c1 = _mm_load_ps(&matrix.columns[1].x);
+	const __m128 c2 = _mm_load_ps(&matrix.columns[2].x);
+	const __m128 c3 = _mm_load_ps(&matrix.columns[3].x);
+	const __m128 mask = XyzMask();
+	for (size_t i = 0; i < count; ++i)
+	{
+		const __m128 p = _mm_load_ps(&points[i].x);
+		__m128 r = _mm_mul_ps(c0, ATCP_SPLAT(p, 0));
+		r = _mm_add_ps(r, _mm_mul_ps(c1, ATCP_SPLAT(p, 1)));
+		r = _mm_add_ps(r, _mm_mul_ps(c2, ATCP_SPLAT(p, 2)));
+		r = _mm_add_ps(r, c3);
+		_mm_store_ps(&out[i].x, _mm_and_ps(r, mask));
+	}
+}
+
+void MultiplyMatricesSSE(const Mat4* a, const Mat4* b, Mat4* out, size_t count)
+{
+	for (size_t i = 0; i < count; ++i)
+	{
+		const __m128 a0 = _mm_load_ps(&a[i].columns[0].x);
+		const __m128 a1 = _mm_load_ps(&a[i].columns[1].x);
+		const __m128 a2 = _mm_load_ps(&a[i].columns[2].x);
+		const __m128 a3 = _mm_load_ps(&a[i].columns[3].x);
+		__m128 columns[4];
+		for (int c = 0; c < 4; ++c)
+		{
+			const __m128 bc = _mm_load_ps(&b[i].columns[c].x);
+			__m128 r = _mm_mul_ps(a0, ATCP_SPLAT(bc, 0));
+			r = _mm_add_ps(r, _mm_mul_ps(a1, ATCP_SPLAT(bc, 1)));
+			r = _mm_add_ps(r, _mm_mul_ps(a2, ATCP_SPLAT(bc, 2)));
+			columns[c] = _mm_add_ps(r, _mm_mul_ps(a3, ATCP_SPLAT(bc, 3)));
+		}
+		for (int c = 0; c < 4; ++c)
+			_mm_store_ps(&out[i].columns[c].x, columns[c]);
+	}
+}
+
+void TransformBoundsSSE(const Mat4* matrices, const Aabb* bounds, Aabb* out, size_t count)
+{
+	const __m128 half = _mm_set1_ps(0.5f);
+	const __m128 mask = XyzMask();
+	const __m128 absMask = AbsMask();
+	for (size_t i = 0; i < count; ++i)
+	{
+		const Mat4& m = matrices[i];
+		const __m128 c0 = _mm_load_ps(&m.columns[0].x);
+		const __m128 c1 = _mm_load_ps(&m.columns[1].x);
+		const __m128 c2 = _mm_load_ps(&m.columns[2].x);
+		const __m128 c3 = _mm_load_ps(&m.columns[3].x);
+		const __m128 min = _mm_load_ps(&bounds[i].min.x);
+		const __m128 max = _mm_load_ps(&bounds[i].max.x);
+		const __m128 centre = _mm_mul_ps(_mm_add_ps(min, max), half);
+		const __m128 extent = _mm_mul_ps(_mm_sub_ps(max, min), half);
+
+		__m128 newCentre = _mm_mul_ps(c0, ATCP_SPLAT(centre, 0));
+		newCentre = _mm_add_ps(newCentre, _mm_mul_ps(c1, ATCP_SPLAT(centre, 1)));
+		newCentre = _mm_add_ps(newCentre, _mm_mul_ps(c2, ATCP_SPLAT(centre, 2)));
+		newCentre = _mm_add_ps(newCentre, c3);
+		__m128 newExtent = _mm_mul_ps(_mm_and_ps(c0, absMask), ATCP_SPLAT(extent, 0));
+		newExtent = _mm_add_ps(newExtent, _mm_mul_ps(_mm_and_ps(c1, absMask), ATCP_SPLAT(extent, 1)));
+		newExtent = _mm_add_ps(newExtent, _mm_mul_ps(_mm_and_ps(c2, absMask), ATCP_SPLAT(extent, 2)));
+
+		_mm_store_ps(&out[i].min.x, _mm_and_ps(_mm_sub_ps(newCentre, newExtent), mask));
+		_mm_store_ps(&out[i].max.x, _mm_and_ps(_mm_add_ps(newCentre, newExtent), mask));
+	}
+}
+
+Aabb ComputeBoundsSSE(const Vec3* points, size_t count)
+{
+	__m128 min = _mm_set1_ps(std::numeric_limits<float>::infinity());
+	__m128 max = _mm_set1_ps(-std::numeric_limits<float>::infinity());
+	for (size_t i = 0; i < count; ++i)
+	{
+		const __m128 p = _mm_load_ps(&points[i].x);
+		min = _mm_min_ps(min, p);
+		max = _mm_max_ps(max, p);
+	}
+
+	Aabb bounds;
+	_mm_store_ps(&bounds.min.x, min);
+	_mm_store_ps(&bounds.max.x, max);
+	bounds.min._pad = 0.0f;
+	bounds.max._pad = 0.0f;
+	return bounds;
+}
+
+// Two points, boxes or matrix columns per 256 bit register, one in each 128 bit lane
+
+ATCP_TARGET_AVX2 void TransformPointsAVX2(const Mat4& matrix, const Vec3* points, Vec3* out, size_t count)
+{
+	const __m256 c0 = _mm256_broadcast_ps(reinterpret_cast<const __m128*>(&matrix.columns[0]));
+	const __m256 c1 = _mm256_broadcast_ps(reinterpret_cast<const __m128*>(&matrix.columns[1]));
+	const __m256 c2 = _mm256_broadcast_ps(reinterpret_cast<const __m128*>(&matrix.columns[2]));
+	const __m256 c3 = _mm256_broadcast_ps(reinterpret_cast<const __m128*>(&matrix.columns[3]));
+	const __m256 mask = _mm256_castsi256_ps(_mm256_set_epi32(0, -1, -1, -1, 0, -1, -1, -1));
+	size_t i = 0;
+	for (; i + 2 <= count; i += 2)
+	{
+		const __m256 p = _mm256_loadu_ps(&points[i].x);
+		__m256 r = _mm256_mul_ps(c0, _mm256_permute_ps(p, 0x00));
+		r = _mm256_fmadd_ps(c1, _mm256_permute_ps(p, 0x55), r);
+		r = _mm256_fmadd_ps(c2, _mm256_permute_ps(p, 0xAA), r);
+		r = _mm256_add_ps(r, c3);
+		_mm256_storeu_ps(&out[i].x, _mm256_and_ps(r, mask));
+	}
+	TransformPointsSSE(matrix, points + i, out + i, count - i);
+}
+
+ATCP_TARGET_AVX2 void MultiplyMatricesAVX2(const Mat4* a, const Mat4* b, Mat4* out, size_t count)
+{
+	for (size_t i = 0; i < count; ++i)
+	{
+		const __m256 a0 = _mm256_broadcast_ps(reinterpret_cast<const __m128*>(&a[i].columns[0]));
+		const __m256 a1 = _mm256_broadcast_ps(reinterpret_cast<const __m128*>(&a[i].columns[1]));
+		const __m256 a2 = _mm256_broadcast_ps(reinterpret_cast<const __m128*>(&a[i].columns[2]));
+		const __m256 a3 = _mm256_broadcast_ps(reinterpret_cast<const __m128*>(&a[i].columns[3]));
+		const __m256 b01 = _mm256_loadu_ps(&b[i].columns[0].x);
+		const __m256 b23 = _mm256_loadu_ps(&b[i].columns[2].x);
+
+		__m256 r01 = _mm256_mul_ps(a0, _mm256_permute_ps(b01, 0x00));
+		r01 = _mm256_fmadd_ps(a1, _mm256_permute_ps(b01, 0x55), r01);
+		r01 = _mm256_fmadd_ps(a2, _mm256_permute_ps(b01, 0xAA), r01);
+		r01 = _mm256_fmadd_ps(a3, _mm256_permute_ps(b01, 0xFF), r01);
+		__m256 r23 = _mm256_mul_ps(a0, _mm256_permute_ps(b23, 0x00));
+		r23 = _mm256_fmadd_ps(a1, _mm256_permute_ps(b23, 0x55), r23);
+		r23 = _mm256_fmadd_ps(a2, _mm256_permute_ps(b23, 0xAA), r23);
+		r23 = _mm256_fmadd_ps(a3, _mm256_permute_ps(b23, 0xFF), r23);
+
+		_mm256_storeu_ps(&out[i].columns[0].x, r01);
+		_mm256_storeu_ps(&out[i].columns[2].x, r23);
+	}
+}
+
+// The centre goes in the low lane with the matrix columns, the extent in the high lane with their absolute values
+ATCP_TARGET_AVX2 void TransformBoundsAVX2(const Mat4* matrices, const Aabb* bounds, Aabb* out, size_t count)
+{
+	const __m128 half = _mm_set1_ps(0.5f);
+	const __m128 mask = XyzMask();
+	const __m128 absMask = AbsMask();
+	for (size_t i = 0; i < count; ++i)
+	{
+		const Mat4& m = matrices[i];
+		const __m128 c0 = _mm_load_ps(&m.columns[0].x);
+		const __m128 c1 = _mm_load_ps(&m.columns[1].x);
+		const __m128 c2 = _mm_load_ps(&m.columns[2].x);
+		const __m256 columns0 = _mm256_insertf128_ps(_mm256_castps128_ps256(c0), _mm_and_ps(c0, absMask), 1);
+		const __m256 columns1 = _mm256_insertf128_ps(_mm256_castps128_ps256(c1), _mm_and_ps(c1, absMask), 1);
+		const __m256 columns2 = _mm256_insertf128_ps(_mm256_castps128_ps256(c2), _mm_and_ps(c2, absMask), 1);
+		const __m256 translation = _mm256_insertf128_ps(_mm256_setzero_ps(), _mm_load_ps(&m.columns[3].x), 0);
+
+		const __m128 min = _mm_load_ps(&bounds[i].min.x);
+		const __m128 max = _mm_load_ps(&bounds[i].max.x);
+		const __m128 centre = _mm_mul_ps(_mm_add_ps(min, max), half);
+		const __m128 extent = _mm_mul_ps(_mm_sub_ps(max, min), half);
+		const __m256 box = _mm256_insertf128_ps(_mm256_castps128_ps256(centre), extent, 1);
+
+		__m256 r = _mm256_mul_ps(columns0, _mm256_permute_ps(box, 0x00));
+		r = _mm256_fmadd_ps(columns1, _mm256_permute_ps(box, 0x55), r);
+		r = _mm256_fmadd_ps(columns2, _mm256_permute_ps(box, 0xAA), r);
+		r = _mm256_add_ps(r, translation);
+
+		const __m128 newCentre = _mm256_castps256_ps128(r);
+		const __m128 newExtent = _mm256_extractf128_ps(r, 1);
+		_mm_store_ps(&out[i].min.x, _mm_and_ps(_mm_sub_ps(newCentre, newExtent), mask));
+		_mm_store_ps(&out[i].max.x, _mm_and_ps(_mm_add_ps(newCentre, newExtent), mask));
+	}
+}
+
+ATCP_TARGET_AVX2 Aabb ComputeBoundsAVX2(const Vec3* points, size_t count)
+{
+	__m256 min = _mm256_set1_ps(std::numeric_limits<float>::infinity());
+	__m256 max = _mm256_set1_ps(-std::numeric_limits<float>::infinity());
+	size_t i = 0;
+	for (; i + 2 <= count; i += 2)
+	{
+		const __m256 p = _mm256_loadu_ps(&points[i].x);
+		min = _mm256_min_ps(min, p);
+		max = _mm256_max_ps(max, p);
+	}
+
+	Aabb bounds = ComputeBoundsSSE(points + i, count - i);
+	const __m128 mask = XyzMask();
+	__m128 min128 = _mm_min_ps(_mm256_castps256_ps128(min), _mm256_extractf128_ps(min, 1));
+	__m128 max128 = _mm_max_ps(_mm256_castps256_ps128(max), _mm256_extractf128_ps(max, 1));
+	min128 = _mm_min_ps(min128, _mm_load_ps(&bounds.min.x));
+	max128 = _mm_max_ps(max128, _mm_load_ps(&bounds.max.x));
+	_mm_store_ps(&bounds.min.x, _mm_and_ps(min128, mask));
+	_mm_store_ps(&bounds.max.x, _mm_and_ps(max128, mask));
+	return bounds;
+}
+#undef ATCP_SPLAT
+#endif
+}
+
+SimdLevel MathBatch::GetSupportedLevel()
+{
+	static const SimdLevel level = DetectLevel();
+	return level;
+}
+
+SimdLevel MathBatch::GetLevel()
+{
+	return CurrentLevel().load(std::memory_order_relaxed);
+}
+
+void MathBatch::SetLevel(SimdLevel level)
+{
+	CurrentLevel().store(std::min(level, GetSupportedLevel()), std::memory_order_relaxed);
+}
+
+const char* MathBatch::GetLevelName(SimdLevel level)
+{
+	switch (level)
+	{
+	case SimdLevel::Scalar: return "scalar";
+	case SimdLevel::SSE: return "SSE";
+	case SimdLevel::AVX2: return "AVX2";
+	default: return "unknown";
+	}
+}
+
+void MathBatch::TransformPoints(const Mat4& matrix, const Vec3* points, Vec3* out, size_t count)
+{
+	switch (GetLevel())
+	{
+#if ATCP_MATH_X86
+	case SimdLevel::AVX2: TransformPointsAVX2(matrix, points, out, count); break;
+	case SimdLevel::SSE: TransformPointsSSE(matrix, points, out, count); break;
+#endif
+	default: TransformPointsScalar(matrix, points, out, count); break;
+	}
+}
+
+void MathBatch::MultiplyMatrices(const Mat4* a, const Mat4* b, Mat4* out, size_t count)
+{
+	switch (GetLevel())
+	{
+#if ATCP_MATH_X86
+	case SimdLevel::AVX2: MultiplyMatricesAVX2(a, b, out, count); break;
+	case SimdLevel::SSE: MultiplyMatricesSSE(a, b, out, count); break;
+#endif
+	default: MultiplyMatricesScalar(a, b, out, count); break;
+	}
+}
+
+void MathBatch::TransformBounds(const Mat4* matrices, const Aabb* bounds, Aabb* out, size_t count)
+{
+	switch (GetLevel())
+	{
+#if ATCP_MATH_X86
+	case SimdLevel::AVX2: TransformBoundsAVX2(matrices, bounds, out, count); break;
+	case SimdLevel::SSE: TransformBoundsSSE(matrices, bounds, out, count); break;
+#endif
+	default: TransformBoundsScalar(matrices, bounds, out, count); break;
+	}
+}
+
+Aabb MathBatch::ComputeBounds(const Vec3* points, size_t count)
+{
+	switch (GetLevel())
+	{
+#if ATCP_MATH_X86
+	case SimdLevel::AVX2: return ComputeBoundsAVX2(points, count);
+	case SimdLevel::SSE: return ComputeBoundsSSE(points, count);
+#endif
+	default: return ComputeBoundsScalar(points, count);
+	}
+}
+}
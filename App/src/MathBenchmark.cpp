@@ -0,0 +1,172 @@
+#include "MathBenchmark.hpp"
+#include "Logger.hpp"
+#include "MathBatch.hpp"
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <random>
+#include <vector>
+
+namespace atcp {
+namespace {
+using Clock = std::chrono::steady_clock;
+
+constexpr uint32_t PointCount = 1 << 20;
+constexpr uint32_t MatrixCount = 1 << 18;
+constexpr uint32_t BoundsCount = 1 << 20;
+constexpr uint32_t TimingRepeats = 5;
+
+double SecondsSince(Clock::time_point start)
+{
+	return std::chrono::duration<double>(Clock::now() - start).count();
+}
+
+template<typename Function>
+double TimeBest(Function&& function)
+{
+	double best = 0.0;
+	for (uint32_t repeat = 0; repeat < TimingRepeats; ++repeat)
+	{
+		auto startTime = Clock::now();
+		function();
+		const double elapsed = SecondsSince(startTime);
+		best = repeat == 0 ? elapsed : std::min(best, elapsed);
+	}
+	return best;
+}
+
+// Kernels with fused multiply adds round differently from the scalar ones
+bool NearlyEqual(float a, float b)
+{
+	return std::fabs(a - b) <= 1e-4f * std::max(1.0f, std::fabs(a));
+}
+
+bool NearlyEqual(const Vec3& a, const Vec3& b)
+{
+	return NearlyEqual(a.x, b.x) && NearlyEqual(a.y, b.y) && NearlyEqual(a.z, b.z) && a._pad == b._pad;
+}
+
+bool NearlyEqual(const Vec4& a, const Vec4& b)
+{
+	return NearlyEqual(a.x, b.x) && NearlyEqual(a.y, b.y) && NearlyEqual(a.z, b.z) && NearlyEqual(a.w, b.w);
+}
+
+bool NearlyEqual(const Mat4& a, const Mat4& b)
+{
+	return std::equal(a.columns.begin(), a.columns.end(), b.columns.begin(),
+		[](const Vec4& x, const Vec4& y) { return NearlyEqual(x, y); });
+}
+
+bool NearlyEqual(const Aabb& a, const Aabb& b)
+{
+	return NearlyEqual(a.min, b.min) && NearlyEqual(a.max, b.max);
+}
+
+template<typename Value>
+uint32_t CountMismatches(const std::vector<Value>& values, const std::vector<Value>& expected)
+{
+	uint32_t mismatches = 0;
+	for (size_t i = 0; i < values.size(); ++i)
+	{
+		if (!NearlyEqual(values[i], expected[i]))
+			++mismatches;
+	}
+	return mismatches;
+}
+
+// Rotation, scale and translation, the kind of matrix bounds are transformed by
+Mat4 RandomAffine(std::mt19937& random)
+{
+	std::uniform_real_distribution<float> angle(-3.14159f, 3.14159f);
+	std::uniform_real_distribution<float> scale(0.1f, 4.0f);
+	std::uniform_real_distribution<float> position(-100.0f, 100.0f);
+	const Mat4 translation = Mat4::Translation({ position(random), position(random), position(random) });
+	return translation * Mat4::RotationZ(angle(random)) * Mat4::Scale({ scale(random), scale(random), scale(random) });
+}
+
+struct Timings {
+	double transformPoints = 0.0;
+	double multiplyMatrices = 0.0;
+	double transformBounds = 0.0;
+	double computeBounds = 0.0;
+};
+}
+
+int MathBenchmark::Run()
+{
+	std::mt19937 random(1234);
+	std::uniform_real_distribution<float> coordinate(-10.0f, 10.0f);
+
+	std::vector<Vec3> points(PointCount);
+	for (Vec3& point : points)
+		point = { coordinate(random), coordinate(random), coordinate(random) };
+	std::vector<Mat4> matricesA(MatrixCount);
+	std::vector<Mat4> matricesB(MatrixCount);
+	for (uint32_t i = 0; i < MatrixCount; ++i)
+	{
+		matricesA[i] = RandomAffine(random);
+		matricesB[i] = RandomAffine(random);
+	}
+	std::vector<Mat4> boundsMatrices(BoundsCount);
+	std::vector<Aabb> bounds(BoundsCount);
+	for (uint32_t i = 0; i < BoundsCount; ++i)
+	{
+		boundsMatrices[i] = RandomAffine(random);
+		const Vec3 a = { coordinate(random), coordinate(random), coordinate(random) };
+		const Vec3 b = { coordinate(random), coordinate(random), coordinate(random) };
+		bounds[i] = { Min(a, b), Max(a, b) };
+	}
+	const Mat4 pointMatrix = RandomAffine(random);
+
+	std::vector<Vec3> transformedPoints(PointCount);
+	std::vector<Mat4> products(MatrixCount);
+	std::vector<Aabb> transformedBounds(BoundsCount);
+	Aabb pointBounds;
+
+	std::vector<Vec3> expectedPoints;
+	std::vector<Mat4> expectedProducts;
+	std::vector<Aabb> expectedBounds;
+	Aabb expectedPointBounds;
+	Timings scalarTimings;
+
+	uint32_t failures = 0;
+	const SimdLevel supportedLevel = MathBatch::GetSupportedLevel();
+	for (SimdLevel level = SimdLevel::Scalar; level <= supportedLevel; level = static_cast<SimdLevel>(static_cast<int>(level) + 1))
+	{
+		MathBatch::SetLevel(level);
+		Timings timings;
+		timings.transformPoints = TimeBest([&] { MathBatch::TransformPoints(pointMatrix, points.data(), transformedPoints.data(), PointCount); });
+		timings.multiplyMatrices = TimeBest([&] { MathBatch::MultiplyMatrices(matricesA.data(), matricesB.data(), products.data(), MatrixCount); });
+		timings.transformBounds = TimeBest([&] { MathBatch::TransformBounds(boundsMatrices.data(), bounds.data(), transformedBounds.data(), BoundsCount); });
+		timings.computeBounds = TimeBest([&] { pointBounds = MathBatch::ComputeBounds(points.data(), PointCount); });
+
+		if (level == SimdLevel::Scalar)
+		{
+			scalarTimings = timings;
+			expectedPoints = transformedPoints;
+			expectedProducts = products;
+			expectedBounds = transformedBounds;
+			expectedPointBounds = pointBounds;
+		}
+		else
+		{
+			const uint32_t mismatches = CountMismatches(transformedPoints, expectedPoints) + CountMismatches(products, expectedProducts)
+				+ CountMismatches(transformedBounds, expectedBounds) + (NearlyEqual(pointBounds, expectedPointBounds) ? 0 : 1);
+			if (mismatches != 0)
+				LOG_ERROR("{0} kernels disagree with the scalar ones on {1} results", MathBatch::GetLevelName(level), mismatches);
+			failures += mismatches;
+		}
+
+		LOG_INFO("{0}: transform {1} points {2:.2f} ms ({3:.2f}x), multiply {4} matrices {5:.2f} ms ({6:.2f}x), "
+			"transform {7} bounds {8:.2f} ms ({9:.2f}x), bounds of {1} points {10:.2f} ms ({11:.2f}x)", MathBatch::GetLevelName(level),
+			PointCount, timings.transformPoints * 1000.0, scalarTimings.transformPoints / timings.transformPoints,
+			MatrixCount, timings.multiplyMatrices * 1000.0, scalarTimings.multiplyMatrices / timings.multiplyMatrices,
+			BoundsCount, timings.transformBounds * 1000.0, scalarTimings.transformBounds / timings.transformBounds,
+			timings.computeBounds * 1000.0, scalarTimings.computeBounds / timings.computeBounds);
+	}
+	MathBatch::SetLevel(supportedLevel);
+
+	return failures == 0 ? 0 : 1;
+}
+}
@@ -0,0 +1,267 @@
+#include "MeshCache.hpp"
+#include "Hash.hpp"
+#include "Logger.hpp"
+#include "MeshOptimizer.hpp"
+#include "MeshQuantizer.hpp"
+#include "Profiler.hpp"
+#include "SimpleMeshParser.hpp"
+
+#include <algorithm>
+#include <cstddef>
+#include <cstring>
+#include <fstream>
+#include <limits>
+#include <string>
+#include <system_error>
+#include <utility>
+#include <vector>
+
+namespace atcp
+{
+namespace
+{
+constexpr char CacheMagic[4] = { 'A', 'T', 'M', 'C' };
+
+struct SourceStamp {
+	uint64_t size = 0;
+	int64_t time = 0;
+};
+
+bool GetSourceStamp(const std::filesystem::path& path, SourceStamp& stamp)
+{
+	std::error_code error;
+	auto size = std::filesystem::file_size(path, error);
+	if (error)
+		return false;
+	auto time = std::filesystem::last_write_time(path, error);
+	if (error)
+		return false;
+
+	stamp.size = static_cast<uint64_t>(size);
+	stamp.time = static_cast<int64_t>(time.time_since_epoch().count());
+	return true;
+}
+
+// Rewrites only the source time in the header of an otherwise valid cache
+bool WriteSourceTime(const std::filesystem::path& cachePath, int64_t sourceTime)
+{
+	std::fstream file(cachePath, std::ios::in | std::ios::out | std::ios::binary);
+	if (!file.is_open())
+		return false;
+
+	file.seekp(offsetof(MeshCacheHeader, sourceTime));
+	file.write(reinterpret_cast<const char*>(&sourceTime), sizeof(sourceTime));
+	return static_cast<bool>(file);
+}
+
+uint64_t AlignUp(uint64_t value, uint64_t alignment)
+{
+	return (value + alignment - 1) / alignment * alignment;
+}
+
+enum ImportFlags : uint32_t {
+	ImportFlag_Optimized = 1 << 0,
+	ImportFlag_Welded = 1 << 1,
+	ImportFlag_Quantized = 1 << 2,
+};
+} // namespace
+
+uint32_t MeshImportOptions::GetFlags() const
+{
+	uint32_t flags = 0;
+	if (optimize)
+		flags |= ImportFlag_Optimized;
+	if (weld)
+		flags |= ImportFlag_Welded;
+	if (quantize)
+		flags |= ImportFlag_Quantized;
+	return flags;
+}
+
+bool MeshCache::Load(const std::filesystem::path& cachePath, const std::filesystem::path& sourcePath, const MeshImportOptions& options, MappedMesh& mesh)
+{
+	mesh.m_Header = nullptr;
+	mesh.m_File.Close();
+
+	// Only handed to the mesh once validated so a stale cache is never left mapped
+	MappedFile file;
+	if (!file.Open(cachePath))
+		return false;
+
+	const size_t fileSize = file.Size();
+	if (fileSize < sizeof(MeshCacheHeader))
+	{
+		LOG_WARN("Mesh cache {0} is truncated", cachePath.string());
+		return false;
+	}
+
+	const MeshCacheHeader* header = static_cast<const MeshCacheHeader*>(file.Data());
+	if (std::memcmp(header->magic, CacheMagic, sizeof(CacheMagic)) != 0 || header->version != Version)
+	{
+		LOG_DEBUG("Mesh cache {0} has an unsupported version", cachePath.string());
+		return false;
+	}
+
+	if (header->importFlags != options.GetFlags()
+		|| (options.weld && header->weldTolerance != options.weldTolerance)
+		|| (options.quantize && (header->positionErrorBound != options.positionErrorBound || header->colourErrorBound != options.colourErrorBound)))
+	{
+		LOG_DEBUG("Mesh cache {0} was built with different import options", cachePath.string());
+		return false;
+	}
+
+	if (header->layout.attributeCount > MeshLayout::MaxAttributes
+		|| (header->indexStride != sizeof(uint16_t) && header->indexStride != sizeof(uint32_t))
+		|| header->vertexSize != uint64_t(header->vertexCount) * header->layout.stride
+		|| header->indexSize != uint64_t(header->indexCount) * header->indexStride
+		|| header->vertexOffset + header->vertexSize > fileSize
+		|| header->indexOffset + header->indexSize > fileSize)
+	{
+		LOG_WARN("Mesh cache {0} is corrupt", cachePath.string());
+		return false;
+	}
+
+	// A cache with no source next to it is a shipped asset, trust it
+	SourceStamp stamp;
+	if (GetSourceStamp(sourcePath, stamp)
+		&& (stamp.size != header->sourceSize || stamp.time != header->sourceTime))
+	{
+		// Touched but possibly unchanged, e.g. after a checkout, compare the content
+		MappedFile source;
+		if (stamp.size != header->sourceSize
+			|| !source.Open(sourcePath)
+			|| HashBytes(source.Data(), source.Size()) != header->sourceHash)
+		{
+			LOG_DEBUG("Mesh cache {0} is out of date", cachePath.string());
+			return false;
+		}
+
+		// Record the new time so only this launch pays for the hash, the cache can't be written while mapped on Windows
+		source.Close();
+		file.Close();
+		if (WriteSourceTime(cachePath, stamp.time))
+			return Load(cachePath, sourcePath, options, mesh);
+
+		LOG_DEBUG("Could not update the source time of mesh cache {0}", cachePath.string());
+		if (!file.Open(cachePath) || file.Size() != fileSize)
+			return false;
+		header = static_cast<const MeshCacheHeader*>(file.Data());
+	}
+
+	mesh.m_File = std::move(file);
+	mesh.m_Header = header;
+	return true;
+}
+
+bool MeshCache::Import(const std::filesystem::path& sourcePath, const std::filesystem::path& cachePath, const MeshImportOptions& options)
+{
+	PROFILE_FUNCTION();
+
+	SourceStamp stamp;
+	std::string contents;
+	if (!GetSourceStamp(sourcePath, stamp) || !SimpleMeshParser::ReadFile(sourcePath, contents))
+	{
+		LOG_ERROR("Could not read mesh {0}", sourcePath.string());
+		return false;
+	}
+
+	std::vector<float> vertexData;
+	std::vector<uint32_t> indexData;
+	if (!SimpleMeshParser::ParseGeometry(contents.data(), contents.data() + contents.size(), vertexData, indexData, sourcePath.string()))
+		return false;
+
+	if (options.weld)
+		MeshOptimizer::WeldVertices(vertexData, indexData, SimpleMeshParser::VertexComponents, options.weldTolerance);
+	if (options.optimize)
+		MeshOptimizer::Optimize(vertexData, indexData, SimpleMeshParser::VertexComponents);
+
+	QuantizedMesh encoded = options.quantize
+		? MeshQuantizer::Quantize(vertexData, options.positionErrorBound, options.colourErrorBound)
+		: MeshQuantizer::Passthrough(vertexData);
+	LOG_DEBUG("Vertex stride {0} bytes, {1} of {2} vertex bytes saved by quantization", encoded.layout.stride,
+		vertexData.size() * sizeof(float) - encoded.vertexData.size(), vertexData.size() * sizeof(float));
+
+	MeshCacheHeader header = {};
+	header.sourceSize = stamp.size;
+	header.sourceTime = stamp.time;
+	header.sourceHash = HashBytes(contents.data(), contents.size());
+	header.layout = encoded.layout;
+	header.vertexCount = static_cast<uint32_t>(vertexData.size() / SimpleMeshParser::VertexComponents);
+	header.indexCount = static_cast<uint32_t>(indexData.size());
+	header.importFlags = options.GetFlags();
+	header.weldTolerance = options.weld ? options.weldTolerance : 0.0f;
+	header.positionErrorBound = options.quantize ? options.positionErrorBound : 0.0f;
+	header.colourErrorBound = options.quantize ? options.colourErrorBound : 0.0f;
+	std::copy(encoded.positionTransform.begin(), encoded.positionTransform.end(), header.positionTransform);
+
+	// 16-bit indices halve the index bandwidth whenever every vertex is addressable by them
+	if (header.vertexCount <= std::numeric_limits<uint16_t>::max() + 1u)
+	{
+		std::vector<uint16_t> shortIndexData(indexData.begin(), indexData.end());
+		header.indexStride = sizeof(uint16_t);
+		return Write(cachePath, header, encoded.vertexData.data(), shortIndexData.data());
+	}
+
+	header.indexStride = sizeof(uint32_t);
+	return Write(cachePath, header, encoded.vertexData.data(), indexData.data());
+}
+
+bool MeshCache::LoadOrImport(const std::filesystem::path& sourcePath, const std::filesystem::path& cachePath, const MeshImportOptions& options, MappedMesh& mesh)
+{
+	if (Load(cachePath, sourcePath, options, mesh))
+		return true;
+
+	LOG_INFO("Importing {0}", sourcePath.filename().string());
+	if (!Import(sourcePath, cachePath, options))
+		return false;
+
+	return Load(cachePath, sourcePath, options, mesh);
+}
+
+bool MeshCache::Write(const std::filesystem::path& cachePath, MeshCacheHeader header, const void* vertexData, const void* indexData)
+{
+	std::memcpy(header.magic, CacheMagic, sizeof(CacheMagic));
+	header.version = Version;
+	header.vertexSize = uint64_t(header.vertexCount) * header.layout.stride;
+	header.indexSize = uint64_t(header.indexCount) * header.indexStride;
+	header.vertexOffset = AlignUp(sizeof(MeshCacheHeader), BlobAlignment);
+	header.indexOffset = AlignUp(header.vertexOffset + header.vertexSize, BlobAlignment);
+
+	std::error_code error;
+	if (cachePath.has_parent_path())
+		std::filesystem::create_directories(cachePath.parent_path(), error);
+
+	// Write next to the cache and swap it in so a reader never maps a partial file
+	std::filesystem::path tempPath = cachePath;
+	tempPath += ".tmp";
+	{
+		std::ofstream file(tempPath, std::ios::binary | std::ios::trunc);
+		if (!file.is_open())
+		{
+			LOG_ERROR("Could not write mesh cache {0}", cachePath.string());
+			return false;
+		}
+
+		const char padding[BlobAlignment] = {};
+		file.write(reinterpret_cast<const char*>(&header), sizeof(header));
+		file.write(padding, header.vertexOffset - sizeof(header));
+		file.write(static_cast<const char*>(vertexData), header.vertexSize);
+		file.write(padding, header.indexOffset - (header.vertexOffset + header.vertexSize));
+		file.write(static_cast<const char*>(indexData), header.indexSize);
+		if (!file)
+		{
+			LOG_ERROR("Could not write mesh cache {0}", cachePath.string());
+			return false;
+		}
+	}
+
+	std::filesystem::rename(tempPath, cachePath, error);
+	if (error)
+	{
+		LOG_ERROR("Could not replace mesh cache {0}: {1}", cachePath.string(), error.message());
+		std::filesystem::remove(tempPath, error);
+		return false;
+	}
+	return true;
+}
+} // namespace atcp
@@ -0,0 +1,330 @@
+#include "MeshOptimizer.hpp"
+#include "Hash.hpp"
+#include "Logger.hpp"
+
+#include <chrono>
+#include <cmath>
+#include <cstring>
+#include <limits>
+
+namespace atcp
+{
+namespace
+{
+/**
+ * Triangles using each vertex, stored compressed: the triangles of vertex v are
+ * triangles[offsets[v]] to triangles[offsets[v] + counts[v]].
+ */
+struct VertexAdjacency {
+	std::vector<uint32_t> counts;
+	std::vector<uint32_t> offsets;
+	std::vector<uint32_t> triangles;
+
+	VertexAdjacency(const uint32_t* indices, size_t indexCount, size_t vertexCount)
+		: counts(vertexCount, 0), offsets(vertexCount, 0), triangles(indexCount)
+	{
+		for (size_t i = 0; i < indexCount; ++i)
+			counts[indices[i]]++;
+
+		uint32_t offset = 0;
+		for (size_t v = 0; v < vertexCount; ++v) {
+			offsets[v] = offset;
+			offset += counts[v];
+		}
+
+		std::vector<uint32_t> fill(offsets);
+		for (size_t i = 0; i < indexCount; ++i)
+			triangles[fill[indices[i]]++] = static_cast<uint32_t>(i / 3);
+	}
+};
+
+/**
+ * Open addressing hash table of vertex ids, several vertices may share a hash.
+ */
+class VertexHashTable
+{
+public:
+	static constexpr uint32_t Empty = std::numeric_limits<uint32_t>::max();
+
+	explicit VertexHashTable(size_t count)
+	{
+		size_t capacity = 16;
+		while (capacity < count * 2)
+			capacity *= 2;
+		m_Slots.resize(capacity);
+		m_Mask = capacity - 1;
+	}
+
+	template<typename Match>
+	uint32_t Find(uint64_t hash, Match match) const
+	{
+		for (size_t slot = hash & m_Mask;; slot = (slot + 1) & m_Mask) {
+			const Slot& entry = m_Slots[slot];
+			if (entry.id == Empty)
+				return Empty;
+			if (entry.hash == hash && match(entry.id))
+				return entry.id;
+		}
+	}
+
+	void Insert(uint64_t hash, uint32_t id)
+	{
+		size_t slot = hash & m_Mask;
+		while (m_Slots[slot].id != Empty)
+			slot = (slot + 1) & m_Mask;
+		m_Slots[slot] = { hash, id };
+	}
+
+private:
+	struct Slot {
+		uint64_t hash = 0;
+		uint32_t id = Empty;
+	};
+	std::vector<Slot> m_Slots;
+	size_t m_Mask = 0;
+};
+} // namespace
+
+VertexCacheStats MeshOptimizer::AnalyzeVertexCache(const uint32_t* indices, size_t indexCount, size_t vertexCount, uint32_t cacheSize)
+{
+	VertexCacheStats stats;
+	// Ratios per triangle need at least one
+	if (indexCount < 3 || vertexCount == 0)
+		return stats;
+
+	// A vertex is cached while fewer than cacheSize misses happened since it was loaded
+	std::vector<size_t> loadedAt(vertexCount, 0);
+	size_t time = size_t(cacheSize) + 1;
+	size_t misses = 0;
+	for (size_t i = 0; i < indexCount; ++i) {
+		uint32_t v = indices[i];
+		if (time - loadedAt[v] > cacheSize) {
+			loadedAt[v] = time++;
+			++misses;
+		}
+	}
+
+	stats.acmr = static_cast<float>(misses) / static_cast<float>(indexCount / 3);
+	stats.atvr = static_cast<float>(misses) / static_cast<float>(vertexCount);
+	return stats;
+}
+
+void MeshOptimizer::OptimizeVertexCache(uint32_t* destination, const uint32_t* indices, size_t indexCount, size_t vertexCount, uint32_t cacheSize)
+{
+	const size_t triangleCount = indexCount / 3;
+	if (triangleCount == 0)
+		return;
+
+	VertexAdjacency adjacency(indices, indexCount, vertexCount);
+	std::vector<uint32_t> liveTriangles(adjacency.counts);
+	std::vector<size_t> cacheTime(vertexCount, 0);
+	std::vector<bool> emitted(triangleCount, false);
+
+	std::vector<uint32_t> deadEnd;
+	deadEnd.reserve(indexCount);
+	std::vector<uint32_t> candidates;
+	candidates.reserve(64);
+
+	constexpr uint32_t NoVertex = std::numeric_limits<uint32_t>::max();
+	size_t time = size_t(cacheSize) + 1;
+	uint32_t cursor = 0;
+	uint32_t* out = destination;
+
+	// Start from the first referenced vertex
+	uint32_t fanning = NoVertex;
+	while (cursor < vertexCount && fanning == NoVertex) {
+		if (liveTriangles[cursor] > 0)
+			fanning = cursor;
+		++cursor;
+	}
+
+	while (fanning != NoVertex) {
+		candidates.clear();
+
+		// Emit every remaining triangle around the fanning vertex
+		const uint32_t* begin = adjacency.triangles.data() + adjacency.offsets[fanning];
+		const uint32_t* end = begin + adjacency.counts[fanning];
+		for (const uint32_t* triangle = begin; triangle != end; ++triangle) {
+			if (emitted[*triangle])
+				continue;
+			emitted[*triangle] = true;
+
+			for (size_t corner = 0; corner < 3; ++corner) {
+				uint32_t v = indices[*triangle * 3 + corner];
+				*out++ = v;
+				deadEnd.push_back(v);
+				candidates.push_back(v);
+				liveTriangles[v]--;
+				if (time - cacheTime[v] > cacheSize)
+					cacheTime[v] = time++;
+			}
+		}
+
+		// Prefer the candidate that is oldest in the cache but will still be there after its fan is emitted
+		uint32_t next = NoVertex;
+		size_t bestPriority = 0;
+		for (uint32_t v : candidates) {
+			if (liveTriangles[v] == 0)
+				continue;
+			size_t priority = 0;
+			if (time - cacheTime[v] + 2 * size_t(liveTriangles[v]) <= cacheSize)
+				priority = time - cacheTime[v];
+			if (next == NoVertex || priority > bestPriority) {
+				bestPriority = priority;
+				next = v;
+			}
+		}
+
+		// Dead end, fall back to recently used vertices then to input order
+		while (next == NoVertex && !deadEnd.empty()) {
+			uint32_t v = deadEnd.back();
+			deadEnd.pop_back();
+			if (liveTriangles[v] > 0)
+				next = v;
+		}
+		while (next == NoVertex && cursor < vertexCount) {
+			if (liveTriangles[cursor] > 0)
+				next = cursor;
+			++cursor;
+		}
+
+		fanning = next;
+	}
+}
+
+size_t MeshOptimizer::OptimizeVertexFetch(void* destination, uint32_t* indices, size_t indexCount, const void* vertices, size_t vertexCount, size_t vertexStride)
+{
+	constexpr uint32_t Unused = std::numeric_limits<uint32_t>::max();
+	std::vector<uint32_t> remap(vertexCount, Unused);
+
+	const unsigned char* source = static_cast<const unsigned char*>(vertices);
+	unsigned char* target = static_cast<unsigned char*>(destination);
+	uint32_t nextVertex = 0;
+	for (size_t i = 0; i < indexCount; ++i) {
+		uint32_t v = indices[i];
+		if (remap[v] == Unused) {
+			std::memcpy(target + size_t(nextVertex) * vertexStride, source + size_t(v) * vertexStride, vertexStride);
+			remap[v] = nextVertex++;
+		}
+		indices[i] = remap[v];
+	}
+	return nextVertex;
+}
+
+size_t MeshOptimizer::WeldVertices(std::vector<float>& vertexData, std::vector<uint32_t>& indexData, size_t vertexComponents, float tolerance)
+{
+	const size_t vertexCount = vertexData.size() / vertexComponents;
+	if (vertexCount == 0)
+		return 0;
+
+	VertexHashTable table(vertexCount);
+	std::vector<uint32_t> remap(vertexCount);
+	const size_t recordSize = vertexComponents * sizeof(float);
+	const float* vertices = vertexData.data();
+
+	if (tolerance <= 0.0f) {
+		for (size_t v = 0; v < vertexCount; ++v) {
+			const float* record = vertices + v * vertexComponents;
+			uint64_t hash = HashBytes(record, recordSize);
+			uint32_t match = table.Find(hash, [&](uint32_t other) {
+				return std::memcmp(record, vertices + size_t(other) * vertexComponents, recordSize) == 0;
+			});
+			if (match == VertexHashTable::Empty) {
+				table.Insert(hash, static_cast<uint32_t>(v));
+				match = static_cast<uint32_t>(v);
+			}
+			remap[v] = match;
+		}
+	}
+	else {
+		// Grid of cells twice the tolerance wide, a vertex within tolerance of another is in the same
+		// cell or the neighbour on the side its fractional position is nearest, so 2^components cells are probed
+		const float cellSize = 2.0f * tolerance;
+		const size_t probeCount = size_t(1) << vertexComponents;
+		std::vector<int64_t> cell(vertexComponents);
+		std::vector<int64_t> probe(vertexComponents);
+		std::vector<int64_t> side(vertexComponents);
+
+		for (size_t v = 0; v < vertexCount; ++v) {
+			const float* record = vertices + v * vertexComponents;
+			for (size_t c = 0; c < vertexComponents; ++c) {
+				float scaled = record[c] / cellSize;
+				float base = std::floor(scaled);
+				cell[c] = static_cast<int64_t>(base);
+				side[c] = (scaled - base) < 0.5f ? -1 : 1;
+			}
+
+			auto withinTolerance = [&](uint32_t other) {
+				const float* otherRecord = vertices + size_t(other) * vertexComponents;
+				for (size_t c = 0; c < vertexComponents; ++c) {
+					if (std::fabs(record[c] - otherRecord[c]) > tolerance)
+						return false;
+				}
+				return true;
+			};
+
+			uint32_t match = VertexHashTable::Empty;
+			for (size_t mask = 0; mask < probeCount && match == VertexHashTable::Empty; ++mask) {
+				for (size_t c = 0; c < vertexComponents; ++c)
+					probe[c] = cell[c] + ((mask >> c) & 1 ? side[c] : 0);
+				match = table.Find(HashBytes(probe.data(), probe.size() * sizeof(int64_t)), withinTolerance);
+			}
+
+			if (match == VertexHashTable::Empty) {
+				table.Insert(HashBytes(cell.data(), cell.size() * sizeof(int64_t)), static_cast<uint32_t>(v));
+				match = static_cast<uint32_t>(v);
+			}
+			remap[v] = match;
+		}
+	}
+
+	// Compact the kept vertices in their original order
+	size_t keptCount = 0;
+	for (size_t v = 0; v < vertexCount; ++v) {
+		if (remap[v] == v) {
+			if (keptCount != v)
+				std::memmove(vertexData.data() + keptCount * vertexComponents, vertices + v * vertexComponents, recordSize);
+			remap[v] = static_cast<uint32_t>(keptCount++);
+		}
+		else {
+			remap[v] = remap[remap[v]];
+		}
+	}
+	vertexData.resize(keptCount * vertexComponents);
+
+	for (uint32_t& index : indexData)
+		index = remap[index];
+
+	const size_t removed = vertexCount - keptCount;
+	LOG_DEBUG("Welded {0} of {1} vertices, saving {2} bytes", removed, vertexCount, removed * recordSize);
+	return removed;
+}
+
+void MeshOptimizer::Optimize(std::vector<float>& vertexData, std::vector<uint32_t>& indexData, size_t vertexComponents)
+{
+	const size_t vertexCount = vertexData.size() / vertexComponents;
+#ifdef DEBUG
+	// Only logged in debug builds
+	auto startTime = std::chrono::steady_clock::now();
+	VertexCacheStats before = AnalyzeVertexCache(indexData.data(), indexData.size(), vertexCount);
+#endif
+
+	std::vector<uint32_t> optimizedIndices(indexData.size());
+	OptimizeVertexCache(optimizedIndices.data(), indexData.data(), indexData.size(), vertexCount);
+
+	std::vector<float> optimizedVertices(vertexData.size());
+	size_t usedVertices = OptimizeVertexFetch(optimizedVertices.data(), optimizedIndices.data(), optimizedIndices.size(),
+		vertexData.data(), vertexCount, vertexComponents * sizeof(float));
+	optimizedVertices.resize(usedVertices * vertexComponents);
+
+	vertexData.swap(optimizedVertices);
+	indexData.swap(optimizedIndices);
+
+#ifdef DEBUG
+	VertexCacheStats after = AnalyzeVertexCache(indexData.data(), indexData.size(), usedVertices);
+	std::chrono::duration<double> elapsed = std::chrono::steady_clock::now() - startTime;
+	LOG_DEBUG("Optimized mesh in {0:.2f} ms: ACMR {1:.3f} -> {2:.3f}, ATVR {3:.3f} -> {4:.3f}, {5} unreferenced vertices removed",
+		elapsed.count() * 1000.0, before.acmr, after.acmr, before.atvr, after.atvr, vertexCount - usedVertices);
+#endif
+}
+} // namespace atcp
@@ -0,0 +1,203 @@
+#include "MeshQuantizer.hpp"
+
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+#include <limits>
+
+namespace atcp
+{
+namespace
+{
+constexpr size_t Components = 5;
+constexpr size_t ColourOffset = 2;
+
+int16_t EncodeSnorm16(float value)
+{
+	value = std::clamp(value, -1.0f, 1.0f);
+	return static_cast<int16_t>(std::lround(value * 32767.0f));
+}
+
+float DecodeSnorm16(int16_t value)
+{
+	return std::max(static_cast<float>(value) / 32767.0f, -1.0f);
+}
+
+uint8_t EncodeUnorm8(float value)
+{
+	value = std::clamp(value, 0.0f, 1.0f);
+	return static_cast<uint8_t>(std::lround(value * 255.0f));
+}
+
+template<typename T>
+void Store(unsigned char* destination, const T& value)
+{
+	std::memcpy(destination, &value, sizeof(T));
+}
+} // namespace
+
+uint16_t MeshQuantizer::FloatToHalf(float value)
+{
+	uint32_t bits;
+	std::memcpy(&bits, &value, sizeof(bits));
+
+	const uint32_t sign = (bits >> 16) & 0x8000;
+	const uint32_t biasedExponent = (bits >> 23) & 0xff;
+	uint32_t mantissa = bits & 0x7fffff;
+
+	if (biasedExponent == 0xff)
+		return static_cast<uint16_t>(sign | 0x7c00 | (mantissa ? 0x200 : 0));
+
+	const int32_t exponent = static_cast<int32_t>(biasedExponent) - 127 + 15;
+	if (exponent >= 31)
+		return static_cast<uint16_t>(sign | 0x7c00);
+
+	if (exponent <= 0) {
+		// Subnormal half
+		if (exponent < -10)
+			return static_cast<uint16_t>(sign);
+		mantissa |= 0x800000;
+		const uint32_t shift = static_cast<uint32_t>(14 - exponent);
+		uint32_t half = mantissa >> shift;
+		const uint32_t remainder = mantissa & ((1u << shift) - 1);
+		const uint32_t halfway = 1u << (shift - 1);
+		if (remainder > halfway || (remainder == halfway && (half & 1)))
+			++half;
+		return static_cast<uint16_t>(sign | half);
+	}
+
+	// Round to nearest even, a carry out of the mantissa correctly bumps the exponent
+	uint32_t half = sign | (static_cast<uint32_t>(exponent) << 10) | (mantissa >> 13);
+	const uint32_t remainder = mantissa & 0x1fff;
+	if (remainder > 0x1000 || (remainder == 0x1000 && (half & 1)))
+		++half;
+	return static_cast<uint16_t>(half);
+}
+
+float MeshQuantizer::HalfToFloat(uint16_t value)
+{
+	const uint32_t sign = (uint32_t(value) & 0x8000) << 16;
+	const uint32_t exponent = (value >> 10) & 0x1f;
+	const uint32_t mantissa = value & 0x3ff;
+
+	if (exponent == 0) {
+		float subnormal = std::ldexp(static_cast<float>(mantissa), -24);
+		return sign ? -subnormal : subnormal;
+	}
+
+	uint32_t bits;
+	if (exponent == 31)
+		bits = sign | 0x7f800000 | (mantissa << 13);
+	else
+		bits = sign | ((exponent - 15 + 127) << 23) | (mantissa << 13);
+
+	float result;
+	std::memcpy(&result, &bits, sizeof(result));
+	return result;
+}
+
+QuantizedMesh MeshQuantizer::Quantize(const std::vector<float>& vertexData, float positionErrorBound, float colourErrorBound)
+{
+	const size_t vertexCount = vertexData.size() / Components;
+
+	float minPosition[2] = { std::numeric_limits<float>::max(), std::numeric_limits<float>::max() };
+	float maxPosition[2] = { std::numeric_limits<float>::lowest(), std::numeric_limits<float>::lowest() };
+	bool coloursInRange = true;
+	for (size_t v = 0; v < vertexCount; ++v) {
+		const float* vertex = vertexData.data() + v * Components;
+		for (size_t c = 0; c < 2; ++c) {
+			minPosition[c] = std::min(minPosition[c], vertex[c]);
+			maxPosition[c] = std::max(maxPosition[c], vertex[c]);
+		}
+		for (size_t c = ColourOffset; c < Components; ++c)
+			coloursInRange = coloursInRange && vertex[c] >= 0.0f && vertex[c] <= 1.0f;
+	}
+
+	float offset[2] = { 0.0f, 0.0f };
+	float scale[2] = { 1.0f, 1.0f };
+	for (size_t c = 0; c < 2 && vertexCount > 0; ++c) {
+		offset[c] = 0.5f * (minPosition[c] + maxPosition[c]);
+		float halfExtent = 0.5f * (maxPosition[c] - minPosition[c]);
+		scale[c] = halfExtent > 0.0f ? halfExtent : 1.0f;
+	}
+
+	// Measure the worst round trip error of each candidate format
+	float snormError = 0.0f;
+	float halfError = 0.0f;
+	float unormError = 0.0f;
+	for (size_t v = 0; v < vertexCount; ++v) {
+		const float* vertex = vertexData.data() + v * Components;
+		for (size_t c = 0; c < 2; ++c) {
+			float snorm = DecodeSnorm16(EncodeSnorm16((vertex[c] - offset[c]) / scale[c])) * scale[c] + offset[c];
+			float half = HalfToFloat(FloatToHalf(vertex[c] - offset[c])) + offset[c];
+			snormError = std::max(snormError, std::fabs(snorm - vertex[c]));
+			halfError = std::max(halfError, std::fabs(half - vertex[c]));
+		}
+		for (size_t c = ColourOffset; c < Components && coloursInRange; ++c)
+			unormError = std::max(unormError, std::fabs(EncodeUnorm8(vertex[c]) / 255.0f - vertex[c]));
+	}
+
+	QuantizedMesh mesh;
+	VertexAttributeFormat positionFormat = VertexAttributeFormat::Float32x2;
+	if (snormError <= positionErrorBound && snormError <= halfError) {
+		positionFormat = VertexAttributeFormat::Snorm16x2;
+		mesh.positionTransform = { scale[0], scale[1], offset[0], offset[1] };
+	}
+	else if (halfError <= positionErrorBound) {
+		positionFormat = VertexAttributeFormat::Float16x2;
+		mesh.positionTransform = { 1.0f, 1.0f, offset[0], offset[1] };
+	}
+
+	VertexAttributeFormat colourFormat = VertexAttributeFormat::Float32x3;
+	if (coloursInRange && unormError <= colourErrorBound)
+		colourFormat = VertexAttributeFormat::Unorm8x4;
+
+	const uint32_t positionSize = GetFormatSize(positionFormat);
+	mesh.layout.attributeCount = 2;
+	mesh.layout.attributes[0] = { 0, positionFormat, 0 };
+	mesh.layout.attributes[1] = { 1, colourFormat, positionSize };
+	mesh.layout.stride = positionSize + GetFormatSize(colourFormat);
+
+	mesh.vertexData.resize(vertexCount * mesh.layout.stride);
+	for (size_t v = 0; v < vertexCount; ++v) {
+		const float* vertex = vertexData.data() + v * Components;
+		unsigned char* out = mesh.vertexData.data() + v * mesh.layout.stride;
+
+		for (size_t c = 0; c < 2; ++c) {
+			switch (positionFormat) {
+			case VertexAttributeFormat::Snorm16x2:
+				Store(out + c * sizeof(int16_t), EncodeSnorm16((vertex[c] - offset[c]) / scale[c]));
+				break;
+			case VertexAttributeFormat::Float16x2:
+				Store(out + c * sizeof(uint16_t), FloatToHalf(vertex[c] - offset[c]));
+				break;
+			default:
+				Store(out + c * sizeof(float), vertex[c]);
+				break;
+			}
+		}
+
+		out += positionSize;
+		if (colourFormat == VertexAttributeFormat::Unorm8x4) {
+			for (size_t c = 0; c < 3; ++c)
+				out[c] = EncodeUnorm8(vertex[ColourOffset + c]);
+			out[3] = 255;
+		}
+		else {
+			std::memcpy(out, vertex + ColourOffset, 3 * sizeof(float));
+		}
+	}
+
+	return mesh;
+}
+
+QuantizedMesh MeshQuantizer::Passthrough(const std::vector<float>& vertexData)
+{
+	QuantizedMesh mesh;
+	mesh.layout = MeshLayout::PositionColour();
+	mesh.vertexData.resize(vertexData.size() * sizeof(float));
+	if (!vertexData.empty())
+		std::memcpy(mesh.vertexData.data(), vertexData.data(), mesh.vertexData.size());
+	return mesh;
+}
+} // namespace atcp
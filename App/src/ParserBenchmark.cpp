@@ -0,0 +1,266 @@
+#include "ParserBenchmark.hpp"
+#include "JobSystem.hpp"
+#include "Logger.hpp"
+#include "SimpleMeshParser.hpp"
+
+#include <algorithm>
+#include <chrono>
+#include <cstring>
+#include <iterator>
+#include <random>
+#include <sstream>
+#include <string>
+#include <vector>
+
+namespace atcp {
+namespace {
+using Clock = std::chrono::steady_clock;
+
+// About 100 MB of text
+constexpr uint32_t VertexCount = 1750000;
+constexpr uint32_t TriangleCount = 1560000;
+constexpr uint32_t TimingRepeats = 3;
+
+double SecondsSince(Clock::time_point start)
+{
+	return std::chrono::duration<double>(Clock::now() - start).count();
+}
+
+template<typename Function>
+double TimeBest(Function&& function)
+{
+	double best = 0.0;
+	for (uint32_t repeat = 0; repeat < TimingRepeats; ++repeat)
+	{
+		auto startTime = Clock::now();
+		function();
+		const double elapsed = SecondsSince(startTime);
+		best = repeat == 0 ? elapsed : std::min(best, elapsed);
+	}
+	return best;
+}
+
+double MegabytesPerSecond(size_t bytes, double seconds)
+{
+	return seconds > 0.0 ? bytes / (1024.0 * 1024.0) / seconds : 0.0;
+}
+
+// Laid out like resources/simple_mesh.txt, with a comment and a blank line every few thousand records
+void AppendVertices(std::string& text, uint32_t vertexCount, const char* newline, std::mt19937& random)
+{
+	std::uniform_real_distribution<float> position(-1.0f, 1.0f);
+	std::uniform_real_distribution<float> colour(0.0f, 1.0f);
+
+	auto out = std::back_inserter(text);
+	fmt::format_to(out, "[vertices]{0}# x   y      r   g   b{0}{0}", newline);
+	for (uint32_t i = 0; i < vertexCount; ++i)
+	{
+		if (i % 4096 == 4095)
+			fmt::format_to(out, "# vertex {0}{1}{1}", i, newline);
+		fmt::format_to(out, "{0:.6f} {1:.6f} {2:.4f} {3:.4f} {4:.4f}{5}", position(random), position(random), colour(random), colour(random), colour(random), newline);
+	}
+	fmt::format_to(out, "{0}", newline);
+}
+
+void AppendTriangle(std::string& text, uint32_t triangle, uint32_t vertexCount, const char* newline, std::mt19937& random)
+{
+	std::uniform_int_distribution<uint32_t> index(0, vertexCount - 1);
+
+	auto out = std::back_inserter(text);
+	if (triangle == 0)
+		fmt::format_to(out, "[indices]{0}", newline);
+	if (triangle % 4096 == 4095)
+		fmt::format_to(out, "# triangle {0}{1}{1}", triangle, newline);
+	fmt::format_to(out, "{0} {1} {2}{3}", index(random), index(random), index(random), newline);
+}
+
+std::string GenerateMesh(uint32_t vertexCount, uint32_t triangleCount)
+{
+	std::mt19937 random(1234);
+	std::string text;
+	AppendVertices(text, vertexCount, "\n", random);
+	for (uint32_t i = 0; i < triangleCount; ++i)
+		AppendTriangle(text, i, vertexCount, "\n", random);
+	return text;
+}
+
+/**
+ * The parser SimpleMeshParser::ParseGeometry replaced: one getline and one istringstream per line, with 32 bit
+ * indices so it can read meshes of this size.
+ */
+void ParseWithStreams(const std::string& text, std::vector<float>& vertexData, std::vector<uint32_t>& indexData)
+{
+	vertexData.clear();
+	indexData.clear();
+
+	enum class Section {
+		None,
+		Vertices,
+		Indices
+	};
+	Section currentSection = Section::None;
+
+	std::istringstream file(text);
+	float value;
+	uint32_t index;
+	std::string line;
+	while (std::getline(file, line))
+	{
+		if (!line.empty() && line.back() == '\r')
+			line.pop_back();
+
+		if (line == "[vertices]")
+			currentSection = Section::Vertices;
+		else if (line == "[indices]")
+			currentSection = Section::Indices;
+		else if (line.empty() || line[0] == '#')
+			continue;
+		else if (currentSection == Section::Vertices)
+		{
+			std::istringstream iss(line);
+			for (size_t i = 0; i < SimpleMeshParser::VertexComponents; ++i)
+			{
+				iss >> value;
+				vertexData.push_back(value);
+			}
+		}
+		else if (currentSection == Section::Indices)
+		{
+			std::istringstream iss(line);
+			for (size_t i = 0; i < SimpleMeshParser::IndexComponents; ++i)
+			{
+				iss >> index;
+				indexData.push_back(index);
+			}
+		}
+	}
+}
+
+// Over 8 MB once the triangles are added, so every chunk count is used as it is
+constexpr uint32_t CheckVertexCount = 120000;
+constexpr unsigned CheckChunkCounts[] = { 2, 3, 4, 8 };
+// Where the halfway split falls relative to the start of the [indices] header, chunks are extended to the end of
+// the line the split falls in
+constexpr int CheckHeaderOffsets[] = { -2, -1, 0, 1, 5, 11 };
+
+/**
+ * Vertices and triangles in equal halves, padded with a comment at the end so the halfway split falls
+ * 'headerOffset' bytes from the [indices] header. The other chunk counts split in the middle of records.
+ */
+std::string GenerateSplitMesh(int headerOffset, const char* newline)
+{
+	std::mt19937 random(1234);
+	std::string text;
+	AppendVertices(text, CheckVertexCount, newline, random);
+	const size_t headerStart = text.size();
+	uint32_t triangleCount = 0;
+	while (text.size() - headerStart + 128 < headerStart)
+		AppendTriangle(text, triangleCount++, CheckVertexCount, newline, random);
+
+	// The split is at half the size rounded down
+	const size_t padding = 2 * (headerStart + headerOffset) - text.size();
+	text += '#';
+	text.append(padding - 1 - std::strlen(newline), '-');
+	text += newline;
+	return text;
+}
+
+// Both parsers round to nearest, so the values must match exactly
+template<typename Value>
+uint32_t CountMismatches(const std::vector<Value>& values, const std::vector<Value>& expected)
+{
+	if (values.size() != expected.size())
+		return static_cast<uint32_t>(std::max(values.size(), expected.size()));
+	uint32_t mismatches = 0;
+	for (size_t i = 0; i < values.size(); ++i)
+	{
+		if (values[i] != expected[i])
+			++mismatches;
+	}
+	return mismatches;
+}
+}
+
+int ParserBenchmark::Run()
+{
+	auto startTime = Clock::now();
+	const std::string text = GenerateMesh(VertexCount, TriangleCount);
+	const size_t size = text.size();
+	LOG_INFO("Generated {0} vertices and {1} triangles, {2:.1f} MB in {3:.2f} s", VertexCount, TriangleCount,
+		size / (1024.0 * 1024.0), SecondsSince(startTime));
+
+	std::vector<float> vertexData;
+	std::vector<uint32_t> indexData;
+	bool parsed = true;
+	const double serial = TimeBest([&] {
+		parsed &= SimpleMeshParser::ParseGeometry(text.data(), text.data() + size, vertexData, indexData, "<benchmark>", 1);
+	});
+	const double parallel = TimeBest([&] {
+		parsed &= SimpleMeshParser::ParseGeometry(text.data(), text.data() + size, vertexData, indexData, "<benchmark>");
+	});
+
+	// Takes seconds at this size, so it is timed once
+	std::vector<float> expectedVertexData;
+	std::vector<uint32_t> expectedIndexData;
+	startTime = Clock::now();
+	ParseWithStreams(text, expectedVertexData, expectedIndexData);
+	const double streams = SecondsSince(startTime);
+
+	LOG_INFO("Stream parser {0:.1f} MB/s, new parser on 1 thread {1:.1f} MB/s ({2:.2f}x), on {3} threads {4:.1f} MB/s ({5:.2f}x)",
+		MegabytesPerSecond(size, streams), MegabytesPerSecond(size, serial), streams / serial, JobSystem::GetThreadCount(),
+		MegabytesPerSecond(size, parallel), streams / parallel);
+
+	if (!parsed)
+	{
+		LOG_ERROR("The new parser failed on the generated mesh");
+		return 1;
+	}
+	const uint32_t mismatches = CountMismatches(vertexData, expectedVertexData) + CountMismatches(indexData, expectedIndexData);
+	if (mismatches != 0)
+	{
+		LOG_ERROR("The new parser disagrees with the stream parser on {0} values", mismatches);
+		return 1;
+	}
+	return 0;
+}
+
+int ParserBenchmark::Check()
+{
+	std::vector<float> expectedVertexData;
+	std::vector<uint32_t> expectedIndexData;
+	std::vector<float> vertexData;
+	std::vector<uint32_t> indexData;
+	bool parsed = true;
+	uint32_t parses = 0;
+	uint32_t failures = 0;
+	for (const char* newline : { "\n", "\r\n" })
+	{
+		for (int headerOffset : CheckHeaderOffsets)
+		{
+			const std::string text = GenerateSplitMesh(headerOffset, newline);
+			parsed &= SimpleMeshParser::ParseGeometry(text.data(), text.data() + text.size(), expectedVertexData, expectedIndexData, "<check>", 1);
+			for (unsigned chunkCount : CheckChunkCounts)
+			{
+				parsed &= SimpleMeshParser::ParseGeometry(text.data(), text.data() + text.size(), vertexData, indexData, "<check>", chunkCount);
+				const uint32_t mismatches = CountMismatches(vertexData, expectedVertexData) + CountMismatches(indexData, expectedIndexData);
+				if (mismatches != 0)
+				{
+					LOG_ERROR("{0} chunks with {1} line endings and the split {2} bytes from the [indices] header disagree with one chunk on {3} values",
+						chunkCount, newline[0] == '\r' ? "CRLF" : "LF", headerOffset, mismatches);
+				}
+				failures += mismatches;
+				++parses;
+			}
+		}
+	}
+
+	LOG_INFO("Compared {0} parses split into 2 to {1} chunks with one chunk, {2} mismatched values", parses,
+		CheckChunkCounts[std::size(CheckChunkCounts) - 1], failures);
+	if (!parsed)
+	{
+		LOG_ERROR("The parser failed on a generated mesh");
+		return 1;
+	}
+	return failures == 0 ? 0 : 1;
+}
+}
@@ -0,0 +1,357 @@
+#include "PipelineCache.hpp"
+#include "Hash.hpp"
+#include "JobSystem.hpp"
+#include "Logger.hpp"
+#include "Profiler.hpp"
+
+#include <algorithm>
+#include <chrono>
+#include <fstream>
+
+namespace atcp {
+namespace {
+wgpu::VertexFormat ToWGPUFormat(VertexAttributeFormat format)
+{
+	switch (format)
+	{
+	case VertexAttributeFormat::Float32x2: return wgpu::VertexFormat::Float32x2;
+	case VertexAttributeFormat::Float32x3: return wgpu::VertexFormat::Float32x3;
+	case VertexAttributeFormat::Snorm16x2: return wgpu::VertexFormat::Snorm16x2;
+	case VertexAttributeFormat::Float16x2: return wgpu::VertexFormat::Float16x2;
+	case VertexAttributeFormat::Unorm8x4: return wgpu::VertexFormat::Unorm8x4;
+	}
+	return wgpu::VertexFormat::Undefined;
+}
+
+uint64_t HashString(const std::string& text, uint64_t hash)
+{
+	return HashBytes(text.data(), text.size(), HashValue(text.size(), hash));
+}
+
+uint64_t HashEntry(const wgpu::BindGroupLayoutEntry& entry, uint64_t hash)
+{
+	hash = HashValue(entry.binding, hash);
+	hash = HashValue(entry.visibility, hash);
+	hash = HashValue(entry.buffer.type, hash);
+	hash = HashValue(entry.buffer.hasDynamicOffset, hash);
+	hash = HashValue(entry.buffer.minBindingSize, hash);
+	hash = HashValue(entry.sampler.type, hash);
+	hash = HashValue(entry.texture.sampleType, hash);
+	hash = HashValue(entry.texture.viewDimension, hash);
+	hash = HashValue(entry.texture.multisampled, hash);
+	hash = HashValue(entry.storageTexture.access, hash);
+	hash = HashValue(entry.storageTexture.format, hash);
+	return HashValue(entry.storageTexture.viewDimension, hash);
+}
+
+bool EntriesEqual(const wgpu::BindGroupLayoutEntry& a, const wgpu::BindGroupLayoutEntry& b)
+{
+	return a.binding == b.binding && a.visibility == b.visibility
+		&& a.buffer.type == b.buffer.type && a.buffer.hasDynamicOffset == b.buffer.hasDynamicOffset
+		&& a.buffer.minBindingSize == b.buffer.minBindingSize
+		&& a.sampler.type == b.sampler.type
+		&& a.texture.sampleType == b.texture.sampleType && a.texture.viewDimension == b.texture.viewDimension
+		&& a.texture.multisampled == b.texture.multisampled
+		&& a.storageTexture.access == b.storageTexture.access && a.storageTexture.format == b.storageTexture.format
+		&& a.storageTexture.viewDimension == b.storageTexture.viewDimension;
+}
+
+double SecondsSince(std::chrono::steady_clock::time_point start)
+{
+	return std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+}
+}
+
+uint64_t RenderPipelineState::Hash() const
+{
+	uint64_t hash = HashValue(shaderHash);
+	hash = HashString(vertexEntryPoint, hash);
+	hash = HashString(fragmentEntryPoint, hash);
+	hash = HashValue(vertexLayout, hash);
+	hash = HashValue(topology, hash);
+	hash = HashValue(cullMode, hash);
+	hash = HashValue(colourFormat, hash);
+	hash = HashValue(sampleCount, hash);
+	hash = HashValue(blend, hash);
+	if (blend)
+	{
+		hash = HashValue(srcFactor, hash);
+		hash = HashValue(dstFactor, hash);
+		hash = HashValue(blendOperation, hash);
+	}
+	const WGPUBindGroupLayout layoutHandle = bindGroupLayout;
+	return HashValue(layoutHandle, hash);
+}
+
+bool RenderPipelineState::operator==(const RenderPipelineState& other) const
+{
+	if (blend != other.blend)
+		return false;
+	if (blend && (srcFactor != other.srcFactor || dstFactor != other.dstFactor || blendOperation != other.blendOperation))
+		return false;
+	return shaderHash == other.shaderHash && vertexEntryPoint == other.vertexEntryPoint
+		&& fragmentEntryPoint == other.fragmentEntryPoint && vertexLayout == other.vertexLayout
+		&& topology == other.topology && cullMode == other.cullMode && colourFormat == other.colourFormat
+		&& sampleCount == other.sampleCount && bindGroupLayout == other.bindGroupLayout;
+}
+
+bool PipelineCache::BindGroupLayoutKey::operator==(const BindGroupLayoutKey& other) const
+{
+	return hash == other.hash && std::equal(entries.begin(), entries.end(), other.entries.begin(), other.entries.end(), EntriesEqual);
+}
+
+PipelineCache::~PipelineCache()
+{
+	Clear();
+}
+
+void PipelineCache::Init(wgpu::Device device, GpuResources& resources)
+{
+	Clear();
+	m_Device = device;
+	m_Resources = &resources;
+}
+
+void PipelineCache::Clear()
+{
+	std::lock_guard<std::mutex> lock(m_Mutex);
+	for (auto& [state, pipeline] : m_RenderPipelines)
+		m_Resources->Destroy(pipeline);
+	for (auto& [bindGroupLayout, layout] : m_PipelineLayouts)
+		layout.release();
+	for (auto& [key, layout] : m_BindGroupLayouts)
+		layout.release();
+	for (auto& [hash, entry] : m_ShaderModules)
+		m_Resources->Destroy(entry.module);
+	m_RenderPipelines.clear();
+	m_PipelineLayouts.clear();
+	m_BindGroupLayouts.clear();
+	m_ShaderModules.clear();
+	m_Stats = PipelineCacheStats();
+}
+
+wgpu::ShaderModule PipelineCache::GetShaderModule(const std::filesystem::path& path, uint64_t* shaderHash)
+{
+	std::ifstream file(path);
+	if (!file.is_open()) {
+		LOG_CRITICAL("Could not load shader from {0}", path.string());
+		return nullptr;
+	}
+	file.seekg(0, std::ios::end);
+	size_t size = file.tellg();
+	std::string shaderSource(size, ' ');
+	file.seekg(0);
+	file.read(shaderSource.data(), size);
+
+	const uint64_t hash = HashBytes(shaderSource.data(), shaderSource.size());
+	if (shaderHash)
+		*shaderHash = hash;
+
+	std::lock_guard<std::mutex> lock(m_Mutex);
+	auto found = m_ShaderModules.find(hash);
+	if (found != m_ShaderModules.end())
+	{
+		if (found->second.source != shaderSource)
+		{
+			LOG_ERROR("Shader {0} has the same hash as a different shader in the cache", path.string());
+			return nullptr;
+		}
+		++m_Stats.shaderHits;
+		return m_Resources->Get(found->second.module);
+	}
+
+	PROFILE_SCOPE("Create shader module");
+	auto startTime = std::chrono::steady_clock::now();
+
+	wgpu::ShaderModuleWGSLDescriptor shaderCodeDesc{};
+	shaderCodeDesc.chain.next = nullptr;
+	shaderCodeDesc.chain.sType = wgpu::SType::ShaderModuleWGSLDescriptor;
+	shaderCodeDesc.code = shaderSource.c_str();
+	wgpu::ShaderModuleDescriptor shaderDesc{};
+	shaderDesc.hintCount = 0;
+	shaderDesc.hints = nullptr;
+	shaderDesc.nextInChain = &shaderCodeDesc.chain;
+	wgpu::ShaderModule shaderModule = m_Device.createShaderModule(shaderDesc);
+
+	++m_Stats.shaderMisses;
+	m_Stats.shaderCreateTime += SecondsSince(startTime);
+	m_ShaderModules.emplace(hash, ShaderModuleEntry{ std::move(shaderSource), m_Resources->Add(shaderModule) });
+	return shaderModule;
+}
+
+wgpu::BindGroupLayout PipelineCache::GetBindGroupLayout(const wgpu::BindGroupLayoutEntry* entries, size_t entryCount)
+{
+	BindGroupLayoutKey key;
+	key.entries.assign(entries, entries + entryCount);
+	key.hash = HashValue(entryCount);
+	for (const wgpu::BindGroupLayoutEntry& entry : key.entries)
+		key.hash = HashEntry(entry, key.hash);
+
+	std::lock_guard<std::mutex> lock(m_Mutex);
+	auto found = m_BindGroupLayouts.find(key);
+	if (found != m_BindGroupLayouts.end())
+		return found->second;
+
+	wgpu::BindGroupLayoutDescriptor bindGroupLayoutDesc{};
+	bindGroupLayoutDesc.entryCount = entryCount;
+	bindGroupLayoutDesc.entries = entries;
+	wgpu::BindGroupLayout bindGroupLayout = m_Device.createBindGroupLayout(bindGroupLayoutDesc);
+	m_BindGroupLayouts.emplace(std::move(key), bindGroupLayout);
+	return bindGroupLayout;
+}
+
+wgpu::PipelineLayout PipelineCache::GetPipelineLayout(wgpu::BindGroupLayout bindGroupLayout)
+{
+	const WGPUBindGroupLayout layoutHandle = bindGroupLayout;
+
+	std::lock_guard<std::mutex> lock(m_Mutex);
+	auto found = m_PipelineLayouts.find(layoutHandle);
+	if (found != m_PipelineLayouts.end())
+		return found->second;
+
+	wgpu::PipelineLayoutDescriptor layoutDesc{};
+	layoutDesc.bindGroupLayoutCount = 1;
+	layoutDesc.bindGroupLayouts = &layoutHandle;
+	wgpu::PipelineLayout layout = m_Device.createPipelineLayout(layoutDesc);
+	m_PipelineLayouts.emplace(layoutHandle, layout);
+	return layout;
+}
+
+wgpu::RenderPipeline PipelineCache::GetRenderPipeline(const RenderPipelineState& state)
+{
+	wgpu::ShaderModule shaderModule = nullptr;
+	{
+		std::lock_guard<std::mutex> lock(m_Mutex);
+		auto found = m_RenderPipelines.find(state);
+		if (found != m_RenderPipelines.end())
+		{
+			++m_Stats.pipelineHits;
+			return m_Resources->Get(found->second);
+		}
+
+		auto shader = m_ShaderModules.find(state.shaderHash);
+		if (shader == m_ShaderModules.end())
+		{
+			LOG_ERROR("Render pipeline uses a shader module that is not in the cache");
+			return nullptr;
+		}
+		shaderModule = m_Resources->Get(shader->second.module);
+	}
+
+	wgpu::PipelineLayout layout = GetPipelineLayout(state.bindGroupLayout);
+
+	// Created without holding the lock so other threads can create pipelines at the same time
+	PROFILE_SCOPE("Create render pipeline");
+	auto startTime = std::chrono::steady_clock::now();
+	wgpu::RenderPipeline pipeline = CreateRenderPipeline(state, shaderModule, layout);
+	const double createTime = SecondsSince(startTime);
+
+	std::lock_guard<std::mutex> lock(m_Mutex);
+	++m_Stats.pipelineMisses;
+	m_Stats.pipelineCreateTime += createTime;
+	auto found = m_RenderPipelines.find(state);
+	if (found != m_RenderPipelines.end())
+	{
+		// Another thread created the same pipeline first
+		pipeline.release();
+		return m_Resources->Get(found->second);
+	}
+	m_RenderPipelines.emplace(state, m_Resources->Add(pipeline));
+	return pipeline;
+}
+
+void PipelineCache::Prewarm(const std::vector<RenderPipelineState>& states)
+{
+	if (states.empty())
+		return;
+
+	PROFILE_FUNCTION();
+	[[maybe_unused]] auto startTime = std::chrono::steady_clock::now();
+
+	JobSystem::ParallelFor(static_cast<uint32_t>(states.size()), [this, &states](uint32_t begin, uint32_t end) {
+		for (uint32_t i = begin; i < end; ++i)
+			GetRenderPipeline(states[i]);
+	});
+
+	LOG_DEBUG("Prewarmed {0} render pipelines on {1} threads in {2:.2f} ms", states.size(), JobSystem::GetThreadCount(), SecondsSince(startTime) * 1000.0);
+}
+
+PipelineCacheStats PipelineCache::GetStats() const
+{
+	std::lock_guard<std::mutex> lock(m_Mutex);
+	return m_Stats;
+}
+
+void PipelineCache::LogStats() const
+{
+	[[maybe_unused]] PipelineCacheStats stats = GetStats();
+	LOG_DEBUG("Pipeline cache: {0} hits, {1} misses, {2:.2f} ms creating pipelines; shaders: {3} hits, {4} misses, {5:.2f} ms compiling",
+		stats.pipelineHits, stats.pipelineMisses, stats.pipelineCreateTime * 1000.0,
+		stats.shaderHits, stats.shaderMisses, stats.shaderCreateTime * 1000.0);
+}
+
+wgpu::RenderPipeline PipelineCache::CreateRenderPipeline(const RenderPipelineState& state, wgpu::ShaderModule shaderModule, wgpu::PipelineLayout layout)
+{
+	wgpu::RenderPipelineDescriptor pipelineDesc;
+
+	// The shader reads every attribute as f32 vectors so any stored format in the layout is accepted
+	const MeshLayout& meshLayout = state.vertexLayout;
+
+	wgpu::VertexBufferLayout vertexBufferLayout;
+	std::vector<wgpu::VertexAttribute> vertexAttribs(meshLayout.attributeCount);
+	for (uint32_t i = 0; i < meshLayout.attributeCount; ++i)
+	{
+		vertexAttribs[i].shaderLocation = meshLayout.attributes[i].shaderLocation;
+		vertexAttribs[i].format = ToWGPUFormat(meshLayout.attributes[i].format);
+		vertexAttribs[i].offset = meshLayout.attributes[i].offset;
+	}
+
+	vertexBufferLayout.attributeCount = static_cast<uint32_t>(vertexAttribs.size());
+	vertexBufferLayout.attributes = vertexAttribs.data();
+	vertexBufferLayout.arrayStride = meshLayout.stride;
+	vertexBufferLayout.stepMode = wgpu::VertexStepMode::Vertex;
+
+	pipelineDesc.vertex.bufferCount = 1;
+	pipelineDesc.vertex.buffers = &vertexBufferLayout;
+	pipelineDesc.vertex.module = shaderModule;
+	pipelineDesc.vertex.entryPoint = state.vertexEntryPoint.c_str();
+	pipelineDesc.vertex.constantCount = 0;
+	pipelineDesc.vertex.constants = nullptr;
+
+	pipelineDesc.primitive.topology = state.topology;
+	pipelineDesc.primitive.stripIndexFormat = wgpu::IndexFormat::Undefined;
+	pipelineDesc.primitive.frontFace = wgpu::FrontFace::CCW;
+	pipelineDesc.primitive.cullMode = state.cullMode;
+
+	wgpu::FragmentState fragmentState;
+	fragmentState.module = shaderModule;
+	fragmentState.entryPoint = state.fragmentEntryPoint.c_str();
+	fragmentState.constantCount = 0;
+	fragmentState.constants = nullptr;
+
+	pipelineDesc.fragment = &fragmentState;
+
+	pipelineDesc.depthStencil = nullptr;
+
+	wgpu::BlendState blendState;
+	blendState.color.srcFactor = state.srcFactor;
+	blendState.color.dstFactor = state.dstFactor;
+	blendState.color.operation = state.blendOperation;
+
+	wgpu::ColorTargetState colorTarget;
+	colorTarget.format = state.colourFormat;
+	colorTarget.blend = state.blend ? &blendState : nullptr;
+	colorTarget.writeMask = wgpu::ColorWriteMask::All;
+
+	fragmentState.targetCount = 1;
+	fragmentState.targets = &colorTarget;
+
+	pipelineDesc.multisample.count = state.sampleCount;
+	pipelineDesc.multisample.mask = ~0u;
+	pipelineDesc.multisample.alphaToCoverageEnabled = false;
+
+	pipelineDesc.layout = layout;
+
+	return m_Device.createRenderPipeline(pipelineDesc);
+}
+}
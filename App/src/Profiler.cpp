@@ -0,0 +1,261 @@
+#include "Profiler.hpp"
+#include "Logger.hpp"
+
+#include <atomic>
+#include <fstream>
+#include <memory>
+#include <mutex>
+#include <vector>
+
+namespace atcp {
+namespace {
+enum class EventType : uint8_t {
+	Scope,
+	Counter,
+};
+
+struct Event {
+	const char* name;
+	uint64_t start;
+	union {
+		// Ticks for scopes
+		uint64_t duration;
+		double value;
+	};
+	EventType type;
+};
+
+struct EventChunk {
+	static constexpr uint32_t Capacity = 16 * 1024;
+
+	Event events[Capacity];
+	// Written by the owning thread only, events below count are complete
+	std::atomic<uint32_t> count{ 0 };
+	std::atomic<EventChunk*> next{ nullptr };
+};
+
+/**
+ * Events of one thread. The thread appends to the tail chunk, the flushing thread reads from the head chunk and
+ * frees it once the owner has moved on to the next one.
+ */
+struct ThreadEvents {
+	uint32_t threadId = 0;
+	std::atomic<const char*> name{ nullptr };
+
+	EventChunk* tail = nullptr;
+
+	EventChunk* head = nullptr;
+	uint32_t consumed = 0;
+	bool nameWritten = false;
+
+	ThreadEvents()
+	{
+		tail = head = new EventChunk();
+	}
+	~ThreadEvents()
+	{
+		while (head)
+		{
+			EventChunk* next = head->next.load(std::memory_order_acquire);
+			delete head;
+			head = next;
+		}
+	}
+
+	void Push(const Event& event)
+	{
+		uint32_t index = tail->count.load(std::memory_order_relaxed);
+		if (index == EventChunk::Capacity)
+		{
+			EventChunk* chunk = new EventChunk();
+			tail->next.store(chunk, std::memory_order_release);
+			tail = chunk;
+			index = 0;
+		}
+		tail->events[index] = event;
+		tail->count.store(index + 1, std::memory_order_release);
+	}
+};
+
+std::atomic<bool> s_Active{ false };
+// Guards the file and the registry, never taken while recording an event
+std::mutex s_Mutex;
+std::ofstream s_File;
+uint64_t s_SessionStart = 0;
+double s_TicksPerMicrosecond = 1000.0;
+bool s_FirstEvent = true;
+// Buffers live until exit since a thread may still be recording into one after its session ended
+std::vector<std::unique_ptr<ThreadEvents>> s_Threads;
+
+ThreadEvents& GetThreadEvents()
+{
+	thread_local ThreadEvents* events = [] {
+		std::lock_guard<std::mutex> lock(s_Mutex);
+		s_Threads.push_back(std::make_unique<ThreadEvents>());
+		s_Threads.back()->threadId = static_cast<uint32_t>(s_Threads.size());
+		return s_Threads.back().get();
+	}();
+	return *events;
+}
+
+void WriteString(std::ostream& out, const char* text)
+{
+	out << '"';
+	for (const char* c = text; *c; ++c)
+	{
+		if (*c == '"' || *c == '\\')
+			out << '\\';
+		out << *c;
+	}
+	out << '"';
+}
+
+void BeginEvent()
+{
+	if (!s_FirstEvent)
+		s_File << ",\n";
+	s_FirstEvent = false;
+}
+
+void WriteEvent(const Event& event, uint32_t threadId)
+{
+	BeginEvent();
+	// Chrome traces are in microseconds
+	const double timestamp = (event.start - s_SessionStart) / s_TicksPerMicrosecond;
+	s_File << "{\"name\":";
+	WriteString(s_File, event.name);
+	if (event.type == EventType::Scope)
+	{
+		s_File << ",\"ph\":\"X\",\"ts\":" << timestamp << ",\"dur\":" << event.duration / s_TicksPerMicrosecond;
+	}
+	else
+	{
+		s_File << ",\"ph\":\"C\",\"ts\":" << timestamp << ",\"args\":{\"value\":" << event.value << "}";
+	}
+	s_File << ",\"pid\":1,\"tid\":" << threadId << "}";
+}
+
+void FlushThread(ThreadEvents& thread)
+{
+	const char* name = thread.name.load(std::memory_order_acquire);
+	if (name && !thread.nameWritten)
+	{
+		BeginEvent();
+		s_File << "{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":1,\"tid\":" << thread.threadId << ",\"args\":{\"name\":";
+		WriteString(s_File, name);
+		s_File << "}}";
+		thread.nameWritten = true;
+	}
+
+	while (true)
+	{
+		EventChunk* chunk = thread.head;
+		const uint32_t count = chunk->count.load(std::memory_order_acquire);
+		for (; thread.consumed < count; ++thread.consumed)
+		{
+			const Event& event = chunk->events[thread.consumed];
+			// Events from before the session began are dropped
+			if (event.start >= s_SessionStart)
+				WriteEvent(event, thread.threadId);
+		}
+
+		EventChunk* next = chunk->next.load(std::memory_order_acquire);
+		if (!next || count < EventChunk::Capacity)
+			break;
+
+		// The owning thread has moved on, nothing will write to this chunk again
+		delete chunk;
+		thread.head = next;
+		thread.consumed = 0;
+	}
+}
+}
+
+bool Profiler::BeginSession(const std::filesystem::path& path)
+{
+	EndSession();
+
+	std::lock_guard<std::mutex> lock(s_Mutex);
+	s_File.open(path);
+	if (!s_File.is_open())
+	{
+		LOG_ERROR("Could not open profiler trace {0}", path.string());
+		return false;
+	}
+	s_File << "{\"displayTimeUnit\":\"ms\",\"traceEvents\":[\n";
+	s_FirstEvent = true;
+
+	// Measure the tick rate against the system clock
+	const auto calibrationStart = std::chrono::steady_clock::now();
+	const uint64_t calibrationTicks = Now();
+	std::chrono::duration<double, std::micro> elapsed(0.0);
+	while (elapsed.count() < 10000.0)
+		elapsed = std::chrono::steady_clock::now() - calibrationStart;
+	s_TicksPerMicrosecond = (Now() - calibrationTicks) / elapsed.count();
+	s_SessionStart = Now();
+
+	for (std::unique_ptr<ThreadEvents>& thread : s_Threads)
+	{
+		thread->nameWritten = false;
+	}
+
+	s_Active.store(true, std::memory_order_release);
+	return true;
+}
+
+void Profiler::Flush()
+{
+	if (!IsActive())
+		return;
+
+	std::lock_guard<std::mutex> lock(s_Mutex);
+	for (std::unique_ptr<ThreadEvents>& thread : s_Threads)
+		FlushThread(*thread);
+	s_File.flush();
+}
+
+void Profiler::EndSession()
+{
+	if (!s_Active.exchange(false, std::memory_order_acq_rel))
+		return;
+
+	std::lock_guard<std::mutex> lock(s_Mutex);
+	for (std::unique_ptr<ThreadEvents>& thread : s_Threads)
+		FlushThread(*thread);
+	s_File << "\n]}\n";
+	s_File.close();
+}
+
+bool Profiler::IsActive()
+{
+	return s_Active.load(std::memory_order_relaxed);
+}
+
+void Profiler::SetThreadName(const char* name)
+{
+	GetThreadEvents().name.store(name, std::memory_order_release);
+}
+
+void Profiler::RecordScope(const char* name, uint64_t start, uint64_t end)
+{
+	Event event;
+	event.name = name;
+	event.start = start;
+	event.duration = end - start;
+	event.type = EventType::Scope;
+	GetThreadEvents().Push(event);
+}
+
+void Profiler::RecordCounter(const char* name, double value)
+{
+	if (!IsActive())
+		return;
+
+	Event event;
+	event.name = name;
+	event.start = Now();
+	event.value = value;
+	event.type = EventType::Counter;
+	GetThreadEvents().Push(event);
+}
+}
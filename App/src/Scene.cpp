@@ -0,0 +1,114 @@
+#include "Scene.hpp"
+
+#include <cstring>
+
+namespace atcp {
+void Scene::Destroy(const Entity* entities, size_t count)
+{
+	for (size_t i = 0; i < count; ++i)
+	{
+		Location location;
+		if (!m_Entities.Remove(entities[i], location))
+			continue;
+
+		// Fill the hole with the archetype's last entity so only the last chunk is ever partly full
+		Archetype& archetype = m_Archetypes[location.archetype];
+		const uint32_t lastChunkIndex = static_cast<uint32_t>(archetype.chunks.size() - 1);
+		Chunk& lastChunk = *archetype.chunks[lastChunkIndex];
+		const uint32_t lastRow = lastChunk.count - 1;
+		if (location.chunk != lastChunkIndex || location.row != lastRow)
+		{
+			Chunk& chunk = *archetype.chunks[location.chunk];
+			unsigned char* data = reinterpret_cast<unsigned char*>(chunk.data.get());
+			const unsigned char* lastData = reinterpret_cast<const unsigned char*>(lastChunk.data.get());
+			for (uint32_t type = 0; type < ComponentCount; ++type)
+			{
+				if (!(archetype.mask & (1u << type)))
+					continue;
+				const uint32_t size = ComponentSizes[type];
+				std::memcpy(data + archetype.offsets[type] + location.row * size, lastData + archetype.offsets[type] + lastRow * size, size);
+			}
+
+			const Entity moved = lastChunk.entities[lastRow];
+			chunk.entities[location.row] = moved;
+			*m_Entities.Get(moved) = location;
+		}
+
+		--archetype.entityCount;
+		if (--lastChunk.count == 0)
+			archetype.chunks.pop_back();
+	}
+	++m_Version;
+}
+
+void Scene::Clear()
+{
+	for (Archetype& archetype : m_Archetypes)
+	{
+		archetype.chunks.clear();
+		archetype.entityCount = 0;
+	}
+	m_Entities.Clear();
+	++m_Version;
+}
+
+uint32_t Scene::GetChunkCount() const
+{
+	uint32_t count = 0;
+	for (const Archetype& archetype : m_Archetypes)
+		count += static_cast<uint32_t>(archetype.chunks.size());
+	return count;
+}
+
+uint32_t Scene::GetArchetype(ComponentMask mask)
+{
+	for (uint32_t i = 0; i < m_Archetypes.size(); ++i)
+	{
+		if (m_Archetypes[i].mask == mask)
+			return i;
+	}
+
+	Archetype archetype;
+	archetype.mask = mask;
+	uint32_t offset = 0;
+	for (uint32_t type = 0; type < ComponentCount; ++type)
+	{
+		if (!(mask & (1u << type)))
+			continue;
+		archetype.offsets[type] = offset;
+		const uint32_t size = ChunkCapacity * ComponentSizes[type];
+		offset += (size + sizeof(CacheLine) - 1) / sizeof(CacheLine) * sizeof(CacheLine);
+	}
+	archetype.chunkLines = offset / sizeof(CacheLine);
+	m_Archetypes.push_back(std::move(archetype));
+	return static_cast<uint32_t>(m_Archetypes.size() - 1);
+}
+
+uint32_t Scene::GetChunkWithSpace(Archetype& archetype)
+{
+	if (archetype.chunks.empty() || archetype.chunks.back()->count == ChunkCapacity)
+	{
+		auto chunk = std::make_unique<Chunk>();
+		chunk->data = std::make_unique<CacheLine[]>(archetype.chunkLines);
+		archetype.chunks.push_back(std::move(chunk));
+	}
+	return static_cast<uint32_t>(archetype.chunks.size() - 1);
+}
+
+std::vector<Scene::ChunkRef> Scene::GetChunks(ComponentMask mask)
+{
+	std::vector<ChunkRef> chunks;
+	uint32_t first = 0;
+	for (Archetype& archetype : m_Archetypes)
+	{
+		if ((archetype.mask & mask) != mask)
+			continue;
+		for (const std::unique_ptr<Chunk>& chunk : archetype.chunks)
+		{
+			chunks.push_back({ &archetype, chunk.get(), first });
+			first += chunk->count;
+		}
+	}
+	return chunks;
+}
+}
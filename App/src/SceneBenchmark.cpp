@@ -0,0 +1,183 @@
+#include "SceneBenchmark.hpp"
+#include "JobSystem.hpp"
+#include "Logger.hpp"
+#include "Scene.hpp"
+#include "Uniforms.hpp"
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <vector>
+
+namespace atcp {
+namespace {
+using Clock = std::chrono::steady_clock;
+
+constexpr uint32_t EntityCount = 1 << 20;
+constexpr uint32_t Frames = 60;
+constexpr float TimeStep = 1.0f / 60.0f;
+
+// The layout the scene replaces, every component of an entity side by side
+struct SceneObject {
+	Transform transform;
+	Colour colour;
+	MeshRef mesh;
+	Animation animation;
+};
+
+double SecondsSince(Clock::time_point start)
+{
+	return std::chrono::duration<double>(Clock::now() - start).count();
+}
+
+SceneObject MakeObject(uint32_t i)
+{
+	SceneObject object;
+	object.transform = { { (i % 1024) / 512.0f - 1.0f, (i / 1024 % 1024) / 512.0f - 1.0f }, 1.0f / 1024.0f };
+	object.colour = { { (i % 7) / 6.0f, (i % 5) / 4.0f, (i % 3) / 2.0f, 1.0f } };
+	object.mesh = { MeshHandle{ 0 } };
+	object.animation = { (i & 1) ? -1.0f : 1.0f, i * 0.1f };
+	return object;
+}
+
+void InitChunk(uint32_t first, uint32_t count, Transform* transforms, Colour* colours, MeshRef* meshes, Animation* animations)
+{
+	for (uint32_t i = 0; i < count; ++i)
+	{
+		const SceneObject object = MakeObject(first + i);
+		transforms[i] = object.transform;
+		colours[i] = object.colour;
+		meshes[i] = object.mesh;
+		animations[i] = object.animation;
+	}
+}
+
+// Little arithmetic per entity so the timings measure memory traffic
+void Update(Transform& transform, Animation& animation)
+{
+	animation.phase += animation.speed * TimeStep;
+	transform.position[0] += animation.speed * 1e-4f;
+	transform.position[1] -= animation.speed * 1e-4f;
+}
+
+// The compiler may contract the arithmetic differently in each loop
+bool NearlyEqual(float a, float b)
+{
+	return std::fabs(a - b) <= 1e-5f * std::max(1.0f, std::fabs(a));
+}
+
+void UpdateChunk(uint32_t, uint32_t count, Transform* transforms, Animation* animations)
+{
+	for (uint32_t i = 0; i < count; ++i)
+		Update(transforms[i], animations[i]);
+}
+
+template<typename Function>
+double TimePerFrame(Function&& function)
+{
+	auto startTime = Clock::now();
+	for (uint32_t frame = 0; frame < Frames; ++frame)
+		function();
+	return SecondsSince(startTime) / Frames;
+}
+
+void LogTime(const char* name, double seconds, uint32_t count)
+{
+	LOG_INFO("{0}: {1:.2f} ms, {2:.2f} ns per entity", name, seconds * 1000.0, seconds * 1e9 / count);
+}
+}
+
+int SceneBenchmark::Run()
+{
+	Scene scene;
+	std::vector<Entity> entities;
+	auto startTime = Clock::now();
+	scene.Create<Transform, Colour, MeshRef, Animation>(EntityCount, InitChunk, &entities);
+	LogTime("Create", SecondsSince(startTime), EntityCount);
+	LOG_INFO("{0} entities in {1} chunks of {2}, {3} threads", scene.GetEntityCount(), scene.GetChunkCount(),
+		Scene::ChunkCapacity, JobSystem::GetThreadCount());
+
+	std::vector<SceneObject> objects(EntityCount);
+	for (uint32_t i = 0; i < EntityCount; ++i)
+		objects[i] = MakeObject(i);
+
+	double sum = 0.0;
+	const double iterateTime = TimePerFrame([&scene, &sum] {
+		scene.Each<Transform>([&sum](uint32_t, uint32_t count, const Transform* transforms) {
+			for (uint32_t i = 0; i < count; ++i)
+				sum += transforms[i].position[0] + transforms[i].position[1];
+		});
+	});
+	LogTime("Iterate transforms per frame", iterateTime, EntityCount);
+
+	const double updateTime = TimePerFrame([&scene] { scene.Each<Transform, Animation>(UpdateChunk); });
+	LogTime("Update per frame, one thread", updateTime, EntityCount);
+	const double parallelUpdateTime = TimePerFrame([&scene] { scene.ParallelEach<Transform, Animation>(UpdateChunk); });
+	LogTime("Update per frame, chunks in parallel", parallelUpdateTime, EntityCount);
+
+	const double arrayOfStructsTime = TimePerFrame([&objects] {
+		for (SceneObject& object : objects)
+			Update(object.transform, object.animation);
+	});
+	LogTime("Update per frame, array of structs", arrayOfStructsTime, EntityCount);
+	LOG_INFO("Scene update is {0:.2f}x the array of structs on one thread, {1:.2f}x in parallel",
+		arrayOfStructsTime / updateTime, arrayOfStructsTime / parallelUpdateTime);
+
+	std::vector<InstanceData> instances(EntityCount);
+	const double instanceTime = TimePerFrame([&scene, &instances] {
+		scene.ParallelEach<Transform, Colour, Animation>([&instances](uint32_t first, uint32_t count,
+			const Transform* transforms, const Colour* colours, const Animation* animations) {
+			for (uint32_t i = 0; i < count; ++i)
+				instances[first + i] = { transforms[i].position, transforms[i].scale, animations[i].speed, colours[i].value, animations[i].phase, {} };
+		});
+	});
+	LogTime("Build instance list per frame", instanceTime, EntityCount);
+
+	// The scene has had two frames of updates for every one of the array's
+	for (uint32_t frame = 0; frame < Frames; ++frame)
+	{
+		for (SceneObject& object : objects)
+			Update(object.transform, object.animation);
+	}
+	uint32_t mismatches = 0;
+	scene.Each<Transform, Animation>([&objects, &mismatches](uint32_t first, uint32_t count, const Transform* transforms,
+		const Animation* animations) {
+		for (uint32_t i = 0; i < count; ++i)
+		{
+			const SceneObject& object = objects[first + i];
+			if (!NearlyEqual(transforms[i].position[0], object.transform.position[0])
+				|| !NearlyEqual(transforms[i].position[1], object.transform.position[1])
+				|| !NearlyEqual(animations[i].phase, object.animation.phase))
+				++mismatches;
+		}
+	});
+
+	// Destroy every other entity then create as many again, filling the holes left in the chunks
+	std::vector<Entity> destroyed;
+	for (uint32_t i = 0; i < EntityCount; i += 2)
+		destroyed.push_back(entities[i]);
+	startTime = Clock::now();
+	scene.Destroy(destroyed.data(), destroyed.size());
+	LogTime("Destroy half", SecondsSince(startTime), static_cast<uint32_t>(destroyed.size()));
+	startTime = Clock::now();
+	scene.Create<Transform, Colour, MeshRef, Animation>(static_cast<uint32_t>(destroyed.size()), InitChunk);
+	LogTime("Create half again", SecondsSince(startTime), static_cast<uint32_t>(destroyed.size()));
+
+	uint32_t stillAlive = 0;
+	for (Entity entity : destroyed)
+	{
+		if (scene.IsAlive(entity))
+			++stillAlive;
+	}
+	const uint32_t expectedChunks = (EntityCount + Scene::ChunkCapacity - 1) / Scene::ChunkCapacity;
+	if (mismatches != 0 || stillAlive != 0 || scene.Count<Transform, Animation>() != EntityCount
+		|| scene.GetChunkCount() != expectedChunks)
+	{
+		LOG_ERROR("Scene check failed: {0} entities differ from the array of structs, {1} destroyed entities are alive, "
+			"{2} entities in {3} chunks", mismatches, stillAlive, scene.GetEntityCount(), scene.GetChunkCount());
+		return 1;
+	}
+	LOG_INFO("Scene check passed, transform checksum {0:.3f}", sum);
+	return 0;
+}
+}
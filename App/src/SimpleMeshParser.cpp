@@ -1,60 +1,332 @@
 #include "SimpleMeshParser.hpp"
+#include "JobSystem.hpp"
+#include "Logger.hpp"
+
+#include <algorithm>
+#include <charconv>
+#include <chrono>
+#include <cstdlib>
+#include <cstring>
+#include <fstream>
+#include <string_view>
+
 namespace atcp
 {
-bool SimpleMeshParser::LoadGeometry(const std::filesystem::path &path, std::vector<float> &vertexData, std::vector<uint16_t> &indexData)
+namespace
 {
-	std::ifstream file(path);
-	if (!file.is_open())
-	{
+enum class Section {
+	None,
+	Vertices,
+	Indices
+};
+
+enum class LineType {
+	Skip,
+	Header,
+	Data
+};
+
+inline bool IsSpace(char c)
+{
+	return c == ' ' || c == '\t' || c == '\r' || c == '\f' || c == '\v';
+}
+
+/**
+ * Return the next line in [cursor, end) trimmed of surrounding whitespace and advance the cursor past its terminator.
+ */
+std::string_view NextLine(const char*& cursor, const char* end)
+{
+	const char* lineEnd = static_cast<const char*>(std::memchr(cursor, '\n', end - cursor));
+	if (!lineEnd)
+		lineEnd = end;
+
+	std::string_view line(cursor, lineEnd - cursor);
+	cursor = (lineEnd == end) ? end : lineEnd + 1;
+
+	while (!line.empty() && IsSpace(line.front()))
+		line.remove_prefix(1);
+	while (!line.empty() && IsSpace(line.back()))
+		line.remove_suffix(1);
+	return line;
+}
+
+LineType ClassifyLine(std::string_view line, Section& section)
+{
+	if (line.empty() || line.front() == '#')
+		return LineType::Skip;
+	if (line == "[vertices]") {
+		section = Section::Vertices;
+		return LineType::Header;
+	}
+	if (line == "[indices]") {
+		section = Section::Indices;
+		return LineType::Header;
+	}
+	return LineType::Data;
+}
+
+inline void SkipSpace(const char*& first, const char* last)
+{
+	while (first != last && IsSpace(*first))
+		++first;
+}
+
+bool ParseValue(const char*& first, const char* last, float& value)
+{
+	SkipSpace(first, last);
+	if (first != last && *first == '+')
+		++first;
+	if (first == last)
+		return false;
+#if defined(__cpp_lib_to_chars)
+	auto [ptr, ec] = std::from_chars(first, last, value);
+	if (ec != std::errc())
+		return false;
+	first = ptr;
+	return true;
+#else
+	// Floating point from_chars is not available on every standard library, strtof needs a terminated token
+	char token[64];
+	size_t length = 0;
+	while (first + length != last && !IsSpace(first[length]) && length < sizeof(token) - 1) {
+		token[length] = first[length];
+		++length;
+	}
+	token[length] = '\0';
+	char* tokenEnd = nullptr;
+	value = std::strtof(token, &tokenEnd);
+	if (tokenEnd == token)
+		return false;
+	first += tokenEnd - token;
+	return true;
+#endif
+}
+
+bool ParseValue(const char*& first, const char* last, uint32_t& value)
+{
+	SkipSpace(first, last);
+	auto [ptr, ec] = std::from_chars(first, last, value);
+	if (ec != std::errc())
 		return false;
+	first = ptr;
+	return true;
+}
+
+template<typename T>
+bool ParseRecord(std::string_view line, T* out, size_t count)
+{
+	const char* first = line.data();
+	const char* last = line.data() + line.size();
+	for (size_t i = 0; i < count; ++i) {
+		if (!ParseValue(first, last, out[i]))
+			return false;
 	}
+	SkipSpace(first, last);
+	return first == last || *first == '#';
+}
 
-	vertexData.clear();
-	indexData.clear();
+struct Chunk {
+	const char* begin = nullptr;
+	const char* end = nullptr;
 
-	enum class Section {
-		None,
-		Vertices,
-		Indices
-	};
-	Section currentSection = Section::None;
-
-	float value;
-	uint16_t index;
-	std::string line;
-	while (!file.eof())
-	{
-		getline(file, line);
-		if(!line.empty() && line.back() == 'r') {
-			line.pop_back();
-		}
+	// Filled by the counting pass, records before the first header belong to the previous chunk's section
+	size_t lineCount = 0;
+	size_t entryRecords = 0;
+	size_t vertexRecords = 0;
+	size_t triangleRecords = 0;
+	Section exitSection = Section::None;
 
-		if(line == "[vertices]") {
-			currentSection = Section::Vertices;
-		}
-		else if(line == "[indices]") {
-			currentSection = Section::Indices;
-		}
-		else if (line.empty() || line[0] == '#')
-		{
+	// Resolved between the passes
+	Section entrySection = Section::None;
+	size_t firstLine = 0;
+	size_t firstVertex = 0;
+	size_t firstTriangle = 0;
+
+	std::string error;
+};
+
+void CountChunk(Chunk& chunk)
+{
+	bool seenHeader = false;
+	Section section = Section::None;
+	for (const char* cursor = chunk.begin; cursor != chunk.end;) {
+		std::string_view line = NextLine(cursor, chunk.end);
+		++chunk.lineCount;
+		LineType type = ClassifyLine(line, section);
+		if (type == LineType::Header)
+			seenHeader = true;
+		if (type != LineType::Data)
 			continue;
-		}
-		else if(currentSection == Section::Vertices) {
-			std::istringstream iss(line);
-			for(int i = 0; i < 5; ++i) {
-				iss >> value;
-				vertexData.push_back(value);
+		if (!seenHeader)
+			++chunk.entryRecords;
+		else if (section == Section::Vertices)
+			++chunk.vertexRecords;
+		else if (section == Section::Indices)
+			++chunk.triangleRecords;
+	}
+	chunk.exitSection = section;
+}
+
+void ParseChunk(Chunk& chunk, float* vertexData, uint32_t* indexData, size_t vertexCount)
+{
+	float* vertexOut = vertexData + chunk.firstVertex * SimpleMeshParser::VertexComponents;
+	uint32_t* indexOut = indexData + chunk.firstTriangle * SimpleMeshParser::IndexComponents;
+	size_t lineNumber = chunk.firstLine;
+	Section section = chunk.entrySection;
+	for (const char* cursor = chunk.begin; cursor != chunk.end;) {
+		std::string_view line = NextLine(cursor, chunk.end);
+		++lineNumber;
+		if (ClassifyLine(line, section) != LineType::Data)
+			continue;
+
+		if (section == Section::Vertices) {
+			if (!ParseRecord(line, vertexOut, SimpleMeshParser::VertexComponents)) {
+				chunk.error = fmt::format("{0}: expected {1} floats per vertex, got '{2}'", lineNumber, SimpleMeshParser::VertexComponents, line);
+				return;
 			}
+			vertexOut += SimpleMeshParser::VertexComponents;
 		}
-		else if (currentSection == Section::Indices) {
-			std::istringstream iss(line);
-			for(int i = 0; i < 3; ++i) {
-				iss >> index;
-				indexData.push_back(index);
+		else if (section == Section::Indices) {
+			if (!ParseRecord(line, indexOut, SimpleMeshParser::IndexComponents)) {
+				chunk.error = fmt::format("{0}: expected {1} indices per triangle, got '{2}'", lineNumber, SimpleMeshParser::IndexComponents, line);
+				return;
+			}
+			for (size_t i = 0; i < SimpleMeshParser::IndexComponents; ++i) {
+				if (indexOut[i] >= vertexCount) {
+					chunk.error = fmt::format("{0}: index {1} is out of range of {2} vertices", lineNumber, indexOut[i], vertexCount);
+					return;
+				}
 			}
+			indexOut += SimpleMeshParser::IndexComponents;
+		}
+		else {
+			chunk.error = fmt::format("{0}: data outside of a [vertices] or [indices] section", lineNumber);
+			return;
+		}
+	}
+}
+
+/**
+ * Run 'function' over every chunk as jobs, the first on the calling thread.
+ */
+template<typename Function>
+void RunChunks(std::vector<Chunk>& chunks, Function function)
+{
+	JobSystem::ParallelFor(static_cast<uint32_t>(chunks.size()), [&](uint32_t begin, uint32_t end) {
+		for (uint32_t i = begin; i < end; ++i)
+			function(chunks[i]);
+	});
+}
+} // namespace
+
+bool SimpleMeshParser::LoadGeometry(const std::filesystem::path &path, std::vector<float> &vertexData, std::vector<uint32_t> &indexData)
+{
+	auto startTime = std::chrono::steady_clock::now();
+
+	std::string contents;
+	if (!ReadFile(path, contents))
+	{
+		return false;
+	}
+
+	if (!ParseGeometry(contents.data(), contents.data() + contents.size(), vertexData, indexData, path.string()))
+	{
+		return false;
+	}
+
+	std::chrono::duration<double> elapsed = std::chrono::steady_clock::now() - startTime;
+	LOG_DEBUG("Loaded {0}: {1} vertices, {2} indices in {3:.2f} ms ({4:.1f} MB/s)", path.filename().string(),
+		vertexData.size() / VertexComponents, indexData.size(), elapsed.count() * 1000.0,
+		elapsed.count() > 0.0 ? contents.size() / (1024.0 * 1024.0) / elapsed.count() : 0.0);
+	return true;
+}
+
+bool SimpleMeshParser::ParseGeometry(const char* begin, const char* end, std::vector<float>& vertexData, std::vector<uint32_t>& indexData, const std::string& sourceName, unsigned threadCount)
+{
+	vertexData.clear();
+	indexData.clear();
+
+	const size_t size = static_cast<size_t>(end - begin);
+	if (threadCount == 0)
+		threadCount = JobSystem::GetThreadCount();
+	size_t chunkCount = std::min<size_t>(threadCount, std::max<size_t>(1, size / MinParallelChunkSize));
+
+	// Newline aligned chunks, each starts at the beginning of a line
+	std::vector<Chunk> chunks(chunkCount);
+	const char* chunkBegin = begin;
+	for (size_t i = 0; i < chunkCount; ++i) {
+		const char* chunkEnd = (i + 1 == chunkCount) ? end : begin + size * (i + 1) / chunkCount;
+		if (chunkEnd < chunkBegin)
+			chunkEnd = chunkBegin;
+		if (chunkEnd != end) {
+			const char* newline = static_cast<const char*>(std::memchr(chunkEnd, '\n', end - chunkEnd));
+			chunkEnd = newline ? newline + 1 : end;
+		}
+		chunks[i].begin = chunkBegin;
+		chunks[i].end = chunkEnd;
+		chunkBegin = chunkEnd;
+	}
+
+	RunChunks(chunks, CountChunk);
+
+	// Resolve the section each chunk starts in and where its records land in the outputs
+	size_t vertexCount = 0;
+	size_t triangleCount = 0;
+	size_t lineNumber = 0;
+	Section section = Section::None;
+	for (Chunk& chunk : chunks) {
+		chunk.entrySection = section;
+		chunk.firstLine = lineNumber;
+		chunk.firstVertex = vertexCount;
+		chunk.firstTriangle = triangleCount;
+		if (section == Section::Vertices)
+			vertexCount += chunk.entryRecords;
+		else if (section == Section::Indices)
+			triangleCount += chunk.entryRecords;
+		vertexCount += chunk.vertexRecords;
+		triangleCount += chunk.triangleRecords;
+		lineNumber += chunk.lineCount;
+		if (chunk.exitSection != Section::None)
+			section = chunk.exitSection;
+	}
+
+	vertexData.resize(vertexCount * VertexComponents);
+	indexData.resize(triangleCount * IndexComponents);
+
+	RunChunks(chunks, [&](Chunk& chunk) {
+		ParseChunk(chunk, vertexData.data(), indexData.data(), vertexCount);
+	});
+
+	// Chunks are in file order so the first failure is the earliest line
+	for (const Chunk& chunk : chunks) {
+		if (!chunk.error.empty()) {
+			LOG_ERROR("{0}:{1}", sourceName, chunk.error);
+			vertexData.clear();
+			indexData.clear();
+			return false;
 		}
 	}
-	
+
 	return true;
 }
+
+bool SimpleMeshParser::ReadFile(const std::filesystem::path& path, std::string& contents)
+{
+	std::ifstream file(path, std::ios::binary);
+	if (!file.is_open())
+	{
+		return false;
+	}
+
+	file.seekg(0, std::ios::end);
+	std::streamoff size = file.tellg();
+	if (size < 0)
+	{
+		return false;
+	}
+	contents.resize(static_cast<size_t>(size));
+	file.seekg(0);
+	file.read(contents.data(), size);
+	return static_cast<bool>(file);
+}
 } // namespace atcp
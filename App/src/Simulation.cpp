@@ -0,0 +1,130 @@
+#include "Simulation.hpp"
+#include "Profiler.hpp"
+
+#include <chrono>
+#include <cmath>
+
+namespace atcp {
+Simulation::~Simulation()
+{
+	Shutdown();
+}
+
+void Simulation::Init(double stepInterval, uint32_t maxStepsPerFrame, bool pipelined)
+{
+	Shutdown();
+
+	m_StepInterval = stepInterval;
+	m_MaxStepsPerFrame = maxStepsPerFrame;
+	m_Accumulator = 0.0;
+	m_Previous = SimulationState();
+	m_Current = SimulationState();
+	m_ClampedFrames = 0;
+	m_WaitTime = 0.0;
+
+	// The first frame is ready before the worker starts so the first Advance has something to return
+	m_Frames[0] = Step(0.0);
+	m_WriteIndex = 0;
+	m_Requested = false;
+	m_Stop = false;
+
+	if (pipelined)
+		m_Thread = std::thread(&Simulation::WorkerMain, this);
+}
+
+void Simulation::Shutdown()
+{
+	if (!m_Thread.joinable())
+		return;
+
+	{
+		std::lock_guard<std::mutex> lock(m_Mutex);
+		m_Stop = true;
+	}
+	m_Condition.notify_all();
+	m_Thread.join();
+}
+
+const FrameState& Simulation::Advance(double elapsed)
+{
+	if (!m_Thread.joinable())
+	{
+		m_Frames[0] = Step(elapsed);
+		return m_Frames[0];
+	}
+
+	std::unique_lock<std::mutex> lock(m_Mutex);
+	if (m_Requested)
+	{
+		PROFILE_SCOPE("WaitForSimulation");
+		auto waitStart = std::chrono::steady_clock::now();
+		m_Condition.wait(lock, [this] { return !m_Requested; });
+		m_WaitTime += std::chrono::duration<double>(std::chrono::steady_clock::now() - waitStart).count();
+	}
+
+	// Hand the finished slot to the caller and simulate the next frame into the other one
+	const uint32_t readIndex = m_WriteIndex;
+	m_WriteIndex = 1 - m_WriteIndex;
+	m_RequestedElapsed = elapsed;
+	m_Requested = true;
+	lock.unlock();
+	m_Condition.notify_all();
+
+	return m_Frames[readIndex];
+}
+
+FrameState Simulation::Step(double elapsed)
+{
+	PROFILE_FUNCTION();
+
+	m_Accumulator += elapsed;
+
+	FrameState frame;
+	while (m_Accumulator >= m_StepInterval)
+	{
+		if (frame.steps == m_MaxStepsPerFrame)
+		{
+			// Catching up would take longer than the time being caught up on
+			m_Accumulator = std::fmod(m_Accumulator, m_StepInterval);
+			++m_ClampedFrames;
+			break;
+		}
+		m_Previous = m_Current;
+		Update(m_Current, m_StepInterval);
+		m_Accumulator -= m_StepInterval;
+		++frame.steps;
+	}
+
+	const double alpha = m_Accumulator / m_StepInterval;
+	frame.time = static_cast<float>(m_Previous.time + (m_Current.time - m_Previous.time) * alpha);
+	return frame;
+}
+
+void Simulation::Update(SimulationState& state, double deltaTime)
+{
+	state.time += deltaTime;
+	++state.step;
+}
+
+void Simulation::WorkerMain()
+{
+	PROFILE_THREAD("Simulation");
+
+	std::unique_lock<std::mutex> lock(m_Mutex);
+	while (true)
+	{
+		m_Condition.wait(lock, [this] { return m_Requested || m_Stop; });
+		if (m_Stop)
+			break;
+
+		const double elapsed = m_RequestedElapsed;
+		const uint32_t writeIndex = m_WriteIndex;
+		lock.unlock();
+		m_Frames[writeIndex] = Step(elapsed);
+		lock.lock();
+
+		m_Requested = false;
+		m_Condition.notify_all();
+	}
+}
+}
@@ -0,0 +1,59 @@
+#include "TimingStats.hpp"
+#include "Logger.hpp"
+
+#include <algorithm>
+#include <cmath>
+
+namespace atcp {
+void TimingStats::Add(double seconds)
+{
+	m_Sorted = m_Samples.empty() || (m_Sorted && seconds >= m_Samples.back());
+	m_Samples.push_back(seconds);
+}
+
+void TimingStats::Clear()
+{
+	m_Samples.clear();
+	m_Sorted = true;
+}
+
+double TimingStats::GetAverage() const
+{
+	if (m_Samples.empty())
+		return 0.0;
+
+	double total = 0.0;
+	for (double sample : m_Samples)
+		total += sample;
+	return total / m_Samples.size();
+}
+
+double TimingStats::GetPercentile(double percentile)
+{
+	if (m_Samples.empty())
+		return 0.0;
+
+	if (!m_Sorted)
+	{
+		std::sort(m_Samples.begin(), m_Samples.end());
+		m_Sorted = true;
+	}
+
+	const double rank = std::ceil(std::clamp(percentile, 0.0, 100.0) / 100.0 * m_Samples.size());
+	const size_t index = static_cast<size_t>(std::max(rank, 1.0)) - 1;
+	return m_Samples[index];
+}
+
+void TimingStats::Log(const char* name)
+{
+	if (m_Samples.empty())
+	{
+		LOG_INFO("{0}: no samples", name);
+		return;
+	}
+
+	LOG_INFO("{0} over {1} samples: {2:.3f} ms average, {3:.3f} ms min, {4:.3f} ms p50, {5:.3f} ms p95, {6:.3f} ms p99, {7:.3f} ms max",
+		name, m_Samples.size(), GetAverage() * 1000.0, GetPercentile(0.0) * 1000.0, GetPercentile(50.0) * 1000.0,
+		GetPercentile(95.0) * 1000.0, GetPercentile(99.0) * 1000.0, GetPercentile(100.0) * 1000.0);
+}
+}
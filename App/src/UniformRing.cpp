@@ -0,0 +1,137 @@
+#include "UniformRing.hpp"
+#include "Logger.hpp"
+
+#include <cstring>
+
+namespace atcp {
+namespace {
+uint32_t AlignUp(uint32_t value, uint32_t alignment)
+{
+	return (value + alignment - 1) / alignment * alignment;
+}
+}
+
+UniformRing::~UniformRing()
+{
+	Release();
+}
+
+uint64_t UniformRing::GetBufferSize(uint32_t frameCount, uint32_t slotsPerFrame, uint32_t slotSize, uint32_t alignment)
+{
+	return uint64_t(frameCount) * slotsPerFrame * AlignUp(slotSize, alignment);
+}
+
+bool UniformRing::Init(wgpu::Device device, wgpu::Queue queue, uint32_t frameCount, uint32_t slotsPerFrame, uint32_t slotSize, uint32_t alignment)
+{
+	Release();
+
+	if (frameCount == 0 || slotsPerFrame == 0 || slotSize == 0 || alignment == 0)
+	{
+		LOG_ERROR("Invalid uniform ring of {0} frames with {1} slots of {2} bytes", frameCount, slotsPerFrame, slotSize);
+		return false;
+	}
+
+	m_Device = device;
+	m_Queue = queue;
+	m_FrameCount = frameCount;
+	m_SlotsPerFrame = slotsPerFrame;
+	m_SlotSize = slotSize;
+	m_Stride = AlignUp(slotSize, alignment);
+
+	wgpu::BufferDescriptor bufferDesc;
+	bufferDesc.label = "Uniform Ring";
+	bufferDesc.usage = wgpu::BufferUsage::CopyDst | wgpu::BufferUsage::Uniform;
+	bufferDesc.size = GetBufferSize(frameCount, slotsPerFrame, slotSize, alignment);
+	bufferDesc.mappedAtCreation = false;
+	m_Buffer = m_Device.createBuffer(bufferDesc);
+	if (!m_Buffer)
+	{
+		LOG_ERROR("Could not create a {0} byte uniform ring", bufferDesc.size);
+		return false;
+	}
+
+	m_Staging.assign(size_t(m_SlotsPerFrame) * m_Stride, 0);
+	m_InFlight.assign(m_FrameCount, 0);
+	m_WorkDoneCallbacks.resize(m_FrameCount);
+	m_Frame = 0;
+	m_SlotCount = 0;
+
+	LOG_DEBUG("Uniform ring of {0} frames with {1} slots of {2} bytes", m_FrameCount, m_SlotsPerFrame, m_Stride);
+	return true;
+}
+
+void UniformRing::Release()
+{
+	if (!m_Buffer)
+		return;
+
+	// Callbacks still pending would be called after their handles are destroyed
+	for (uint32_t frame = 0; frame < m_FrameCount; ++frame)
+		WaitForFrame(frame);
+
+	m_WorkDoneCallbacks.clear();
+	m_Buffer.destroy();
+	m_Buffer.release();
+	m_Buffer = nullptr;
+}
+
+void UniformRing::BeginFrame()
+{
+	m_Frame = (m_Frame + 1) % m_FrameCount;
+	m_SlotCount = 0;
+
+	if (m_InFlight[m_Frame])
+	{
+		++m_StallCount;
+		WaitForFrame(m_Frame);
+	}
+}
+
+uint32_t UniformRing::Allocate(const void* data, uint32_t size)
+{
+	if (m_SlotCount == m_SlotsPerFrame || size > m_SlotSize)
+	{
+		if (m_OverflowCount++ == 0)
+			LOG_WARN("Uniform ring cannot fit a {0} byte uniform, {1} of {2} slots used", size, m_SlotCount, m_SlotsPerFrame);
+		return UINT32_MAX;
+	}
+
+	const uint32_t offset = m_SlotCount * m_Stride;
+	std::memcpy(m_Staging.data() + offset, data, size);
+	++m_SlotCount;
+	return m_Frame * m_SlotsPerFrame * m_Stride + offset;
+}
+
+void UniformRing::Upload()
+{
+	m_BytesUploaded = uint64_t(m_SlotCount) * m_Stride;
+	if (m_BytesUploaded == 0)
+		return;
+
+	m_Queue.writeBuffer(m_Buffer, uint64_t(m_Frame) * m_SlotsPerFrame * m_Stride, m_Staging.data(), static_cast<size_t>(m_BytesUploaded));
+}
+
+void UniformRing::EndFrame()
+{
+	const uint32_t frame = m_Frame;
+	m_InFlight[frame] = 1;
+	m_WorkDoneCallbacks[frame] = m_Queue.onSubmittedWorkDone([this, frame](wgpu::QueueWorkDoneStatus) {
+		m_InFlight[frame] = 0;
+	});
+}
+
+void UniformRing::WaitForFrame(uint32_t frame)
+{
+	while (m_InFlight[frame])
+	{
+#if defined(WEBGPU_BACKEND_DAWN)
+		m_Device.tick();
+#elif defined(WEBGPU_BACKEND_WGPU)
+		m_Device.poll(true);
+#else
+		// The browser only reports completed work once control returns to it
+		break;
+#endif
+	}
+}
+}
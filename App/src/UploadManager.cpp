@@ -0,0 +1,275 @@
+#include "UploadManager.hpp"
+#include "Logger.hpp"
+#include "Profiler.hpp"
+
+#include <algorithm>
+#include <chrono>
+#include <cstring>
+
+namespace atcp {
+namespace {
+double SecondsSince(std::chrono::steady_clock::time_point start)
+{
+	return std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+}
+}
+
+UploadManager::~UploadManager()
+{
+	Release();
+}
+
+bool UploadManager::Init(wgpu::Device device, wgpu::Queue queue, uint64_t blockSize, uint32_t maxBlocks)
+{
+	Release();
+
+	if (blockSize < 4 || blockSize % 4 != 0 || maxBlocks == 0)
+	{
+		LOG_ERROR("Invalid upload staging of {0} buffers of {1} bytes", maxBlocks, blockSize);
+		return false;
+	}
+
+	m_Device = device;
+	m_Queue = queue;
+	m_BlockSize = blockSize;
+	m_MaxBlocks = maxBlocks;
+	m_CurrentBlock = 0;
+	m_Stats = UploadStats();
+	return true;
+}
+
+void UploadManager::Release()
+{
+	// Map callbacks still pending would be called after their blocks are destroyed
+	auto isMapping = [](const std::unique_ptr<StagingBlock>& block) { return block->mapping; };
+	while (std::any_of(m_Blocks.begin(), m_Blocks.end(), isMapping) && Poll())
+	{
+	}
+
+	for (std::unique_ptr<StagingBlock>& block : m_Blocks)
+	{
+		if (block->data)
+			block->buffer.unmap();
+		block->buffer.destroy();
+		block->buffer.release();
+	}
+	m_Blocks.clear();
+	m_Copies.clear();
+}
+
+bool UploadManager::Write(wgpu::Buffer destination, uint64_t offset, const void* data, uint64_t size)
+{
+	if (offset % 4 != 0)
+	{
+		LOG_ERROR("Upload offset {0} is not a multiple of 4", offset);
+		return false;
+	}
+
+	auto startTime = std::chrono::steady_clock::now();
+	const double stallTime = m_Stats.stallTime;
+
+	const unsigned char* bytes = static_cast<const unsigned char*>(data);
+	uint64_t written = 0;
+	while (written < size)
+	{
+		StagingBlock* block = GetBlock();
+		if (!block)
+			return false;
+
+		// Blocks fill in multiples of 4 bytes so only the last chunk of a write needs padding
+		const uint64_t count = std::min(size - written, m_BlockSize - block->used);
+		const uint64_t paddedCount = (count + 3) & ~uint64_t(3);
+		std::memcpy(block->data + block->used, bytes + written, static_cast<size_t>(count));
+		std::memset(block->data + block->used + count, 0, static_cast<size_t>(paddedCount - count));
+
+		m_Copies.push_back({ m_CurrentBlock, block->used, destination, offset + written, paddedCount });
+		block->used += paddedCount;
+		written += count;
+	}
+
+	m_Stats.bytesUploaded += size;
+	m_Stats.stagingTime += SecondsSince(startTime) - (m_Stats.stallTime - stallTime);
+	return true;
+}
+
+void UploadManager::Submit()
+{
+	if (m_Copies.empty())
+		return;
+
+	PROFILE_FUNCTION();
+	auto startTime = std::chrono::steady_clock::now();
+
+	// The GPU can only read staging buffers once they are unmapped
+	for (std::unique_ptr<StagingBlock>& block : m_Blocks)
+	{
+		if (block->data && block->used > 0)
+		{
+			block->buffer.unmap();
+			block->data = nullptr;
+		}
+	}
+
+	wgpu::CommandEncoderDescriptor encoderDesc = {};
+	encoderDesc.label = "Upload encoder";
+	wgpu::CommandEncoder encoder = m_Device.createCommandEncoder(encoderDesc);
+	for (const PendingCopy& copy : m_Copies)
+		encoder.copyBufferToBuffer(m_Blocks[copy.block]->buffer, copy.sourceOffset, copy.destination, copy.destinationOffset, copy.size);
+	wgpu::CommandBuffer command = encoder.finish(wgpu::Default);
+	encoder.release();
+	m_Queue.submit(command);
+	command.release();
+
+	// Mapping completes once the GPU has finished the copies above, the block can be filled again from then on
+	for (std::unique_ptr<StagingBlock>& blockPointer : m_Blocks)
+	{
+		StagingBlock* block = blockPointer.get();
+		if (block->data || block->mapping || block->used == 0)
+			continue;
+
+		block->mapping = true;
+		block->mapCallback = block->buffer.mapAsync(wgpu::MapMode::Write, 0, static_cast<size_t>(m_BlockSize), [this, block](wgpu::BufferMapAsyncStatus status) {
+			block->mapping = false;
+			if (status != wgpu::BufferMapAsyncStatus::Success)
+			{
+				LOG_ERROR("Could not map a staging buffer again");
+				return;
+			}
+			block->data = static_cast<unsigned char*>(block->buffer.getMappedRange(0, static_cast<size_t>(m_BlockSize)));
+			block->used = 0;
+		});
+	}
+
+	++m_Stats.submitCount;
+	m_Stats.copyCount += m_Copies.size();
+	m_Copies.clear();
+	m_Stats.stagingTime += SecondsSince(startTime);
+}
+
+wgpu::Buffer UploadManager::CreateBuffer(const char* label, WGPUBufferUsageFlags usage, const void* data, uint64_t size)
+{
+	wgpu::BufferDescriptor bufferDesc;
+	bufferDesc.label = label;
+	// Mapped ranges must be a multiple of 4 bytes
+	bufferDesc.size = (size + 3) & ~uint64_t(3);
+	bufferDesc.usage = usage;
+	bufferDesc.mappedAtCreation = true;
+	wgpu::Buffer buffer = m_Device.createBuffer(bufferDesc);
+
+	void* mapped = buffer.getMappedRange(0, static_cast<size_t>(bufferDesc.size));
+	if (mapped)
+	{
+		std::memcpy(mapped, data, static_cast<size_t>(size));
+	}
+	buffer.unmap();
+
+	++m_Stats.staticBufferCount;
+	m_Stats.staticBytes += size;
+	return buffer;
+}
+
+uint64_t UploadManager::GetStagingInUse() const
+{
+	uint64_t inUse = 0;
+	for (const std::unique_ptr<StagingBlock>& block : m_Blocks)
+		inUse += block->used;
+	return inUse;
+}
+
+void UploadManager::LogStats() const
+{
+	[[maybe_unused]] const double throughput = m_Stats.stagingTime > 0.0 ? m_Stats.bytesUploaded / m_Stats.stagingTime / 1e9 : 0.0;
+	LOG_DEBUG("Uploads: {0:.2f} MB in {1} copies over {2} submits, staged at {3:.2f} GB/s, {4} stalls waiting {5:.2f} ms, {6:.2f} MB of staging buffers",
+		m_Stats.bytesUploaded / 1e6, m_Stats.copyCount, m_Stats.submitCount, throughput, m_Stats.stallCount,
+		m_Stats.stallTime * 1000.0, GetStagingSize() / 1e6);
+	LOG_DEBUG("Uploads: {0} static buffers with {1:.2f} MB mapped at creation", m_Stats.staticBufferCount, m_Stats.staticBytes / 1e6);
+}
+
+UploadManager::StagingBlock* UploadManager::GetBlock()
+{
+	// Keep filling the current block, then move on to any other that is mapped and has room
+	for (size_t i = 0; i < m_Blocks.size(); ++i)
+	{
+		const uint32_t index = static_cast<uint32_t>((m_CurrentBlock + i) % m_Blocks.size());
+		StagingBlock& block = *m_Blocks[index];
+		if (block.data && block.used < m_BlockSize)
+		{
+			m_CurrentBlock = index;
+			return &block;
+		}
+	}
+
+	if (m_Blocks.size() < m_MaxBlocks && CreateBlock())
+	{
+		m_CurrentBlock = static_cast<uint32_t>(m_Blocks.size() - 1);
+		return m_Blocks.back().get();
+	}
+
+	// Every block is full or in flight, what was staged so far has to reach the GPU before any comes back
+	++m_Stats.stallCount;
+	auto startTime = std::chrono::steady_clock::now();
+	Submit();
+
+	StagingBlock* mappedBlock = nullptr;
+	while (!mappedBlock)
+	{
+		auto isMapping = [](const std::unique_ptr<StagingBlock>& block) { return block->mapping; };
+		if (std::none_of(m_Blocks.begin(), m_Blocks.end(), isMapping) || !Poll())
+			break;
+
+		for (uint32_t index = 0; index < m_Blocks.size() && !mappedBlock; ++index)
+		{
+			if (m_Blocks[index]->data)
+			{
+				m_CurrentBlock = index;
+				mappedBlock = m_Blocks[index].get();
+			}
+		}
+	}
+
+	m_Stats.stallTime += SecondsSince(startTime);
+	if (!mappedBlock)
+		LOG_ERROR("No staging buffer could be mapped for writing");
+	return mappedBlock;
+}
+
+bool UploadManager::CreateBlock()
+{
+	wgpu::BufferDescriptor bufferDesc;
+	bufferDesc.label = "Staging Buffer";
+	bufferDesc.usage = wgpu::BufferUsage::MapWrite | wgpu::BufferUsage::CopySrc;
+	bufferDesc.size = m_BlockSize;
+	// Writable straight away, later it is mapped again once the GPU is done with it
+	bufferDesc.mappedAtCreation = true;
+	wgpu::Buffer buffer = m_Device.createBuffer(bufferDesc);
+	void* data = buffer ? buffer.getMappedRange(0, static_cast<size_t>(m_BlockSize)) : nullptr;
+	if (!data)
+	{
+		LOG_ERROR("Could not create a {0} byte staging buffer", m_BlockSize);
+		if (buffer)
+			buffer.release();
+		return false;
+	}
+
+	std::unique_ptr<StagingBlock> block = std::make_unique<StagingBlock>();
+	block->buffer = buffer;
+	block->data = static_cast<unsigned char*>(data);
+	m_Blocks.push_back(std::move(block));
+	LOG_TRACE("Created staging buffer {0} of {1} bytes", m_Blocks.size(), m_BlockSize);
+	return true;
+}
+
+bool UploadManager::Poll()
+{
+#if defined(WEBGPU_BACKEND_DAWN)
+	m_Device.tick();
+	return true;
+#elif defined(WEBGPU_BACKEND_WGPU)
+	m_Device.poll(true);
+	return true;
+#else
+	// The browser only reports completed work once control returns to it
+	return false;
+#endif
+}
+}
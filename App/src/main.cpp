@@ -5,15 +5,26 @@
 
 #include "Logger.hpp"
 #include "Application.hpp"
+#include "JobSystem.hpp"
+#include "Profiler.hpp"
 
 int main(int argc, char* argv[])
 {
 	atcp::Logger::Init("App");
-	atcp::Application app;
-	if (app.Init(argc, argv) != 0)
-		EXIT_FAILURE;
+	PROFILE_BEGIN_SESSION("Trace.json");
+	PROFILE_THREAD("Main");
+	atcp::JobSystem::Init();
 
-	app.Run();
+	int result = 1;
+	{
+		// The application is destroyed before the job system and the logger it uses shut down
+		atcp::Application app;
+		if (app.Init(argc, argv) == 0)
+			result = app.Run();
+	}
 
-	return EXIT_SUCCESS;
+	atcp::JobSystem::Shutdown();
+	PROFILE_END_SESSION();
+	atcp::Logger::Shutdown();
+	return result == 0 ? EXIT_SUCCESS : EXIT_FAILURE;
 }
\ No newline at end of file
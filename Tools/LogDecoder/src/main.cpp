@@ -0,0 +1,261 @@
+#include <algorithm>
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <ctime>
+#include <fstream>
+#include <iostream>
+#include <iterator>
+#include <string>
+#include <vector>
+#include <spdlog/spdlog.h>
+#ifdef SPDLOG_FMT_EXTERNAL
+#include <fmt/args.h>
+#else
+#include <spdlog/fmt/bundled/args.h>
+#endif
+
+#include "BinaryLogFormat.hpp"
+
+// Turns a binary log written with ATTERCOP_BINARY_LOG into the same text as Log.txt
+
+namespace {
+struct Site {
+	spdlog::level::level_enum level = spdlog::level::info;
+	uint32_t line = 0;
+	std::vector<atcp::BinaryLogArg> argTypes;
+	std::string file;
+	std::string format;
+	bool registered = false;
+};
+
+struct Message {
+	int64_t timestamp;
+	uint32_t threadId;
+	spdlog::level::level_enum level;
+	std::string text;
+};
+
+class Reader
+{
+public:
+	Reader(const std::vector<char>& data) : m_Data(data) {}
+
+	template<typename T>
+	bool Read(T& value)
+	{
+		if (m_Offset + sizeof(T) > m_Data.size())
+			return false;
+		std::memcpy(&value, m_Data.data() + m_Offset, sizeof(T));
+		m_Offset += sizeof(T);
+		return true;
+	}
+
+	bool ReadString(std::string& text)
+	{
+		uint32_t length;
+		if (!Read(length) || m_Offset + length > m_Data.size())
+			return false;
+		text.assign(m_Data.data() + m_Offset, length);
+		m_Offset += length;
+		return true;
+	}
+
+	bool AtEnd() const { return m_Offset >= m_Data.size(); }
+
+private:
+	const std::vector<char>& m_Data;
+	size_t m_Offset = 0;
+};
+
+bool ReadSite(Reader& reader, std::vector<Site>& sites)
+{
+	uint32_t siteId;
+	uint8_t level, argCount;
+	Site site;
+	if (!reader.Read(siteId) || !reader.Read(level) || !reader.Read(site.line) || !reader.Read(argCount))
+		return false;
+
+	for (uint8_t i = 0; i < argCount; ++i)
+	{
+		uint8_t type;
+		if (!reader.Read(type))
+			return false;
+		site.argTypes.push_back(static_cast<atcp::BinaryLogArg>(type));
+	}
+	if (!reader.ReadString(site.file) || !reader.ReadString(site.format))
+		return false;
+
+	site.level = static_cast<spdlog::level::level_enum>(level);
+	site.registered = true;
+	if (siteId >= sites.size())
+		sites.resize(siteId + 1);
+	sites[siteId] = std::move(site);
+	return true;
+}
+
+bool ReadMessage(Reader& reader, const std::vector<Site>& sites, std::vector<Message>& messages)
+{
+	uint32_t siteId;
+	Message message;
+	if (!reader.Read(siteId) || !reader.Read(message.timestamp) || !reader.Read(message.threadId))
+		return false;
+
+	if (siteId >= sites.size() || !sites[siteId].registered)
+	{
+		std::cerr << "Message refers to unknown site " << siteId << std::endl;
+		return false;
+	}
+	const Site& site = sites[siteId];
+
+	fmt::dynamic_format_arg_store<fmt::format_context> args;
+	for (atcp::BinaryLogArg type : site.argTypes)
+	{
+		switch (type)
+		{
+		case atcp::BinaryLogArg::Int64: {
+			int64_t value;
+			if (!reader.Read(value))
+				return false;
+			args.push_back(value);
+			break;
+		}
+		case atcp::BinaryLogArg::UInt64: {
+			uint64_t value;
+			if (!reader.Read(value))
+				return false;
+			args.push_back(value);
+			break;
+		}
+		case atcp::BinaryLogArg::Double: {
+			double value;
+			if (!reader.Read(value))
+				return false;
+			args.push_back(value);
+			break;
+		}
+		case atcp::BinaryLogArg::Bool: {
+			char value;
+			if (!reader.Read(value))
+				return false;
+			args.push_back(value != 0);
+			break;
+		}
+		case atcp::BinaryLogArg::Char: {
+			char value;
+			if (!reader.Read(value))
+				return false;
+			args.push_back(value);
+			break;
+		}
+		case atcp::BinaryLogArg::String: {
+			std::string value;
+			if (!reader.ReadString(value))
+				return false;
+			args.push_back(std::move(value));
+			break;
+		}
+		default:
+			std::cerr << "Unknown argument type " << static_cast<int>(type) << std::endl;
+			return false;
+		}
+	}
+
+	try {
+		message.text = fmt::vformat(site.format, args);
+	}
+	catch (const fmt::format_error& error) {
+		message.text = site.format + " [format error: " + error.what() + "]";
+	}
+	message.level = site.level;
+	messages.push_back(std::move(message));
+	return true;
+}
+
+void PrintMessage(std::ostream& out, const std::string& loggerName, const Message& message)
+{
+	// Same pattern as the text log: [%d/%m/%Y] [%T] [%l] %n: %v
+	std::time_t seconds = static_cast<std::time_t>(message.timestamp / 1000000000);
+	char time[32];
+	std::strftime(time, sizeof(time), "[%d/%m/%Y] [%H:%M:%S]", std::localtime(&seconds));
+
+	spdlog::string_view_t level = spdlog::level::to_string_view(message.level);
+	out << time << " [" << std::string(level.data(), level.size()) << "] " << loggerName << ": " << message.text << '\n';
+}
+}
+
+int main(int argc, char* argv[])
+{
+	if (argc < 2)
+	{
+		std::cerr << "Usage: LogDecoder <Log.bin> [output]" << std::endl;
+		return EXIT_FAILURE;
+	}
+
+	std::ifstream file(argv[1], std::ios::binary);
+	if (!file.is_open())
+	{
+		std::cerr << "Could not open " << argv[1] << std::endl;
+		return EXIT_FAILURE;
+	}
+	std::vector<char> data((std::istreambuf_iterator<char>(file)), std::istreambuf_iterator<char>());
+
+	Reader reader(data);
+	char magic[sizeof(atcp::BinaryLogMagic)];
+	uint32_t version;
+	std::string loggerName;
+	if (!reader.Read(magic) || std::memcmp(magic, atcp::BinaryLogMagic, sizeof(magic)) != 0
+		|| !reader.Read(version) || !reader.ReadString(loggerName))
+	{
+		std::cerr << argv[1] << " is not a binary log" << std::endl;
+		return EXIT_FAILURE;
+	}
+	if (version != atcp::BinaryLogVersion)
+	{
+		std::cerr << "Unsupported binary log version " << version << std::endl;
+		return EXIT_FAILURE;
+	}
+
+	std::vector<Site> sites;
+	std::vector<Message> messages;
+	bool complete = true;
+	while (!reader.AtEnd())
+	{
+		uint8_t kind;
+		reader.Read(kind);
+		bool read = false;
+		if (kind == static_cast<uint8_t>(atcp::BinaryLogRecord::Site))
+			read = ReadSite(reader, sites);
+		else if (kind == static_cast<uint8_t>(atcp::BinaryLogRecord::Message))
+			read = ReadMessage(reader, sites, messages);
+
+		if (!read)
+		{
+			complete = false;
+			break;
+		}
+	}
+
+	// Threads write their buffers out in blocks, so messages are only in order within a thread
+	std::stable_sort(messages.begin(), messages.end(), [](const Message& a, const Message& b) {
+		return a.timestamp < b.timestamp;
+	});
+
+	std::ofstream outputFile;
+	if (argc > 2)
+	{
+		outputFile.open(argv[2]);
+		if (!outputFile.is_open())
+		{
+			std::cerr << "Could not open " << argv[2] << std::endl;
+			return EXIT_FAILURE;
+		}
+	}
+	std::ostream& out = argc > 2 ? outputFile : std::cout;
+	for (const Message& message : messages)
+		PrintMessage(out, loggerName, message);
+
+	if (!complete)
+		std::cerr << "Log is truncated or corrupt, decoded " << messages.size() << " messages" << std::endl;
+	return EXIT_SUCCESS;
+}
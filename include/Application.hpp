@@ -2,9 +2,26 @@
 #define APPLICATION_HPP
 
 #include <webgpu/webgpu.hpp>
+#include <array>
 #include <filesystem>
+#include <vector>
+
+#include "AssetManager.hpp"
+#include "DynamicBvh.hpp"
+#include "FrameLimiter.hpp"
+#include "GpuResources.hpp"
+#include "JobSystem.hpp"
+#include "PipelineCache.hpp"
+#include "Scene.hpp"
+#include "Simulation.hpp"
+#include "TimingStats.hpp"
+#include "UniformRing.hpp"
+#include "UploadManager.hpp"
+#include "Uniforms.hpp"
 
 int main(int argc, char* argv[]);
+struct SDL_Window;
+union SDL_Event;
 
 namespace atcp {
 class Application {
@@ -16,36 +33,184 @@ public:
 	int Init(int argc, char* argv[]);
 
 private:
-	void Run();
+	int Run();
+	// Render each of BenchmarkInstanceCounts offscreen and log the CPU time spent encoding a frame
+	void RunBenchmark();
+	/**
+	 * Render a fixed number of frames offscreen with a fixed time step, log CPU and GPU timings and optionally
+	 * read the last frame back to a PNG or a hash so runs can be compared.
+	 */
+	int RunHeadless();
+	// Stops the simulation worker before reading its counters
+	void LogSimulationStats();
+	void HandleEvent(const SDL_Event& event);
+	// (Re)configure the surface for the current size and present mode
+	void ConfigureSurface();
+	void RenderFrame(wgpu::TextureView targetView, float time);
+	void WaitForGPU();
+	bool ReadbackFrame(std::vector<uint8_t>& rgba);
+	// Record the frame's draws into bundles, split by instance range across worker threads
+	std::vector<wgpu::RenderBundle> RecordRenderBundles(uint32_t uniformOffset);
+	void InvalidateRenderBundles();
 	wgpu::TextureView GetNextSurfaceTextureView();
 	wgpu::RequiredLimits GetRequiredLimits(wgpu::Adapter adapter);
-	void InitializeBuffers();
-	wgpu::ShaderModule LoadShaderModule(const std::filesystem::path& path);
+	// Start loading the shader and mesh in the background
+	void LoadAssets();
+	void CreatePlaceholderMesh();
+	// Upload within the budget and switch to the loaded mesh once it and its pipeline are ready
+	void UpdateAssets();
+	RenderPipelineState GetPipelineState(const MeshLayout& vertexLayout) const;
+	// Create the pipelines of every layout known once the shader has loaded as parallel jobs
+	void PrewarmPipelines();
+	// Block until every asset is loaded and drawn with, false if there is nothing to draw with
+	bool WaitForAssets();
+	// Rebuild the instance list from the scene's entities
+	void UpdateInstances();
+	void SetInstances(const std::vector<InstanceData>& instances);
+	// Draw only the instances whose bounds at 'time' overlap the view, found through the BVH
+	void CullInstances(float time);
+	// Log culling times and the average visible and culled counts since the last call, then reset them
+	void LogCullingStats();
+	// Replace the scene's entities with 'count' quads on a grid
+	void CreateInstanceGrid(uint32_t count);
 
 	double GetTime();
 
 private:
 	bool m_Running = false;
+	// Time parsing 100 MB of mesh text against the stream parser, no GPU needed
+	bool m_ParserBenchmark = false;
+	// Compare parsing meshes split into chunks with parsing them whole, no GPU needed
+	bool m_ParserCheck = false;
+	// Time each logging call from 1 and 8 threads through the synchronous, asynchronous and binary logs, no GPU needed
+	bool m_LogBenchmark = false;
 	float m_FixedUpdateInterval = 0.01f;
+	static constexpr uint32_t MaxSimulationStepsPerFrame = 8;
+	// Simulate the next frame on a worker thread while the current one is rendered
+	bool m_PipelinedSimulation = false;
+	Simulation m_Simulation;
+
+	bool m_Headless = false;
+	bool m_Benchmark = false;
+	// Time the job system with 1 to N threads and stress its dependency handling, no GPU needed
+	bool m_JobBenchmark = false;
+	// Time iterating and updating a million entities, no GPU needed
+	bool m_SceneBenchmark = false;
+	// Time the batch math kernels at each SIMD level against the scalar ones, no GPU needed
+	bool m_MathBenchmark = false;
+	// Time refitting, rebuilding and querying a BVH over 100k moving boxes, no GPU needed
+	bool m_BvhBenchmark = false;
+	bool m_FallbackAdapter = false;
+	uint32_t m_HeadlessFrames = 100;
+	std::filesystem::path m_CapturePath;
+	bool m_HashCapture = false;
+	static constexpr float HeadlessTimeStep = 1.0f / 60.0f;
+	// Replay draws recorded once into render bundles instead of encoding them every frame
+	bool m_UseRenderBundles = true;
+	static constexpr uint32_t BenchmarkInstanceCounts[] = { 1000, 10000, 100000 };
+	static constexpr uint32_t BenchmarkFrames = 200;
 
 	wgpu::Instance m_Instance = nullptr;
 	wgpu::Adapter m_Adapter = nullptr;
 	wgpu::Surface m_Surface = nullptr;
 	wgpu::Device m_Device = nullptr;
 	wgpu::Queue m_Queue = nullptr;
+	// Owns buffers, bind groups, pipelines and shader modules, declared first so it outlives their users
+	GpuResources m_Resources;
+	PipelineCache m_PipelineCache;
+	// Owned by the pipeline cache
 	wgpu::RenderPipeline m_Pipeline = nullptr;
 	wgpu::Limits m_DeviceLimits;
 
+	uint32_t m_Width = 640;
+	uint32_t m_Height = 480;
+	wgpu::TextureFormat m_SurfaceFormat = wgpu::TextureFormat::Undefined;
+	// Requested with --present-mode, Fifo is used when the surface does not support it
+	wgpu::PresentMode m_PresentMode = wgpu::PresentMode::Fifo;
+	// Set on resize or when the surface reports it no longer matches the window
+	bool m_SurfaceOutdated = false;
+	SDL_Window* m_Window = nullptr;
+
+	FrameLimiter m_FrameLimiter;
+	// Present to present
+	TimingStats m_FrameTimes;
+	// Input event to the present of the first frame after it
+	TimingStats m_InputLatency;
+	// When the oldest input event not yet followed by a present happened, negative if there is none
+	double m_PendingInputTime = -1.0;
+	// Seconds between logging frame time and latency percentiles
+	static constexpr double FrameStatsInterval = 5.0;
+	// Render target used instead of the surface when headless
+	wgpu::Texture m_OffscreenTexture = nullptr;
+
 	static Application* s_Instance;
 	friend int ::main(int argc, char* argv[]);
 
-	wgpu::Buffer m_VertexBuffer;
-	uint32_t m_VertexCount;
-	wgpu::Buffer m_IndexBuffer;
-	uint32_t m_IndexCount;
+	UploadManager m_Uploads;
+	static constexpr uint64_t StagingBlockSize = 4 * 1024 * 1024;
+	static constexpr uint32_t MaxStagingBlocks = 8;
+	AssetManager m_Assets;
+	// Bytes of mesh data copied to the GPU per frame, set with --upload-budget
+	uint64_t m_UploadBudget = 4 * 1024 * 1024;
+	MeshHandle m_MeshAsset;
+	ShaderHandle m_ShaderAsset;
+	// Drawn until the mesh has loaded
+	GpuMesh m_PlaceholderMesh;
+	// Mesh the current pipeline was created for, null until the shader has loaded
+	const GpuMesh* m_DrawMesh = nullptr;
+	bool m_AssetsLoaded = false;
+
+	// Pipelines are created by a job, the result is picked up once the counter is done
+	JobCounter m_PipelineJobs;
+	bool m_PipelinesPrewarmed = false;
+	std::vector<RenderPipelineState> m_PrewarmStates;
+	RenderPipelineState m_PendingPipelineState;
+	wgpu::RenderPipeline m_PendingPipeline = nullptr;
+	const GpuMesh* m_PendingMesh = nullptr;
+
+	double m_StartTime = 0.0;
+	double m_FirstFrameTime = -1.0;
+
+	// Frames the CPU may run ahead of the GPU before the uniform ring stalls
+	static constexpr uint32_t FramesInFlight = 3;
+	static constexpr uint32_t UniformSlotsPerFrame = 1024;
+	UniformRing m_UniformRing;
+	// Owned by the pipeline cache
+	wgpu::BindGroupLayout m_BindGroupLayout = nullptr;
+	BindGroupHandle m_BindGroup;
+
+	Scene m_Scene;
+	// Scene version the instance buffer was built from
+	uint64_t m_InstanceVersion = UINT64_MAX;
+	uint32_t m_InstanceCount = 0;
+	BufferHandle m_InstanceBuffer;
+	// One set per uniform ring frame since the recorded dynamic offset differs between them
+	std::array<std::vector<wgpu::RenderBundle>, FramesInFlight> m_RenderBundles;
+	static constexpr uint32_t MinInstancesPerBundle = 4096;
+
+	// Turned off with --no-culling to draw every instance
+	bool m_Culling = true;
+	static constexpr uint32_t CullingGrain = 1024;
+	// Clip space units the view is widened by
+	static constexpr float ViewMargin = 0.001f;
+	// Leaf per instance, rebuilt whenever the instance list is
+	DynamicBvh m_Bvh;
+	std::vector<uint32_t> m_InstanceLeaves;
+	// Every instance in scene order, the instance buffer holds the visible ones at its start
+	std::vector<InstanceData> m_SceneInstances;
+	// Where each instance's mesh is drawn this frame, its bounds are the mesh's transformed by it
+	std::vector<Mat4> m_InstanceTransforms;
+	std::vector<Aabb> m_InstanceBounds;
+	std::vector<uint8_t> m_InstanceVisible;
+	// Which instances the instance buffer holds
+	std::vector<uint8_t> m_DrawnVisible;
+	std::vector<InstanceData> m_VisibleInstances;
+	TimingStats m_CullTimes;
+	uint64_t m_VisibleTotal = 0;
+	uint64_t m_CulledTotal = 0;
 
-	wgpu::Buffer m_UniformBuffer;
-	wgpu::BindGroup m_BindGroup;
+	// Last frame's CPU time from creating the command encoder to finishing the command buffer
+	double m_EncodeTime = 0.0;
 
 	std::filesystem::path m_WorkingDirectory;
 
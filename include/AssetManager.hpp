@@ -0,0 +1,129 @@
+#ifndef ASSETMANAGER_HPP
+#define ASSETMANAGER_HPP
+
+#include <webgpu/webgpu.hpp>
+#include <array>
+#include <atomic>
+#include <cstdint>
+#include <deque>
+#include <filesystem>
+
+#include "GpuResources.hpp"
+#include "JobSystem.hpp"
+#include "MathTypes.hpp"
+#include "MeshCache.hpp"
+#include "MeshLayout.hpp"
+
+namespace atcp {
+class PipelineCache;
+class UploadManager;
+
+enum class AssetState : uint8_t {
+	Loading,
+	// Loaded on the CPU, waiting for AssetManager::Update to copy it to the GPU
+	Uploading,
+	Ready,
+	Failed,
+};
+
+struct MeshHandle {
+	static constexpr uint32_t InvalidIndex = UINT32_MAX;
+	uint32_t index = InvalidIndex;
+};
+
+struct ShaderHandle {
+	static constexpr uint32_t InvalidIndex = UINT32_MAX;
+	uint32_t index = InvalidIndex;
+};
+
+// Vertex and index buffers of a mesh on the GPU
+struct GpuMesh {
+	BufferHandle vertexBuffer;
+	BufferHandle indexBuffer;
+	uint32_t vertexCount = 0;
+	uint32_t indexCount = 0;
+	wgpu::IndexFormat indexFormat = wgpu::IndexFormat::Uint16;
+	MeshLayout layout = MeshLayout::PositionColour();
+	// Dequantizes positions: { scale.x, scale.y, offset.x, offset.y }
+	std::array<float, 4> positionTransform = { 1.0f, 1.0f, 0.0f, 0.0f };
+	// Of the dequantized positions
+	Aabb bounds;
+};
+
+/**
+ * Loads meshes and shaders as jobs and hands out handles straight away, callers poll the state and use a
+ * placeholder until the asset is ready. Mesh data is staged for the GPU by Update on the main thread, at most
+ * the upload budget per call so loading never stalls a frame for long.
+ */
+class AssetManager
+{
+public:
+	AssetManager() = default;
+	AssetManager(const AssetManager&) = delete;
+	AssetManager& operator=(const AssetManager&) = delete;
+	~AssetManager();
+
+	// 'uploadBudget' is in bytes per Update, 0 uploads everything loaded so far
+	void Init(GpuResources& resources, UploadManager& uploads, PipelineCache& pipelineCache, uint64_t maxBufferSize, uint64_t uploadBudget);
+	// Waits for loads in progress and destroys every buffer
+	void Release();
+
+	MeshHandle LoadMesh(const std::filesystem::path& sourcePath, const std::filesystem::path& cachePath, const MeshImportOptions& options);
+	// The module ends up in the pipeline cache, GetShaderHash gives its key once ready
+	ShaderHandle LoadShader(const std::filesystem::path& path);
+
+	// Stage loaded meshes within the budget, call once per frame before UploadManager::Submit
+	void Update();
+	// Run load jobs on this thread until every load has finished on the CPU
+	void WaitForLoads();
+
+	AssetState GetState(MeshHandle mesh) const;
+	AssetState GetState(ShaderHandle shader) const;
+	// Null until the mesh is ready
+	const GpuMesh* GetMesh(MeshHandle mesh) const;
+	// Known once the mesh has loaded on the CPU, before it is on the GPU
+	bool GetMeshLayout(MeshHandle mesh, MeshLayout& layout) const;
+	uint64_t GetShaderHash(ShaderHandle shader) const;
+
+	// Nothing is loading or waiting to upload
+	bool IsIdle() const;
+	uint64_t GetUploadBudget() const { return m_UploadBudget; }
+	// Bytes copied by the last Update
+	uint64_t GetBytesUploaded() const { return m_BytesUploaded; }
+
+private:
+	struct MeshEntry {
+		std::atomic<AssetState> state{ AssetState::Loading };
+		std::filesystem::path sourcePath;
+		std::filesystem::path cachePath;
+		MeshImportOptions options;
+		// Written by the load job, read by Update once the state is Uploading
+		MappedMesh mapped;
+		GpuMesh gpu;
+		// Bytes of the vertex then index data copied so far
+		uint64_t uploadedBytes = 0;
+	};
+
+	struct ShaderEntry {
+		std::atomic<AssetState> state{ AssetState::Loading };
+		std::filesystem::path path;
+		uint64_t hash = 0;
+	};
+
+	bool CreateBuffers(MeshEntry& mesh);
+
+	GpuResources* m_Resources = nullptr;
+	UploadManager* m_Uploads = nullptr;
+	PipelineCache* m_PipelineCache = nullptr;
+	uint64_t m_MaxBufferSize = 0;
+	uint64_t m_UploadBudget = 0;
+	uint64_t m_BytesUploaded = 0;
+
+	// Deques so entries stay in place while jobs write to them
+	std::deque<MeshEntry> m_Meshes;
+	std::deque<ShaderEntry> m_Shaders;
+	JobCounter m_Loads;
+};
+}
+
+#endif // ASSETMANAGER_HPP
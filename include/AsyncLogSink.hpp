@@ -0,0 +1,72 @@
+#ifndef ASYNCLOGSINK_HPP
+#define ASYNCLOGSINK_HPP
+
+#include <atomic>
+#include <condition_variable>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+#include <spdlog/sinks/sink.h>
+
+#include "BoundedQueue.hpp"
+#include "Logger.hpp"
+
+namespace atcp {
+/**
+ * Sink that hands messages to a background thread through a lock-free queue. The background thread
+ * formats and writes them to the wrapped sinks in batches, so logging only costs a copy into the queue.
+ */
+class AsyncLogSink : public spdlog::sinks::sink
+{
+public:
+	AsyncLogSink(std::vector<spdlog::sink_ptr> sinks, size_t capacity, LogOverflowPolicy overflowPolicy);
+	AsyncLogSink(const AsyncLogSink&) = delete;
+	AsyncLogSink& operator=(const AsyncLogSink&) = delete;
+	~AsyncLogSink() override;
+
+	void log(const spdlog::details::log_msg& msg) override;
+	// Blocks until every message logged before the call is written
+	void flush() override;
+	void set_pattern(const std::string& pattern) override;
+	void set_formatter(std::unique_ptr<spdlog::formatter> sinkFormatter) override;
+
+	uint64_t GetDroppedCount() const { return m_Dropped.load(std::memory_order_relaxed); }
+	uint64_t GetBlockedCount() const { return m_Blocked.load(std::memory_order_relaxed); }
+
+private:
+	struct Record {
+		spdlog::log_clock::time_point time;
+		spdlog::source_loc source;
+		spdlog::level::level_enum level = spdlog::level::info;
+		size_t threadId = 0;
+		spdlog::string_view_t loggerName;
+		std::string payload;
+	};
+
+	static constexpr size_t MaxBatchSize = 256;
+	static constexpr size_t ReservedPayloadSize = 256;
+
+	bool TryPush(const spdlog::details::log_msg& msg);
+	void WorkerThread();
+	size_t WriteBatch();
+
+	std::vector<spdlog::sink_ptr> m_Sinks;
+	BoundedQueue<Record> m_Queue;
+	LogOverflowPolicy m_OverflowPolicy;
+
+	std::atomic<uint64_t> m_Enqueued{ 0 };
+	std::atomic<uint64_t> m_Written{ 0 };
+	std::atomic<uint64_t> m_Dropped{ 0 };
+	std::atomic<uint64_t> m_Blocked{ 0 };
+
+	// Only used to park the worker when the queue is empty
+	std::mutex m_WakeMutex;
+	std::condition_variable m_WakeCondition;
+	std::atomic<bool> m_WorkerSleeping{ false };
+	std::atomic<bool> m_Running{ true };
+	std::thread m_Worker;
+};
+}
+
+#endif // ASYNCLOGSINK_HPP
@@ -0,0 +1,124 @@
+#ifndef BINARYLOG_HPP
+#define BINARYLOG_HPP
+
+#include <cstdint>
+#include <cstring>
+#include <filesystem>
+#include <string>
+#include <string_view>
+#include <type_traits>
+#include <vector>
+#include <spdlog/spdlog.h>
+
+#include "BinaryLogFormat.hpp"
+
+namespace atcp {
+/**
+ * Deferred formatting log. Every call site registers its format string once and each message only writes the
+ * site id, a timestamp and the raw argument bytes into a per thread buffer. Files are turned back into text with
+ * the LogDecoder tool.
+ */
+class BinaryLog
+{
+public:
+	// Call sites register themselves once per process, so a process should only open one log
+	static bool Open(const std::filesystem::path& path, const std::string& loggerName);
+	// Write out every thread's buffer and close the file, messages logged after this are dropped
+	static void Close();
+	// Write out every thread's buffer, other threads may keep logging meanwhile
+	static void Flush();
+	// Bytes written to the file since it was opened, messages still in thread buffers are not included
+	static uint64_t GetWrittenSize();
+
+	/**
+	 * 'Site' is a type unique to the call site, used to register the site once.
+	 */
+	template<typename Site, typename... Args>
+	static void Log(Site, spdlog::level::level_enum level, const char* file, int line, const char* format, const Args&... args)
+	{
+		if (!IsOpen())
+			return;
+
+		static const uint8_t argTypes[] = { static_cast<uint8_t>(GetArgType<Args>())..., 0 };
+		static const uint32_t siteId = RegisterSite(level, file, line, format, argTypes, sizeof...(Args));
+
+		std::vector<char>& buffer = BeginMessage(siteId);
+		(Encode(buffer, args), ...);
+		EndMessage();
+	}
+
+	static bool IsOpen();
+
+private:
+	template<typename T>
+	static constexpr BinaryLogArg GetArgType()
+	{
+		using U = std::decay_t<T>;
+		if constexpr (std::is_same_v<U, bool>)
+			return BinaryLogArg::Bool;
+		else if constexpr (std::is_same_v<U, char>)
+			return BinaryLogArg::Char;
+		else if constexpr (std::is_enum_v<U>)
+			return std::is_signed_v<std::underlying_type_t<U>> ? BinaryLogArg::Int64 : BinaryLogArg::UInt64;
+		else if constexpr (std::is_integral_v<U>)
+			return std::is_signed_v<U> ? BinaryLogArg::Int64 : BinaryLogArg::UInt64;
+		else if constexpr (std::is_floating_point_v<U>)
+			return BinaryLogArg::Double;
+		else
+			return BinaryLogArg::String;
+	}
+
+	static void Append(std::vector<char>& buffer, const void* data, size_t size)
+	{
+		size_t offset = buffer.size();
+		buffer.resize(offset + size);
+		std::memcpy(buffer.data() + offset, data, size);
+	}
+
+	static void AppendString(std::vector<char>& buffer, std::string_view text)
+	{
+		uint32_t length = static_cast<uint32_t>(text.size());
+		Append(buffer, &length, sizeof(length));
+		Append(buffer, text.data(), text.size());
+	}
+
+	template<typename T>
+	static void Encode(std::vector<char>& buffer, const T& value)
+	{
+		constexpr BinaryLogArg type = GetArgType<T>();
+		if constexpr (type == BinaryLogArg::Bool || type == BinaryLogArg::Char) {
+			char byte = static_cast<char>(value);
+			Append(buffer, &byte, 1);
+		}
+		else if constexpr (type == BinaryLogArg::Int64) {
+			int64_t number = static_cast<int64_t>(value);
+			Append(buffer, &number, sizeof(number));
+		}
+		else if constexpr (type == BinaryLogArg::UInt64) {
+			uint64_t number = static_cast<uint64_t>(value);
+			Append(buffer, &number, sizeof(number));
+		}
+		else if constexpr (type == BinaryLogArg::Double) {
+			double number = static_cast<double>(value);
+			Append(buffer, &number, sizeof(number));
+		}
+		else if constexpr (std::is_same_v<T, const char*> || std::is_same_v<T, char*>) {
+			AppendString(buffer, value ? std::string_view(value) : std::string_view("(null)"));
+		}
+		else if constexpr (std::is_convertible_v<const T&, std::string_view>) {
+			AppendString(buffer, std::string_view(value));
+		}
+		else {
+			// Types without a raw encoding are formatted on the calling thread
+			AppendString(buffer, fmt::format("{}", value));
+		}
+	}
+
+	static uint32_t RegisterSite(spdlog::level::level_enum level, const char* file, int line, const char* format, const uint8_t* argTypes, size_t argCount);
+	// Locks the calling thread's buffer until EndMessage
+	static std::vector<char>& BeginMessage(uint32_t siteId);
+	static void EndMessage();
+};
+}
+
+#endif // BINARYLOG_HPP
@@ -0,0 +1,35 @@
+#ifndef BINARYLOGFORMAT_HPP
+#define BINARYLOGFORMAT_HPP
+
+#include <cstdint>
+
+namespace atcp
+{
+/**
+ * Binary log file layout, all values little endian:
+ *   header:  magic "ATBL", uint32 version, uint32 name length, logger name
+ *   Site:    uint8 kind, uint32 site id, uint8 level, uint32 line, uint8 argument count, uint8 argument types[count],
+ *            uint32 file length, file, uint32 format length, format
+ *   Message: uint8 kind, uint32 site id, int64 nanoseconds since the epoch, uint32 thread id, arguments
+ * Arguments are 8 bytes for Int64/UInt64/Double, 1 byte for Bool/Char and uint32 length plus bytes for String.
+ * A site record is always written before the first message that refers to it.
+ */
+constexpr char BinaryLogMagic[4] = { 'A', 'T', 'B', 'L' };
+constexpr uint32_t BinaryLogVersion = 1;
+
+enum class BinaryLogRecord : uint8_t {
+    Site = 1,
+    Message = 2,
+};
+
+enum class BinaryLogArg : uint8_t {
+    Int64 = 0,
+    UInt64 = 1,
+    Double = 2,
+    Bool = 3,
+    Char = 4,
+    String = 5,
+};
+} // namespace atcp
+
+#endif // BINARYLOGFORMAT_HPP
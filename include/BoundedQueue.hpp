@@ -0,0 +1,106 @@
+#ifndef BOUNDEDQUEUE_HPP
+#define BOUNDEDQUEUE_HPP
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+
+namespace atcp
+{
+/**
+ * Fixed capacity lock-free queue for any number of producers and consumers (Vyukov's bounded MPMC queue).
+ * Elements live in preallocated cells and are written and read in place, so nothing is allocated after construction.
+ */
+template<typename T>
+class BoundedQueue
+{
+public:
+	explicit BoundedQueue(size_t capacity)
+	{
+		size_t cellCount = 2;
+		while (cellCount < capacity)
+			cellCount *= 2;
+		m_Mask = cellCount - 1;
+		m_Cells = std::make_unique<Cell[]>(cellCount);
+		for (size_t i = 0; i < cellCount; ++i)
+			m_Cells[i].sequence.store(i, std::memory_order_relaxed);
+	}
+
+	BoundedQueue(const BoundedQueue&) = delete;
+	BoundedQueue& operator=(const BoundedQueue&) = delete;
+
+	size_t Capacity() const { return m_Mask + 1; }
+
+	/**
+	 * Claim a free cell and fill it with write(T&), returns false without calling write when the queue is full.
+	 */
+	template<typename Writer>
+	bool TryPush(Writer&& write)
+	{
+		Cell* cell;
+		size_t position = m_EnqueuePosition.load(std::memory_order_relaxed);
+		for (;;) {
+			cell = &m_Cells[position & m_Mask];
+			size_t sequence = cell->sequence.load(std::memory_order_acquire);
+			intptr_t difference = static_cast<intptr_t>(sequence) - static_cast<intptr_t>(position);
+			if (difference == 0) {
+				if (m_EnqueuePosition.compare_exchange_weak(position, position + 1, std::memory_order_relaxed))
+					break;
+			}
+			else if (difference < 0) {
+				return false;
+			}
+			else {
+				position = m_EnqueuePosition.load(std::memory_order_relaxed);
+			}
+		}
+
+		write(cell->data);
+		cell->sequence.store(position + 1, std::memory_order_release);
+		return true;
+	}
+
+	/**
+	 * Take the oldest element and pass it to read(T&), returns false when the queue is empty.
+	 */
+	template<typename Reader>
+	bool TryPop(Reader&& read)
+	{
+		Cell* cell;
+		size_t position = m_DequeuePosition.load(std::memory_order_relaxed);
+		for (;;) {
+			cell = &m_Cells[position & m_Mask];
+			size_t sequence = cell->sequence.load(std::memory_order_acquire);
+			intptr_t difference = static_cast<intptr_t>(sequence) - static_cast<intptr_t>(position + 1);
+			if (difference == 0) {
+				if (m_DequeuePosition.compare_exchange_weak(position, position + 1, std::memory_order_relaxed))
+					break;
+			}
+			else if (difference < 0) {
+				return false;
+			}
+			else {
+				position = m_DequeuePosition.load(std::memory_order_relaxed);
+			}
+		}
+
+		read(cell->data);
+		cell->sequence.store(position + m_Mask + 1, std::memory_order_release);
+		return true;
+	}
+
+private:
+	struct alignas(64) Cell {
+		std::atomic<size_t> sequence{ 0 };
+		T data;
+	};
+
+	std::unique_ptr<Cell[]> m_Cells;
+	size_t m_Mask = 0;
+	alignas(64) std::atomic<size_t> m_EnqueuePosition{ 0 };
+	alignas(64) std::atomic<size_t> m_DequeuePosition{ 0 };
+};
+} // namespace atcp
+
+#endif // BOUNDEDQUEUE_HPP
@@ -0,0 +1,17 @@
+#ifndef BVHBENCHMARK_HPP
+#define BVHBENCHMARK_HPP
+
+namespace atcp
+{
+class BvhBenchmark
+{
+public:
+    /**
+     * Move 100k boxes every frame, refit or rebuild the BVH over them and query a view rectangle on one thread
+     * and across the job system, against testing every box. Returns non-zero if a query found a different set.
+     */
+    static int Run();
+};
+} // namespace atcp
+
+#endif // BVHBENCHMARK_HPP
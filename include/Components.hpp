@@ -0,0 +1,76 @@
+#ifndef COMPONENTS_HPP
+#define COMPONENTS_HPP
+
+#include <array>
+#include <cstdint>
+
+#include "AssetManager.hpp"
+
+namespace atcp
+{
+struct Transform {
+    std::array<float, 2> position;
+    float scale;
+};
+
+struct Colour {
+    std::array<float, 4> value;
+};
+
+struct MeshRef {
+    MeshHandle mesh;
+};
+
+// Orbit angle is time * speed + phase, like InstanceData
+struct Animation {
+    float speed;
+    float phase;
+};
+
+enum class ComponentType : uint32_t {
+    Transform,
+    Colour,
+    MeshRef,
+    Animation,
+    Count,
+};
+constexpr uint32_t ComponentCount = static_cast<uint32_t>(ComponentType::Count);
+
+// One bit per ComponentType, an entity's archetype is the set of components it has
+using ComponentMask = uint32_t;
+
+constexpr std::array<uint32_t, ComponentCount> ComponentSizes = {
+    sizeof(Transform), sizeof(Colour), sizeof(MeshRef), sizeof(Animation),
+};
+
+template<typename Component>
+struct ComponentInfo;
+
+template<>
+struct ComponentInfo<Transform> {
+    static constexpr ComponentType Type = ComponentType::Transform;
+};
+
+template<>
+struct ComponentInfo<Colour> {
+    static constexpr ComponentType Type = ComponentType::Colour;
+};
+
+template<>
+struct ComponentInfo<MeshRef> {
+    static constexpr ComponentType Type = ComponentType::MeshRef;
+};
+
+template<>
+struct ComponentInfo<Animation> {
+    static constexpr ComponentType Type = ComponentType::Animation;
+};
+
+template<typename... Components>
+constexpr ComponentMask MaskOf()
+{
+    return (0u | ... | (1u << static_cast<uint32_t>(ComponentInfo<Components>::Type)));
+}
+} // namespace atcp
+
+#endif // COMPONENTS_HPP
@@ -0,0 +1,161 @@
+#ifndef DYNAMICBVH_HPP
+#define DYNAMICBVH_HPP
+
+#include <array>
+#include <cstdint>
+#include <vector>
+
+#include "JobSystem.hpp"
+#include "MathTypes.hpp"
+
+namespace atcp {
+/**
+ * Bounding volume hierarchy over boxes that move every frame. Leaves are inserted where they add the least
+ * surface area and keep their id until removed. Moving a leaf only stores its new box, Update then refits the
+ * internal nodes bottom up and rebuilds the tree with binned SAH splits once refitting has let it grow too
+ * costly.
+ *
+ * Queries call visit(userData) for every leaf overlapping the region. Nodes wholly inside the region hand over
+ * their leaves without testing them.
+ */
+class DynamicBvh
+{
+public:
+	static constexpr uint32_t NullNode = UINT32_MAX;
+	// Rebuild once the tree's cost reaches this many times its cost after the last rebuild
+	static constexpr float RebuildCostRatio = 1.5f;
+
+	// Replace the tree with a leaf per box, whose user data is the box's index, and write the leaf ids to 'leaves'
+	void Build(const Aabb* bounds, uint32_t count, uint32_t* leaves);
+	// Returns the leaf id
+	uint32_t Insert(const Aabb& bounds, uint32_t userData);
+	void Remove(uint32_t leaf);
+	/**
+	 * Store a leaf's new box without touching the rest of the tree, which is stale until Update. Several threads
+	 * may set different leaves at once.
+	 */
+	void SetBounds(uint32_t leaf, const Aabb& bounds) { m_Nodes[leaf].bounds = bounds; }
+	const Aabb& GetBounds(uint32_t leaf) const { return m_Nodes[leaf].bounds; }
+	uint32_t GetUserData(uint32_t leaf) const { return m_Nodes[leaf].userData; }
+
+	// Refit every internal node, or rebuild when the tree has degraded, returns true if it rebuilt
+	bool Update();
+	void Refit();
+	// Leaf ids stay valid
+	void Rebuild();
+	void Clear();
+
+	template<typename Function>
+	void Query(const Aabb& region, Function&& visit) const;
+	// Splits the tree into subtrees queried over the job system, 'visit' is called from several threads at once
+	template<typename Function>
+	void ParallelQuery(const Aabb& region, Function&& visit) const;
+
+	uint32_t GetLeafCount() const { return m_LeafCount; }
+	// Summed half area of the internal nodes relative to the root's, as of the last Update
+	float GetCost() const { return m_Cost; }
+	uint32_t GetRebuildCount() const { return m_RebuildCount; }
+
+private:
+	// Subtrees handed to each worker by ParallelQuery
+	static constexpr uint32_t SubtreesPerThread = 4;
+	static constexpr uint32_t SahBins = 16;
+
+	struct Node {
+		Aabb bounds;
+		// Next free node while on the free list
+		uint32_t parent = NullNode;
+		std::array<uint32_t, 2> children = { NullNode, NullNode };
+		uint32_t userData = 0;
+
+		bool IsLeaf() const { return children[0] == NullNode; }
+	};
+
+	// Leaves copied out of the nodes so building reads them in order
+	struct BuildItem {
+		Aabb bounds;
+		Vec3 centre;
+		uint32_t leaf;
+	};
+
+	uint32_t AllocateNode();
+	void FreeNode(uint32_t node);
+	void InsertLeaf(uint32_t leaf);
+	void RemoveLeaf(uint32_t leaf);
+	// Recompute the bounds of 'node' and its ancestors from their children
+	void RefitAncestors(uint32_t node);
+	uint32_t BuildSubtree(BuildItem* items, uint32_t count);
+	// Build over m_BuildItems and take it as the rebuilt cost
+	void BuildRoot();
+	// Subtrees overlapping the region that together hold every overlapping leaf
+	std::vector<uint32_t> GetSubtrees(const Aabb& region, uint32_t target) const;
+
+	template<typename Function>
+	void QueryFrom(uint32_t root, const Aabb& region, Function& visit) const;
+
+	std::vector<Node> m_Nodes;
+	// Internal nodes parents first, reused by Refit
+	std::vector<uint32_t> m_RefitOrder;
+	std::vector<BuildItem> m_BuildItems;
+	uint32_t m_Root = NullNode;
+	uint32_t m_FreeList = NullNode;
+	uint32_t m_LeafCount = 0;
+	float m_Cost = 0.0f;
+	float m_RebuiltCost = 0.0f;
+	uint32_t m_RebuildCount = 0;
+};
+
+template<typename Function>
+void DynamicBvh::Query(const Aabb& region, Function&& visit) const
+{
+	if (m_Root != NullNode)
+		QueryFrom(m_Root, region, visit);
+}
+
+template<typename Function>
+void DynamicBvh::ParallelQuery(const Aabb& region, Function&& visit) const
+{
+	const std::vector<uint32_t> subtrees = GetSubtrees(region, JobSystem::GetThreadCount() * SubtreesPerThread);
+	JobSystem::ParallelFor(static_cast<uint32_t>(subtrees.size()), [this, &subtrees, &region, &visit](uint32_t begin, uint32_t end) {
+		for (uint32_t i = begin; i < end; ++i)
+			QueryFrom(subtrees[i], region, visit);
+	});
+}
+
+template<typename Function>
+void DynamicBvh::QueryFrom(uint32_t root, const Aabb& region, Function& visit) const
+{
+	std::vector<uint32_t> stack;
+	stack.reserve(64);
+	stack.push_back(root);
+	// Set while walking a subtree that lies wholly inside the region, above which everything is tested again
+	size_t insideDepth = SIZE_MAX;
+	while (!stack.empty())
+	{
+		if (stack.size() <= insideDepth)
+			insideDepth = SIZE_MAX;
+		const Node& node = m_Nodes[stack.back()];
+		stack.pop_back();
+
+		if (insideDepth == SIZE_MAX)
+		{
+			if (!Overlaps(node.bounds, region))
+				continue;
+			if (Contains(region, node.bounds))
+				insideDepth = stack.size();
+		}
+
+		if (node.IsLeaf())
+		{
+			visit(node.userData);
+		}
+		else
+		{
+			stack.push_back(node.children[1]);
+			stack.push_back(node.children[0]);
+		}
+	}
+}
+}
+
+#endif // DYNAMICBVH_HPP
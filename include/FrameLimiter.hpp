@@ -0,0 +1,32 @@
+#ifndef FRAMELIMITER_HPP
+#define FRAMELIMITER_HPP
+
+#include <chrono>
+
+namespace atcp
+{
+/**
+ * Paces frames to a target rate on the CPU. Most of the wait is slept and the last stretch is spun on the clock,
+ * since the scheduler can wake a sleeping thread a millisecond or more late.
+ */
+class FrameLimiter
+{
+public:
+    // 0 disables the limiter
+    void SetTargetRate(double framesPerSecond);
+    double GetTargetRate() const { return m_TargetRate; }
+
+    // Block until the next frame is due
+    void Wait();
+
+private:
+    using Clock = std::chrono::steady_clock;
+    static constexpr Clock::duration SpinThreshold = std::chrono::milliseconds(2);
+
+    double m_TargetRate = 0.0;
+    Clock::duration m_Period = Clock::duration::zero();
+    Clock::time_point m_NextFrame;
+};
+}
+
+#endif // FRAMELIMITER_HPP
@@ -0,0 +1,135 @@
+#ifndef GPURESOURCES_HPP
+#define GPURESOURCES_HPP
+
+#include <webgpu/webgpu.hpp>
+#include <array>
+#include <atomic>
+#include <cstdint>
+#include <deque>
+#include <memory>
+#include <mutex>
+#include <vector>
+
+#include "ResourcePool.hpp"
+
+namespace atcp {
+using BufferHandle = Handle<struct BufferTag>;
+using BindGroupHandle = Handle<struct BindGroupTag>;
+using RenderPipelineHandle = Handle<struct RenderPipelineTag>;
+using ShaderModuleHandle = Handle<struct ShaderModuleTag>;
+
+enum class GpuResourceType : uint8_t {
+	Buffer,
+	BindGroup,
+	RenderPipeline,
+	ShaderModule,
+	Count,
+};
+
+struct GpuResourceStats {
+	uint32_t live = 0;
+	// Destroyed but waiting for the GPU to finish the frames that may use them
+	uint32_t pending = 0;
+	// Only known for buffers
+	uint64_t liveBytes = 0;
+	uint64_t created = 0;
+	uint64_t destroyed = 0;
+};
+
+/**
+ * Owns GPU objects and hands out generational handles to them, a handle to a destroyed object resolves to null
+ * instead of a dangling object. Destroy only queues the object, it is released once the GPU has finished every
+ * frame submitted up to the next EndFrame, so objects can be replaced while earlier frames are in flight.
+ * Safe to call from several threads at once.
+ */
+class GpuResources
+{
+public:
+	GpuResources() = default;
+	GpuResources(const GpuResources&) = delete;
+	GpuResources& operator=(const GpuResources&) = delete;
+	~GpuResources();
+
+	void Init(wgpu::Device device, wgpu::Queue queue);
+	// Waits for the GPU to finish every frame and releases every object, destroyed or not
+	void Release();
+
+	BufferHandle CreateBuffer(const wgpu::BufferDescriptor& desc);
+	BindGroupHandle CreateBindGroup(const wgpu::BindGroupDescriptor& desc);
+	// Take ownership of objects created elsewhere, null objects give an invalid handle
+	BufferHandle Add(wgpu::Buffer buffer);
+	RenderPipelineHandle Add(wgpu::RenderPipeline pipeline);
+	ShaderModuleHandle Add(wgpu::ShaderModule shaderModule);
+
+	// Null when the handle is invalid or has been destroyed
+	wgpu::Buffer Get(BufferHandle handle) const;
+	wgpu::BindGroup Get(BindGroupHandle handle) const;
+	wgpu::RenderPipeline Get(RenderPipelineHandle handle) const;
+	wgpu::ShaderModule Get(ShaderModuleHandle handle) const;
+
+	// The handle is invalid from now on, the object is released once the GPU is done with it
+	void Destroy(BufferHandle handle);
+	void Destroy(BindGroupHandle handle);
+	void Destroy(RenderPipelineHandle handle);
+	void Destroy(ShaderModuleHandle handle);
+
+	// Call once the frame's commands have been submitted, releases objects the GPU has finished with
+	void EndFrame();
+
+	GpuResourceStats GetStats(GpuResourceType type) const;
+	void LogStats() const;
+
+private:
+	template<typename Resource>
+	struct Entry {
+		Resource resource = nullptr;
+		uint64_t size = 0;
+	};
+
+	template<typename Resource>
+	struct Retired {
+		Resource resource = nullptr;
+		uint64_t size = 0;
+		// Released once this many frames have completed
+		uint64_t frame = 0;
+	};
+
+	template<typename Resource, typename HandleType>
+	struct Pool {
+		GpuResourceType type;
+		ResourcePool<Entry<Resource>, HandleType> live;
+		std::vector<Retired<Resource>> retired;
+	};
+
+	template<typename Resource, typename HandleType>
+	HandleType AddTo(Pool<Resource, HandleType>& pool, Resource resource, uint64_t size);
+	template<typename Resource, typename HandleType>
+	Resource GetFrom(const Pool<Resource, HandleType>& pool, HandleType handle) const;
+	template<typename Resource, typename HandleType>
+	void DestroyIn(Pool<Resource, HandleType>& pool, HandleType handle);
+	// Release retired objects whose frames have completed, or all of them
+	template<typename Resource, typename HandleType>
+	void Collect(Pool<Resource, HandleType>& pool, bool all);
+	template<typename Resource, typename HandleType>
+	void ReleaseLive(Pool<Resource, HandleType>& pool);
+	void CollectAll(bool all);
+	bool Poll();
+
+	wgpu::Device m_Device = nullptr;
+	wgpu::Queue m_Queue = nullptr;
+
+	mutable std::mutex m_Mutex;
+	Pool<wgpu::Buffer, BufferHandle> m_Buffers{ GpuResourceType::Buffer, {}, {} };
+	Pool<wgpu::BindGroup, BindGroupHandle> m_BindGroups{ GpuResourceType::BindGroup, {}, {} };
+	Pool<wgpu::RenderPipeline, RenderPipelineHandle> m_RenderPipelines{ GpuResourceType::RenderPipeline, {}, {} };
+	Pool<wgpu::ShaderModule, ShaderModuleHandle> m_ShaderModules{ GpuResourceType::ShaderModule, {}, {} };
+	std::array<GpuResourceStats, static_cast<size_t>(GpuResourceType::Count)> m_Stats;
+
+	// Frames ended so far and frames the GPU has finished, the latter is set by queue callbacks
+	uint64_t m_FrameCount = 0;
+	std::atomic<uint64_t> m_CompletedFrames{ 0 };
+	std::deque<std::unique_ptr<wgpu::QueueWorkDoneCallback>> m_FrameCallbacks;
+};
+}
+
+#endif // GPURESOURCES_HPP
@@ -0,0 +1,31 @@
+#ifndef HASH_HPP
+#define HASH_HPP
+
+#include <cstddef>
+#include <cstdint>
+
+namespace atcp
+{
+constexpr uint64_t HashSeed = 14695981039346656037ull;
+
+/**
+ * 64-bit FNV-1a hash, pass a previous result as 'hash' to hash discontiguous data.
+ */
+inline uint64_t HashBytes(const void* data, size_t size, uint64_t hash = HashSeed)
+{
+    const unsigned char* bytes = static_cast<const unsigned char*>(data);
+    for (size_t i = 0; i < size; ++i) {
+        hash ^= bytes[i];
+        hash *= 1099511628211ull;
+    }
+    return hash;
+}
+
+template<typename T>
+inline uint64_t HashValue(const T& value, uint64_t hash = HashSeed)
+{
+    return HashBytes(&value, sizeof(T), hash);
+}
+} // namespace atcp
+
+#endif // HASH_HPP
@@ -0,0 +1,19 @@
+#ifndef IMAGEWRITER_HPP
+#define IMAGEWRITER_HPP
+
+#include <cstdint>
+#include <filesystem>
+
+namespace atcp
+{
+class ImageWriter
+{
+public:
+    /**
+     * Write tightly packed 8-bit RGBA pixels as an uncompressed PNG.
+     */
+    static bool WritePNG(const std::filesystem::path& path, uint32_t width, uint32_t height, const uint8_t* rgba);
+};
+} // namespace atcp
+
+#endif // IMAGEWRITER_HPP
@@ -1,24 +1,77 @@
 #ifndef INTERNALCONSOLESINK_HPP
 #define INTERNALCONSOLESINK_HPP
 
+#include <cstdint>
 #include <mutex>
+#include <string_view>
 #include <vector>
 #include <spdlog/sinks/base_sink.h>
 
 namespace atcp {
+/**
+ * Copy of the console history taken by InternalConsole::Snapshot, reuse one across frames to avoid reallocating.
+ */
+class ConsoleSnapshot
+{
+public:
+	struct Entry {
+		std::string_view text;
+		spdlog::level::level_enum level;
+	};
+
+	std::vector<Entry>::const_iterator begin() const { return m_Entries.begin(); }
+	std::vector<Entry>::const_iterator end() const { return m_Entries.end(); }
+	size_t size() const { return m_Entries.size(); }
+	bool empty() const { return m_Entries.empty(); }
+
+private:
+	std::vector<char> m_Text;
+	std::vector<Entry> m_Entries;
+
+	friend class InternalConsole;
+};
+
+/**
+ * Fixed capacity history of console messages. Message text is stored back to back in one ring arena and the
+ * oldest messages are evicted when either the arena or the entry table is full, nothing is allocated after Init.
+ */
 class InternalConsole
 {
 public:
+	static void Init(size_t entryCapacity = 4096, size_t arenaSize = 512 * 1024);
+
+	static void AddMessage(std::string_view message, spdlog::level::level_enum level);
+	static void Clear();
+
+	/**
+	 * Copy the messages at or above minLevel containing filter, oldest first.
+	 */
+	static void Snapshot(ConsoleSnapshot& snapshot, spdlog::level::level_enum minLevel = spdlog::level::trace, std::string_view filter = {});
 
-	using Message = std::pair<std::string, spdlog::level::level_enum>;
-	static uint16_t s_MessageBufferCapacity;
-	static uint16_t s_MessageBufferSize;
-	static uint16_t s_MessageBufferBegin;
-	static std::vector<Message> s_MessageBuffer;
+	static size_t GetSize();
+	static uint64_t GetTotalMessageCount();
+
+private:
+	struct Entry {
+		uint64_t begin;
+		uint32_t length;
+		spdlog::level::level_enum level;
+	};
+
+	static void Evict(uint64_t writeEnd);
+
+	static std::mutex s_Mutex;
+	static std::vector<char> s_Arena;
+	static std::vector<Entry> s_Entries;
+	static size_t s_FirstEntry;
+	static size_t s_EntryCount;
+	// Positions in the arena grow forever, the physical offset is position % arena size
+	static uint64_t s_WritePosition;
+	static uint64_t s_TotalMessages;
 };
 
 template <class Mutex>
-class InternalConsoleSink : public spdlog::sinks::base_sink<std::mutex>
+class InternalConsoleSink : public spdlog::sinks::base_sink<Mutex>
 {
 public:
 	explicit InternalConsoleSink()
@@ -33,26 +86,14 @@ protected:
 	void sink_it_(const spdlog::details::log_msg& msg) override
 	{
 		spdlog::memory_buf_t formatted;
-		base_sink<Mutex>::formatter_->format(msg, formatted);
+		spdlog::sinks::base_sink<Mutex>::formatter_->format(msg, formatted);
 
-		AddMessage(fmt::to_string(formatted), msg.level);
+		InternalConsole::AddMessage(std::string_view(formatted.data(), formatted.size()), msg.level);
 	}
 
 	void flush_() override
 	{
 	}
-
-private:
-	void AddMessage(const std::string& message, spdlog::level::level_enum level)
-	{
-		*(InternalConsole::s_MessageBuffer.begin() + InternalConsole::s_MessageBufferBegin) = std::make_pair(message, level);
-		if (++InternalConsole::s_MessageBufferBegin == InternalConsole::s_MessageBufferCapacity)
-			InternalConsole::s_MessageBufferBegin = 0;
-		if (InternalConsole::s_MessageBufferSize < InternalConsole::s_MessageBufferCapacity)
-			InternalConsole::s_MessageBufferSize++;
-	}
-
-private:
 };
 
 using InternalConsoleSink_mt = InternalConsoleSink<std::mutex>;
@@ -0,0 +1,18 @@
+#ifndef JOBBENCHMARK_HPP
+#define JOBBENCHMARK_HPP
+
+namespace atcp
+{
+class JobBenchmark
+{
+public:
+    /**
+     * Time the job system with 1 to N worker threads, then stress dependencies and nested waits and check every
+     * job ran after the jobs it depends on. Returns non-zero if a check failed. The job system is left initialized
+     * with one worker per hardware thread.
+     */
+    static int Run();
+};
+} // namespace atcp
+
+#endif // JOBBENCHMARK_HPP
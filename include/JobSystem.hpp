@@ -0,0 +1,136 @@
+#ifndef JOBSYSTEM_HPP
+#define JOBSYSTEM_HPP
+
+#include <algorithm>
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <new>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+namespace atcp {
+/**
+ * Number of jobs attached to it that have not finished, JobSystem::Wait returns once it is zero.
+ */
+class JobCounter
+{
+public:
+	JobCounter() = default;
+	JobCounter(const JobCounter&) = delete;
+	JobCounter& operator=(const JobCounter&) = delete;
+
+	bool IsDone() const { return m_Value.load(std::memory_order_acquire) == 0; }
+
+private:
+	friend class JobSystem;
+	std::atomic<uint32_t> m_Value{ 0 };
+};
+
+/**
+ * A function queued on the job system with its captures stored inline. Created by JobSystem::Create and
+ * destroyed by the job system once it has run.
+ */
+struct Job {
+	static constexpr size_t StorageSize = 64;
+
+	alignas(std::max_align_t) unsigned char storage[StorageSize];
+	void (*invoke)(void*) = nullptr;
+	void (*destroy)(void*) = nullptr;
+	JobCounter* counter = nullptr;
+	// Unfinished dependencies, plus one until the job is submitted
+	std::atomic<uint32_t> pending{ 1 };
+	// Jobs that depend on this one
+	std::vector<Job*> continuations;
+};
+
+/**
+ * Work stealing scheduler. Every worker owns a Chase-Lev deque, it pushes and pops jobs at one end while idle
+ * workers steal from the other. Threads that are not workers submit through a shared queue.
+ *
+ * The thread calling Init becomes worker 0 and runs jobs whenever it waits on a counter.
+ */
+class JobSystem
+{
+public:
+	// 0 uses one worker per hardware thread, the calling thread counts as one of them
+	static void Init(unsigned threadCount = 0);
+	// Runs any jobs still queued, call from the thread that called Init
+	static void Shutdown();
+	static bool IsInitialized();
+	// Workers including the thread that called Init, 1 when not initialized
+	static unsigned GetThreadCount();
+
+	/**
+	 * Create a job that calls 'function' without queuing it, 'counter' is incremented now and decremented when
+	 * the job finishes. Add dependencies then hand it to Submit.
+	 */
+	template<typename Function>
+	static Job* Create(Function&& function, JobCounter* counter = nullptr);
+	// 'job' runs after 'dependency' finishes, both must not have been submitted yet
+	static void AddDependency(Job* job, Job* dependency);
+	// Queue 'job' to run once its dependencies finish, runs it immediately when not initialized
+	static void Submit(Job* job);
+
+	template<typename Function>
+	static void Run(Function&& function, JobCounter* counter = nullptr)
+	{
+		Submit(Create(std::forward<Function>(function), counter));
+	}
+
+	// Run queued jobs on this thread until 'counter' reaches zero
+	static void Wait(const JobCounter& counter);
+
+	/**
+	 * Call function(begin, end) over ranges covering [0, count) in parallel and return once all are done.
+	 * Ranges are at least 'minGrain' long and there are a few per worker, so workers that finish early can steal
+	 * from the rest. The calling thread runs the first range.
+	 */
+	template<typename Function>
+	static void ParallelFor(uint32_t count, Function&& function, uint32_t minGrain = 1);
+
+private:
+	static uint32_t GetGrainSize(uint32_t count, uint32_t minGrain);
+	static void Enqueue(Job* job);
+	static void Execute(Job* job);
+	static bool RunOne();
+	static void WorkerMain(unsigned index);
+};
+
+template<typename Function>
+Job* JobSystem::Create(Function&& function, JobCounter* counter)
+{
+	using Stored = std::decay_t<Function>;
+	static_assert(sizeof(Stored) <= Job::StorageSize, "Job captures do not fit, capture a pointer to them instead");
+	static_assert(alignof(Stored) <= alignof(std::max_align_t), "Job captures are over aligned");
+
+	Job* job = new Job;
+	new (job->storage) Stored(std::forward<Function>(function));
+	job->invoke = [](void* storage) { (*static_cast<Stored*>(storage))(); };
+	job->destroy = [](void* storage) { static_cast<Stored*>(storage)->~Stored(); };
+	job->counter = counter;
+	if (counter)
+		counter->m_Value.fetch_add(1, std::memory_order_relaxed);
+	return job;
+}
+
+template<typename Function>
+void JobSystem::ParallelFor(uint32_t count, Function&& function, uint32_t minGrain)
+{
+	if (count == 0)
+		return;
+
+	const uint32_t grain = GetGrainSize(count, minGrain);
+	JobCounter counter;
+	for (uint32_t begin = grain; begin < count; begin += std::min(grain, count - begin))
+	{
+		const uint32_t end = begin + std::min(grain, count - begin);
+		Run([&function, begin, end] { function(begin, end); }, &counter);
+	}
+	function(0u, std::min(grain, count));
+	Wait(counter);
+}
+}
+
+#endif // JOBSYSTEM_HPP
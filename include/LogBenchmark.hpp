@@ -0,0 +1,18 @@
+#ifndef LOGBENCHMARK_HPP
+#define LOGBENCHMARK_HPP
+
+namespace atcp
+{
+class LogBenchmark
+{
+public:
+    /**
+     * Log from 1 and 8 producer threads into a file through a synchronous logger, through an AsyncLogSink and
+     * through the binary log, and report the p50 and p99 cost of each call and the text and binary file sizes.
+     * Writes LogBenchmark.txt and LogBenchmark.bin next to the log, binary builds append to Log.bin instead.
+     */
+    static int Run();
+};
+} // namespace atcp
+
+#endif // LOGBENCHMARK_HPP
@@ -8,38 +8,97 @@
 #include "Debug.hpp"
 
 namespace atcp {
+class AsyncLogSink;
+
+enum class LogOverflowPolicy {
+	// Wait for the background thread to make room
+	Block,
+	// Discard the message being logged
+	DropNewest,
+	// Discard the oldest queued message to make room
+	DropOldest
+};
+
+struct LoggerOptions {
+	// Format and write messages on a background thread, the logging thread only copies them into a queue
+	bool async = true;
+	size_t queueCapacity = 8192;
+	LogOverflowPolicy overflowPolicy = LogOverflowPolicy::Block;
+};
 
 class Logger
 {
 public:
-	static void Init(const std::string& name);
+	static void Init(const std::string& name, const LoggerOptions& options = LoggerOptions());
+	// Write out queued messages and stop the background thread
+	static void Shutdown();
 
 	inline static std::shared_ptr<spdlog::logger>& GetLogger() { return s_Logger; }
 
+	static uint64_t GetDroppedMessageCount();
+
 private:
 	static std::shared_ptr<spdlog::logger> s_Logger;
+	static std::shared_ptr<AsyncLogSink> s_AsyncSink;
 };
 }
 
+#ifdef ATCP_BINARY_LOG
+#include "BinaryLog.hpp"
+
+// Each expansion passes a distinct lambda type so the call site is registered with the binary log only once
+#define LOG_BINARY(level, ...)	atcp::BinaryLog::Log([]{}, level, __FILE__, __LINE__, __VA_ARGS__)
+
+// Fatal error only to be called when the application is about to crash, also written as text in case of a crash
+#define LOG_CRITICAL(...)	do { LOG_BINARY(spdlog::level::critical, __VA_ARGS__);\
+								atcp::Logger::GetLogger()->critical(__VA_ARGS__);\
+								DBG_OUTPUT("\n"); } while (0)
+
+// Serious issue and a failure of something important, also written as text in case of a crash
+#define LOG_ERROR(...)		do { LOG_BINARY(spdlog::level::err, __VA_ARGS__);\
+								atcp::Logger::GetLogger()->error(__VA_ARGS__);\
+								DBG_OUTPUT("\n"); } while (0)
+
+// Indicates you may have a problem or unusual situation
+#define LOG_WARN(...)		LOG_BINARY(spdlog::level::warn, __VA_ARGS__)
+
+// Normal application behaviour
+#define LOG_INFO(...)		LOG_BINARY(spdlog::level::info, __VA_ARGS__)
+
+#ifdef DEBUG
+// Diagnostic information to help the understand the flow of the engine
+#define LOG_DEBUG(...)		LOG_BINARY(spdlog::level::debug, __VA_ARGS__)
+
+// Very fine detailed Diagnostic information
+#define LOG_TRACE(...)		LOG_BINARY(spdlog::level::trace, __VA_ARGS__)
+
+#else
+// Nothing logged unless in debug mode
+#define LOG_DEBUG(...)
+// Nothing logged unless in debug mode
+#define LOG_TRACE(...)
+#endif // DEBUG
+
+#else
 // Fatal error only to be called when the application is about to crash
-#define LOG_CRITICAL(...)	atcp::Logger::GetLogger()->critical(__VA_ARGS__);\
-								DBG_OUTPUT("\n")\
+#define LOG_CRITICAL(...)	do { atcp::Logger::GetLogger()->critical(__VA_ARGS__);\
+								DBG_OUTPUT("\n"); } while (0)
 
 // Serious issue and a failure of something important
-#define LOG_ERROR(...)		atcp::Logger::GetLogger()->error(__VA_ARGS__);\
-								DBG_OUTPUT("\n")\
+#define LOG_ERROR(...)		do { atcp::Logger::GetLogger()->error(__VA_ARGS__);\
+								DBG_OUTPUT("\n"); } while (0)
 
 // Indicates you may have a problem or unusual situation
-#define LOG_WARN(...)		atcp::Logger::GetLogger()->warn(__VA_ARGS__);\
-								DBG_OUTPUT("\n")\
+#define LOG_WARN(...)		do { atcp::Logger::GetLogger()->warn(__VA_ARGS__);\
+								DBG_OUTPUT("\n"); } while (0)
 
 // Normal application behaviour
 #define LOG_INFO(...)		atcp::Logger::GetLogger()->info(__VA_ARGS__)
 
 #ifdef DEBUG
 // Diagnostic information to help the understand the flow of the engine
-#define LOG_DEBUG(...)		atcp::Logger::GetLogger()->debug(__VA_ARGS__);\
-								DBG_OUTPUT("\n")\
+#define LOG_DEBUG(...)		do { atcp::Logger::GetLogger()->debug(__VA_ARGS__);\
+								DBG_OUTPUT("\n"); } while (0)
 
 // Very fine detailed Diagnostic information
 #define LOG_TRACE(...)		atcp::Logger::GetLogger()->trace(__VA_ARGS__)
@@ -51,6 +110,8 @@ private:
 #define LOG_TRACE(...)
 #endif // DEBUG
 
+#endif // ATCP_BINARY_LOG
+
 #ifdef DEBUG
 #if defined(_MSC_VER)
 #define DEBUGBREAK() __debugbreak()
@@ -0,0 +1,39 @@
+#ifndef MAPPEDFILE_HPP
+#define MAPPEDFILE_HPP
+
+#include <cstddef>
+#include <filesystem>
+
+namespace atcp
+{
+/**
+ * Read only memory mapping of a whole file, unmapped on destruction.
+ */
+class MappedFile
+{
+public:
+    MappedFile() = default;
+    MappedFile(const MappedFile&) = delete;
+    MappedFile& operator=(const MappedFile&) = delete;
+    MappedFile(MappedFile&& other) noexcept;
+    MappedFile& operator=(MappedFile&& other) noexcept;
+    ~MappedFile();
+
+    bool Open(const std::filesystem::path& path);
+    void Close();
+
+    bool IsOpen() const { return m_Data != nullptr; }
+    const void* Data() const { return m_Data; }
+    size_t Size() const { return m_Size; }
+
+private:
+    const void* m_Data = nullptr;
+    size_t m_Size = 0;
+#ifdef _WIN32
+    void* m_FileHandle = nullptr;
+    void* m_MappingHandle = nullptr;
+#endif
+};
+} // namespace atcp
+
+#endif // MAPPEDFILE_HPP
@@ -0,0 +1,41 @@
+#ifndef MATHBATCH_HPP
+#define MATHBATCH_HPP
+
+#include <cstddef>
+#include <cstdint>
+
+#include "MathTypes.hpp"
+
+namespace atcp {
+enum class SimdLevel : uint8_t {
+	Scalar,
+	SSE,
+	AVX2,
+};
+
+/**
+ * Math over arrays with SSE or AVX2 kernels, picked from what the CPU supports the first time one is called.
+ * Targets without them, like the browser, use the scalar kernels. Results match the scalar kernels up to
+ * rounding, including the zeroed Vec3 padding.
+ */
+class MathBatch
+{
+public:
+	static SimdLevel GetSupportedLevel();
+	static SimdLevel GetLevel();
+	// Use a lower level than supported, to compare kernels, levels above the supported one are clamped to it
+	static void SetLevel(SimdLevel level);
+	static const char* GetLevelName(SimdLevel level);
+
+	// out[i] = matrix * (points[i], 1), 'out' may be 'points'
+	static void TransformPoints(const Mat4& matrix, const Vec3* points, Vec3* out, size_t count);
+	// out[i] = a[i] * b[i], 'out' may be 'a' or 'b'
+	static void MultiplyMatrices(const Mat4* a, const Mat4* b, Mat4* out, size_t count);
+	// Bounds of each box once transformed by its matrix, which must be affine, 'out' may be 'bounds'
+	static void TransformBounds(const Mat4* matrices, const Aabb* bounds, Aabb* out, size_t count);
+	// Bounds of the points, empty with min above max when there are none
+	static Aabb ComputeBounds(const Vec3* points, size_t count);
+};
+}
+
+#endif // MATHBATCH_HPP
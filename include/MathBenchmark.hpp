@@ -0,0 +1,17 @@
+#ifndef MATHBENCHMARK_HPP
+#define MATHBENCHMARK_HPP
+
+namespace atcp
+{
+class MathBenchmark
+{
+public:
+    /**
+     * Time every batch math kernel at each SIMD level the CPU supports against the scalar kernels and check they
+     * agree. Returns non-zero if a check failed. The supported level is selected again afterwards.
+     */
+    static int Run();
+};
+} // namespace atcp
+
+#endif // MATHBENCHMARK_HPP
@@ -0,0 +1,161 @@
+#ifndef MATHTYPES_HPP
+#define MATHTYPES_HPP
+
+#include <algorithm>
+#include <array>
+#include <cmath>
+
+namespace atcp
+{
+// Sizes and alignments follow std140, so values and arrays of them can be copied straight into GPU buffers
+
+struct Vec2 {
+    float x = 0.0f;
+    float y = 0.0f;
+};
+static_assert(sizeof(Vec2) == 8, "Must match a std140 vec2");
+
+// Padded to 16 bytes like the elements of a std140 vec3 array, batch kernels load and store the padding
+struct alignas(16) Vec3 {
+    float x = 0.0f;
+    float y = 0.0f;
+    float z = 0.0f;
+    float _pad = 0.0f;
+};
+static_assert(sizeof(Vec3) == 16, "Must match a std140 vec3 array element");
+
+struct alignas(16) Vec4 {
+    float x = 0.0f;
+    float y = 0.0f;
+    float z = 0.0f;
+    float w = 0.0f;
+};
+static_assert(sizeof(Vec4) == 16, "Must match a std140 vec4");
+
+// Column major like WGSL, std140 stores a mat3x3 as three vec4 columns
+struct alignas(16) Mat3 {
+    std::array<Vec3, 3> columns = { Vec3{ 1.0f, 0.0f, 0.0f }, Vec3{ 0.0f, 1.0f, 0.0f }, Vec3{ 0.0f, 0.0f, 1.0f } };
+};
+static_assert(sizeof(Mat3) == 48, "Must match a std140 mat3x3");
+
+struct alignas(16) Mat4 {
+    std::array<Vec4, 4> columns = { Vec4{ 1.0f, 0.0f, 0.0f, 0.0f }, Vec4{ 0.0f, 1.0f, 0.0f, 0.0f },
+        Vec4{ 0.0f, 0.0f, 1.0f, 0.0f }, Vec4{ 0.0f, 0.0f, 0.0f, 1.0f } };
+
+    static Mat4 Translation(const Vec3& translation);
+    static Mat4 Scale(const Vec3& scale);
+    // Counter clockwise around Z, in radians
+    static Mat4 RotationZ(float angle);
+};
+static_assert(sizeof(Mat4) == 64, "Must match a std140 mat4x4");
+
+struct Aabb {
+    Vec3 min;
+    Vec3 max;
+
+    bool IsEmpty() const { return min.x > max.x || min.y > max.y || min.z > max.z; }
+};
+static_assert(sizeof(Aabb) == 32, "Must be two std140 vec3s");
+
+inline Vec2 operator+(const Vec2& a, const Vec2& b) { return { a.x + b.x, a.y + b.y }; }
+inline Vec2 operator-(const Vec2& a, const Vec2& b) { return { a.x - b.x, a.y - b.y }; }
+inline Vec2 operator*(const Vec2& a, float s) { return { a.x * s, a.y * s }; }
+inline float Dot(const Vec2& a, const Vec2& b) { return a.x * b.x + a.y * b.y; }
+
+inline Vec3 operator+(const Vec3& a, const Vec3& b) { return { a.x + b.x, a.y + b.y, a.z + b.z }; }
+inline Vec3 operator-(const Vec3& a, const Vec3& b) { return { a.x - b.x, a.y - b.y, a.z - b.z }; }
+inline Vec3 operator*(const Vec3& a, float s) { return { a.x * s, a.y * s, a.z * s }; }
+inline float Dot(const Vec3& a, const Vec3& b) { return a.x * b.x + a.y * b.y + a.z * b.z; }
+inline Vec3 Cross(const Vec3& a, const Vec3& b)
+{
+    return { a.y * b.z - a.z * b.y, a.z * b.x - a.x * b.z, a.x * b.y - a.y * b.x };
+}
+inline Vec3 Min(const Vec3& a, const Vec3& b) { return { std::min(a.x, b.x), std::min(a.y, b.y), std::min(a.z, b.z) }; }
+inline Vec3 Max(const Vec3& a, const Vec3& b) { return { std::max(a.x, b.x), std::max(a.y, b.y), std::max(a.z, b.z) }; }
+
+inline Vec4 operator+(const Vec4& a, const Vec4& b) { return { a.x + b.x, a.y + b.y, a.z + b.z, a.w + b.w }; }
+inline Vec4 operator-(const Vec4& a, const Vec4& b) { return { a.x - b.x, a.y - b.y, a.z - b.z, a.w - b.w }; }
+inline Vec4 operator*(const Vec4& a, float s) { return { a.x * s, a.y * s, a.z * s, a.w * s }; }
+inline float Dot(const Vec4& a, const Vec4& b) { return a.x * b.x + a.y * b.y + a.z * b.z + a.w * b.w; }
+
+template<typename Vector>
+Vector Lerp(const Vector& a, const Vector& b, float t) { return a + (b - a) * t; }
+template<typename Vector>
+float Length(const Vector& v) { return std::sqrt(Dot(v, v)); }
+template<typename Vector>
+Vector Normalize(const Vector& v) { return v * (1.0f / Length(v)); }
+
+inline Vec3 operator*(const Mat3& m, const Vec3& v)
+{
+    return m.columns[0] * v.x + m.columns[1] * v.y + m.columns[2] * v.z;
+}
+
+inline Mat3 operator*(const Mat3& a, const Mat3& b)
+{
+    return { { a * b.columns[0], a * b.columns[1], a * b.columns[2] } };
+}
+
+inline Vec4 operator*(const Mat4& m, const Vec4& v)
+{
+    return m.columns[0] * v.x + m.columns[1] * v.y + m.columns[2] * v.z + m.columns[3] * v.w;
+}
+
+inline Mat4 operator*(const Mat4& a, const Mat4& b)
+{
+    return { { a * b.columns[0], a * b.columns[1], a * b.columns[2], a * b.columns[3] } };
+}
+
+inline Aabb Union(const Aabb& a, const Aabb& b) { return { Min(a.min, b.min), Max(a.max, b.max) }; }
+// Touching boxes overlap, so flat boxes still overlap the regions they lie in
+inline bool Overlaps(const Aabb& a, const Aabb& b)
+{
+    return a.min.x <= b.max.x && a.max.x >= b.min.x && a.min.y <= b.max.y && a.max.y >= b.min.y
+        && a.min.z <= b.max.z && a.max.z >= b.min.z;
+}
+inline bool Contains(const Aabb& outer, const Aabb& inner)
+{
+    return outer.min.x <= inner.min.x && outer.min.y <= inner.min.y && outer.min.z <= inner.min.z
+        && outer.max.x >= inner.max.x && outer.max.y >= inner.max.y && outer.max.z >= inner.max.z;
+}
+// Half the surface area, the cost metric of bounding volume hierarchies
+inline float HalfArea(const Aabb& box)
+{
+    const Vec3 size = box.max - box.min;
+    return size.x * size.y + size.y * size.z + size.z * size.x;
+}
+
+// Treats 'point' as having w = 1
+inline Vec3 TransformPoint(const Mat4& m, const Vec3& point)
+{
+    const Vec4 result = m * Vec4{ point.x, point.y, point.z, 1.0f };
+    return { result.x, result.y, result.z };
+}
+
+inline Mat4 Mat4::Translation(const Vec3& translation)
+{
+    Mat4 m;
+    m.columns[3] = { translation.x, translation.y, translation.z, 1.0f };
+    return m;
+}
+
+inline Mat4 Mat4::Scale(const Vec3& scale)
+{
+    Mat4 m;
+    m.columns[0].x = scale.x;
+    m.columns[1].y = scale.y;
+    m.columns[2].z = scale.z;
+    return m;
+}
+
+inline Mat4 Mat4::RotationZ(float angle)
+{
+    const float c = std::cos(angle);
+    const float s = std::sin(angle);
+    Mat4 m;
+    m.columns[0] = { c, s, 0.0f, 0.0f };
+    m.columns[1] = { -s, c, 0.0f, 0.0f };
+    return m;
+}
+} // namespace atcp
+
+#endif // MATHTYPES_HPP
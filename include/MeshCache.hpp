@@ -0,0 +1,97 @@
+#ifndef MESHCACHE_HPP
+#define MESHCACHE_HPP
+
+#include <cstdint>
+#include <filesystem>
+
+#include "MappedFile.hpp"
+#include "MeshLayout.hpp"
+
+namespace atcp
+{
+struct MeshImportOptions {
+    // Merge duplicate vertices, bit identical ones when weldTolerance is 0
+    bool weld = true;
+    float weldTolerance = 0.0f;
+    // Reorder triangles and vertices for GPU cache locality
+    bool optimize = true;
+    // Store vertices in the most compact formats within these absolute errors
+    bool quantize = true;
+    float positionErrorBound = 1.0f / 4096.0f;
+    float colourErrorBound = 1.0f / 255.0f;
+
+    uint32_t GetFlags() const;
+};
+
+/**
+ * On disk header of a binary mesh cache. The vertex and index blobs follow at the given offsets,
+ * each aligned to BlobAlignment so they can be copied straight into GPU buffers.
+ */
+struct MeshCacheHeader {
+    char magic[4];
+    uint32_t version;
+
+    // Identifies the text file the cache was imported from
+    uint64_t sourceSize;
+    int64_t sourceTime;
+    uint64_t sourceHash;
+
+    MeshLayout layout;
+    uint32_t vertexCount;
+    uint32_t indexCount;
+    uint32_t indexStride;
+    uint32_t importFlags;
+    float weldTolerance;
+    float positionErrorBound;
+    float colourErrorBound;
+    uint32_t _pad;
+    // Positions decode as position * scale + offset: { scale.x, scale.y, offset.x, offset.y }
+    float positionTransform[4];
+
+    uint64_t vertexOffset;
+    uint64_t vertexSize;
+    uint64_t indexOffset;
+    uint64_t indexSize;
+};
+static_assert(sizeof(MeshCacheHeader) % 8 == 0, "Header must keep the blobs 8 byte aligned");
+
+class MappedMesh
+{
+public:
+    bool IsValid() const { return m_Header != nullptr; }
+    const MeshCacheHeader& Header() const { return *m_Header; }
+    const void* VertexData() const { return Bytes() + m_Header->vertexOffset; }
+    const void* IndexData() const { return Bytes() + m_Header->indexOffset; }
+
+private:
+    const unsigned char* Bytes() const { return static_cast<const unsigned char*>(m_File.Data()); }
+
+    MappedFile m_File;
+    const MeshCacheHeader* m_Header = nullptr;
+
+    friend class MeshCache;
+};
+
+class MeshCache
+{
+public:
+    static constexpr uint32_t Version = 4;
+    static constexpr uint64_t BlobAlignment = 16;
+
+    /**
+     * Map the cache if it was imported from the current contents of sourcePath with the given options.
+     */
+    static bool Load(const std::filesystem::path& cachePath, const std::filesystem::path& sourcePath, const MeshImportOptions& options, MappedMesh& mesh);
+
+    /**
+     * Parse the text mesh at sourcePath and write it to cachePath.
+     */
+    static bool Import(const std::filesystem::path& sourcePath, const std::filesystem::path& cachePath, const MeshImportOptions& options);
+
+    static bool LoadOrImport(const std::filesystem::path& sourcePath, const std::filesystem::path& cachePath, const MeshImportOptions& options, MappedMesh& mesh);
+
+    static bool Write(const std::filesystem::path& cachePath, MeshCacheHeader header, const void* vertexData, const void* indexData);
+};
+} // namespace atcp
+
+#endif // MESHCACHE_HPP
@@ -0,0 +1,71 @@
+#ifndef MESHLAYOUT_HPP
+#define MESHLAYOUT_HPP
+
+#include <cstdint>
+
+namespace atcp
+{
+// Stored in mesh cache files, only append new values
+enum class VertexAttributeFormat : uint32_t {
+    Float32x2 = 0,
+    Float32x3 = 1,
+    Snorm16x2 = 2,
+    Float16x2 = 3,
+    Unorm8x4 = 4,
+};
+
+inline uint32_t GetFormatSize(VertexAttributeFormat format)
+{
+    switch (format) {
+    case VertexAttributeFormat::Float32x2: return 2 * sizeof(float);
+    case VertexAttributeFormat::Float32x3: return 3 * sizeof(float);
+    case VertexAttributeFormat::Snorm16x2: return 2 * sizeof(int16_t);
+    case VertexAttributeFormat::Float16x2: return 2 * sizeof(uint16_t);
+    case VertexAttributeFormat::Unorm8x4: return 4 * sizeof(uint8_t);
+    }
+    return 0;
+}
+
+struct VertexAttributeDesc {
+    uint32_t shaderLocation = 0;
+    VertexAttributeFormat format = VertexAttributeFormat::Float32x2;
+    uint32_t offset = 0;
+};
+
+struct MeshLayout {
+    static constexpr uint32_t MaxAttributes = 4;
+
+    uint32_t stride = 0;
+    uint32_t attributeCount = 0;
+    VertexAttributeDesc attributes[MaxAttributes] = {};
+
+    /**
+     * Layout produced by SimpleMeshParser: vec2 position followed by rgb colour.
+     */
+    static MeshLayout PositionColour()
+    {
+        MeshLayout layout;
+        layout.attributeCount = 2;
+        layout.attributes[0] = { 0, VertexAttributeFormat::Float32x2, 0 };
+        layout.attributes[1] = { 1, VertexAttributeFormat::Float32x3, 2 * sizeof(float) };
+        layout.stride = 5 * sizeof(float);
+        return layout;
+    }
+
+    bool operator==(const MeshLayout& other) const
+    {
+        if (stride != other.stride || attributeCount != other.attributeCount)
+            return false;
+        for (uint32_t i = 0; i < attributeCount; ++i) {
+            if (attributes[i].shaderLocation != other.attributes[i].shaderLocation
+                || attributes[i].format != other.attributes[i].format
+                || attributes[i].offset != other.attributes[i].offset)
+                return false;
+        }
+        return true;
+    }
+    bool operator!=(const MeshLayout& other) const { return !(*this == other); }
+};
+} // namespace atcp
+
+#endif // MESHLAYOUT_HPP
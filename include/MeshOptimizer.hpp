@@ -0,0 +1,53 @@
+#ifndef MESHOPTIMIZER_HPP
+#define MESHOPTIMIZER_HPP
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+namespace atcp
+{
+struct VertexCacheStats {
+    // Average cache miss ratio, vertex shader invocations per triangle, 0.5 is ideal for grids
+    float acmr = 0.0f;
+    // Average transform to vertex ratio, 1.0 is ideal
+    float atvr = 0.0f;
+};
+
+class MeshOptimizer
+{
+public:
+    static constexpr uint32_t DefaultCacheSize = 16;
+
+    /**
+     * Simulate a FIFO post-transform cache over a triangle list.
+     */
+    static VertexCacheStats AnalyzeVertexCache(const uint32_t* indices, size_t indexCount, size_t vertexCount, uint32_t cacheSize = DefaultCacheSize);
+
+    /**
+     * Reorder triangles for post-transform cache locality using Tipsify (Sander et al. 2007), linear in the index count.
+     * 'destination' must hold indexCount indices and may not alias 'indices'.
+     */
+    static void OptimizeVertexCache(uint32_t* destination, const uint32_t* indices, size_t indexCount, size_t vertexCount, uint32_t cacheSize = DefaultCacheSize);
+
+    /**
+     * Reorder vertices into the order they are first referenced and remap the indices in place.
+     * Unreferenced vertices are dropped, returns the new vertex count.
+     */
+    static size_t OptimizeVertexFetch(void* destination, uint32_t* indices, size_t indexCount, const void* vertices, size_t vertexCount, size_t vertexStride);
+
+    /**
+     * Merge duplicate vertices of interleaved float vertices and rewrite the indices to match.
+     * A tolerance of 0 merges bit identical vertices, otherwise vertices whose components all differ by at most
+     * 'tolerance' are merged into the first one seen. Returns the number of vertices removed.
+     */
+    static size_t WeldVertices(std::vector<float>& vertexData, std::vector<uint32_t>& indexData, size_t vertexComponents, float tolerance = 0.0f);
+
+    /**
+     * Run the cache and fetch passes over interleaved float vertices and log the cache statistics before and after.
+     */
+    static void Optimize(std::vector<float>& vertexData, std::vector<uint32_t>& indexData, size_t vertexComponents);
+};
+} // namespace atcp
+
+#endif // MESHOPTIMIZER_HPP
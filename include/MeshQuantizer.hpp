@@ -0,0 +1,38 @@
+#ifndef MESHQUANTIZER_HPP
+#define MESHQUANTIZER_HPP
+
+#include <array>
+#include <cstdint>
+#include <vector>
+
+#include "MeshLayout.hpp"
+
+namespace atcp
+{
+struct QuantizedMesh {
+    MeshLayout layout;
+    // Positions decode as position * scale + offset: { scale.x, scale.y, offset.x, offset.y }
+    std::array<float, 4> positionTransform = { 1.0f, 1.0f, 0.0f, 0.0f };
+    std::vector<unsigned char> vertexData;
+};
+
+class MeshQuantizer
+{
+public:
+    static uint16_t FloatToHalf(float value);
+    static float HalfToFloat(uint16_t value);
+
+    /**
+     * Encode position/colour float vertices into the most compact formats whose round trip error stays within the
+     * bounds: Snorm16x2 or Float16x2 positions and Unorm8x4 colours, falling back to 32-bit floats.
+     */
+    static QuantizedMesh Quantize(const std::vector<float>& vertexData, float positionErrorBound, float colourErrorBound);
+
+    /**
+     * Copy position/colour float vertices into the unquantized PositionColour layout.
+     */
+    static QuantizedMesh Passthrough(const std::vector<float>& vertexData);
+};
+} // namespace atcp
+
+#endif // MESHQUANTIZER_HPP
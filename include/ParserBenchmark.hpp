@@ -0,0 +1,22 @@
+#ifndef PARSERBENCHMARK_HPP
+#define PARSERBENCHMARK_HPP
+
+namespace atcp
+{
+class ParserBenchmark
+{
+public:
+    /**
+     * Generate about 100 MB of mesh text and parse it with SimpleMeshParser on one thread and across the job
+     * system, against the line by line stream parser it replaced. Returns non-zero if the outputs differ.
+     */
+    static int Run();
+    /**
+     * Parse meshes split into several chunk counts, with LF and CRLF line endings and splits around the [indices]
+     * header, and compare them with the same text parsed as one chunk. Returns non-zero if any value differs.
+     */
+    static int Check();
+};
+} // namespace atcp
+
+#endif // PARSERBENCHMARK_HPP
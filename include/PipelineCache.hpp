@@ -0,0 +1,124 @@
+#ifndef PIPELINECACHE_HPP
+#define PIPELINECACHE_HPP
+
+#include <webgpu/webgpu.hpp>
+#include <cstdint>
+#include <filesystem>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+#include "GpuResources.hpp"
+#include "MeshLayout.hpp"
+
+namespace atcp {
+/**
+ * Everything that distinguishes one render pipeline from another.
+ */
+struct RenderPipelineState {
+	// Content hash returned by PipelineCache::GetShaderModule
+	uint64_t shaderHash = 0;
+	std::string vertexEntryPoint = "vs_main";
+	std::string fragmentEntryPoint = "fs_main";
+
+	MeshLayout vertexLayout;
+	wgpu::PrimitiveTopology topology = wgpu::PrimitiveTopology::TriangleList;
+	wgpu::CullMode cullMode = wgpu::CullMode::None;
+
+	wgpu::TextureFormat colourFormat = wgpu::TextureFormat::Undefined;
+	uint32_t sampleCount = 1;
+	bool blend = true;
+	wgpu::BlendFactor srcFactor = wgpu::BlendFactor::SrcAlpha;
+	wgpu::BlendFactor dstFactor = wgpu::BlendFactor::OneMinusSrcAlpha;
+	wgpu::BlendOperation blendOperation = wgpu::BlendOperation::Add;
+
+	// Must come from PipelineCache::GetBindGroupLayout so equal layouts share a handle
+	wgpu::BindGroupLayout bindGroupLayout = nullptr;
+
+	uint64_t Hash() const;
+	// Blend factors are only compared when blending is on, like Hash
+	bool operator==(const RenderPipelineState& other) const;
+	bool operator!=(const RenderPipelineState& other) const { return !(*this == other); }
+};
+
+struct PipelineCacheStats {
+	uint64_t shaderHits = 0;
+	uint64_t shaderMisses = 0;
+	uint64_t pipelineHits = 0;
+	uint64_t pipelineMisses = 0;
+	// Seconds spent creating objects on misses, summed over every thread
+	double shaderCreateTime = 0.0;
+	double pipelineCreateTime = 0.0;
+};
+
+/**
+ * Creates shader modules, layouts and render pipelines once and hands out the existing object for any
+ * later request with the same state. Shader modules and pipelines are owned by GpuResources, Clear hands
+ * them back for deferred destruction. Safe to call from several threads at once.
+ */
+class PipelineCache
+{
+public:
+	PipelineCache() = default;
+	PipelineCache(const PipelineCache&) = delete;
+	PipelineCache& operator=(const PipelineCache&) = delete;
+	~PipelineCache();
+
+	void Init(wgpu::Device device, GpuResources& resources);
+	void Clear();
+
+	/**
+	 * Load a WGSL file, modules are keyed by the hash of their source so identical files compile once.
+	 */
+	wgpu::ShaderModule GetShaderModule(const std::filesystem::path& path, uint64_t* shaderHash = nullptr);
+
+	// Every binding field of the entries is compared, chained structs are ignored
+	wgpu::BindGroupLayout GetBindGroupLayout(const wgpu::BindGroupLayoutEntry* entries, size_t entryCount);
+	wgpu::RenderPipeline GetRenderPipeline(const RenderPipelineState& state);
+
+	/**
+	 * Create every pipeline in 'states' as parallel jobs.
+	 * Shader modules and bind group layouts the states refer to must already be in the cache.
+	 */
+	void Prewarm(const std::vector<RenderPipelineState>& states);
+
+	PipelineCacheStats GetStats() const;
+	void LogStats() const;
+
+private:
+	// Maps hash their keys to 64 bits and compare them in full, so a collision never hands out the wrong object
+	struct StateHasher {
+		size_t operator()(const RenderPipelineState& state) const { return static_cast<size_t>(state.Hash()); }
+	};
+	struct BindGroupLayoutKey {
+		std::vector<wgpu::BindGroupLayoutEntry> entries;
+		uint64_t hash = 0;
+
+		bool operator==(const BindGroupLayoutKey& other) const;
+	};
+	struct BindGroupLayoutKeyHasher {
+		size_t operator()(const BindGroupLayoutKey& key) const { return static_cast<size_t>(key.hash); }
+	};
+	// Pipeline states refer to modules by the hash of their source, the source is kept to catch collisions
+	struct ShaderModuleEntry {
+		std::string source;
+		ShaderModuleHandle module;
+	};
+
+	wgpu::PipelineLayout GetPipelineLayout(wgpu::BindGroupLayout bindGroupLayout);
+	wgpu::RenderPipeline CreateRenderPipeline(const RenderPipelineState& state, wgpu::ShaderModule shaderModule, wgpu::PipelineLayout layout);
+
+	wgpu::Device m_Device = nullptr;
+	GpuResources* m_Resources = nullptr;
+
+	mutable std::mutex m_Mutex;
+	std::unordered_map<uint64_t, ShaderModuleEntry> m_ShaderModules;
+	std::unordered_map<BindGroupLayoutKey, wgpu::BindGroupLayout, BindGroupLayoutKeyHasher> m_BindGroupLayouts;
+	std::unordered_map<WGPUBindGroupLayout, wgpu::PipelineLayout> m_PipelineLayouts;
+	std::unordered_map<RenderPipelineState, RenderPipelineHandle, StateHasher> m_RenderPipelines;
+	PipelineCacheStats m_Stats;
+};
+}
+
+#endif // PIPELINECACHE_HPP
@@ -0,0 +1,96 @@
+#ifndef PROFILER_HPP
+#define PROFILER_HPP
+
+#include <chrono>
+#include <cstdint>
+#include <filesystem>
+
+#if defined(_M_X64) || defined(_M_IX86) || defined(__x86_64__) || defined(__i386__)
+#define ATCP_PROFILE_TSC
+#ifdef _MSC_VER
+#include <intrin.h>
+#else
+#include <x86intrin.h>
+#endif
+#endif
+
+namespace atcp {
+/**
+ * CPU profiler writing Chrome trace JSON, open the file in Perfetto or chrome://tracing.
+ * Each thread records into its own buffer without locking, Flush streams the completed events to the file.
+ */
+class Profiler
+{
+public:
+	static bool BeginSession(const std::filesystem::path& path);
+	// Write every event recorded since the last flush
+	static void Flush();
+	static void EndSession();
+	static bool IsActive();
+
+	// 'name' must outlive the session, usually a string literal
+	static void SetThreadName(const char* name);
+	static void RecordScope(const char* name, uint64_t start, uint64_t end);
+	static void RecordCounter(const char* name, double value);
+
+	/**
+	 * Timestamp in profiler ticks, the time stamp counter where available since reading the system clock costs
+	 * more than the rest of recording a scope. Ticks are converted to time when the trace is written.
+	 */
+	static uint64_t Now()
+	{
+#ifdef ATCP_PROFILE_TSC
+		return __rdtsc();
+#else
+		return static_cast<uint64_t>(std::chrono::duration_cast<std::chrono::nanoseconds>(
+			std::chrono::steady_clock::now().time_since_epoch()).count());
+#endif
+	}
+};
+
+class ProfileScope
+{
+public:
+	explicit ProfileScope(const char* name)
+		: m_Name(Profiler::IsActive() ? name : nullptr), m_Start(m_Name ? Profiler::Now() : 0)
+	{
+	}
+	~ProfileScope()
+	{
+		if (m_Name)
+			Profiler::RecordScope(m_Name, m_Start, Profiler::Now());
+	}
+
+	ProfileScope(const ProfileScope&) = delete;
+	ProfileScope& operator=(const ProfileScope&) = delete;
+
+private:
+	const char* m_Name;
+	uint64_t m_Start;
+};
+}
+
+#ifdef ATCP_PROFILE
+#define PROFILE_CONCAT_IMPL(a, b) a##b
+#define PROFILE_CONCAT(a, b) PROFILE_CONCAT_IMPL(a, b)
+
+#define PROFILE_BEGIN_SESSION(path)		atcp::Profiler::BeginSession(path)
+#define PROFILE_END_SESSION()			atcp::Profiler::EndSession()
+#define PROFILE_FLUSH()					atcp::Profiler::Flush()
+#define PROFILE_THREAD(name)			atcp::Profiler::SetThreadName(name)
+// Time from here to the end of the enclosing block
+#define PROFILE_SCOPE(name)				atcp::ProfileScope PROFILE_CONCAT(profileScope, __LINE__)(name)
+#define PROFILE_FUNCTION()				PROFILE_SCOPE(__func__)
+#define PROFILE_COUNTER(name, value)	atcp::Profiler::RecordCounter(name, static_cast<double>(value))
+#else
+// Nothing recorded unless profiling is enabled
+#define PROFILE_BEGIN_SESSION(path)
+#define PROFILE_END_SESSION()
+#define PROFILE_FLUSH()
+#define PROFILE_THREAD(name)
+#define PROFILE_SCOPE(name)
+#define PROFILE_FUNCTION()
+#define PROFILE_COUNTER(name, value)
+#endif // ATCP_PROFILE
+
+#endif // PROFILER_HPP
@@ -0,0 +1,127 @@
+#ifndef RESOURCEPOOL_HPP
+#define RESOURCEPOOL_HPP
+
+#include <cstdint>
+#include <utility>
+#include <vector>
+
+namespace atcp {
+/**
+ * Slot index plus the generation the slot had when the handle was made. A handle to a removed value stays
+ * invalid even once its slot is reused, the tag keeps handles of different pools apart.
+ */
+template<typename Tag>
+struct Handle {
+	static constexpr uint32_t InvalidIndex = UINT32_MAX;
+	uint32_t index = InvalidIndex;
+	uint32_t generation = 0;
+
+	bool IsValid() const { return index != InvalidIndex; }
+	bool operator==(const Handle& other) const { return index == other.index && generation == other.generation; }
+	bool operator!=(const Handle& other) const { return !(*this == other); }
+};
+
+/**
+ * Values packed contiguously and addressed through generational handles. Removing a value moves the last one
+ * into its place, so iterating over Values() never skips holes.
+ */
+template<typename Value, typename HandleType>
+class ResourcePool
+{
+public:
+	HandleType Add(Value value)
+	{
+		uint32_t slot;
+		if (!m_FreeSlots.empty())
+		{
+			slot = m_FreeSlots.back();
+			m_FreeSlots.pop_back();
+		}
+		else
+		{
+			slot = static_cast<uint32_t>(m_Slots.size());
+			m_Slots.emplace_back();
+		}
+
+		m_Slots[slot].denseIndex = static_cast<uint32_t>(m_Values.size());
+		m_Values.push_back(std::move(value));
+		m_DenseSlots.push_back(slot);
+		return HandleType{ slot, m_Slots[slot].generation };
+	}
+
+	// Null when the handle is invalid or its value has been removed
+	Value* Get(HandleType handle)
+	{
+		return IsLive(handle) ? &m_Values[m_Slots[handle.index].denseIndex] : nullptr;
+	}
+
+	const Value* Get(HandleType handle) const
+	{
+		return IsLive(handle) ? &m_Values[m_Slots[handle.index].denseIndex] : nullptr;
+	}
+
+	bool Remove(HandleType handle, Value& removed)
+	{
+		if (!IsLive(handle))
+			return false;
+
+		Slot& slot = m_Slots[handle.index];
+		const uint32_t denseIndex = slot.denseIndex;
+		removed = std::move(m_Values[denseIndex]);
+
+		const uint32_t lastIndex = static_cast<uint32_t>(m_Values.size() - 1);
+		if (denseIndex != lastIndex)
+		{
+			m_Values[denseIndex] = std::move(m_Values[lastIndex]);
+			m_DenseSlots[denseIndex] = m_DenseSlots[lastIndex];
+			m_Slots[m_DenseSlots[denseIndex]].denseIndex = denseIndex;
+		}
+		m_Values.pop_back();
+		m_DenseSlots.pop_back();
+
+		++slot.generation;
+		slot.denseIndex = FreeIndex;
+		m_FreeSlots.push_back(handle.index);
+		return true;
+	}
+
+	// Removes every value, handles made before stay invalid
+	void Clear()
+	{
+		for (uint32_t slot : m_DenseSlots)
+		{
+			++m_Slots[slot].generation;
+			m_Slots[slot].denseIndex = FreeIndex;
+			m_FreeSlots.push_back(slot);
+		}
+		m_Values.clear();
+		m_DenseSlots.clear();
+	}
+
+	std::vector<Value>& Values() { return m_Values; }
+	const std::vector<Value>& Values() const { return m_Values; }
+	uint32_t Size() const { return static_cast<uint32_t>(m_Values.size()); }
+
+private:
+	static constexpr uint32_t FreeIndex = UINT32_MAX;
+
+	struct Slot {
+		uint32_t generation = 0;
+		uint32_t denseIndex = FreeIndex;
+	};
+
+	bool IsLive(HandleType handle) const
+	{
+		return handle.index < m_Slots.size() && m_Slots[handle.index].generation == handle.generation
+			&& m_Slots[handle.index].denseIndex != FreeIndex;
+	}
+
+	std::vector<Slot> m_Slots;
+	std::vector<uint32_t> m_FreeSlots;
+	std::vector<Value> m_Values;
+	// Slot of each value, to fix up the slot of the value moved by Remove
+	std::vector<uint32_t> m_DenseSlots;
+};
+}
+
+#endif // RESOURCEPOOL_HPP
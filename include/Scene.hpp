@@ -0,0 +1,201 @@
+#ifndef SCENE_HPP
+#define SCENE_HPP
+
+#include <algorithm>
+#include <array>
+#include <cstdint>
+#include <memory>
+#include <vector>
+
+#include "Components.hpp"
+#include "JobSystem.hpp"
+#include "ResourcePool.hpp"
+
+namespace atcp {
+using Entity = Handle<struct EntityTag>;
+
+/**
+ * Entities grouped by archetype, the set of components they have. Each archetype stores its entities in chunks of
+ * ChunkCapacity with one contiguous array per component, so a query walks only the arrays it asks for. Every chunk
+ * of an archetype is full except the last: destroying an entity moves the archetype's last one into its place.
+ *
+ * Queries hand the function whole chunks as arrays, function(first, count, Components*...) where 'first' counts the
+ * matching entities before the chunk. Creating or destroying entities while a query runs is not allowed.
+ */
+class Scene
+{
+public:
+	static constexpr uint32_t ChunkCapacity = 1024;
+
+	Scene() = default;
+	Scene(const Scene&) = delete;
+	Scene& operator=(const Scene&) = delete;
+
+	/**
+	 * Create 'count' entities with exactly 'Components'. init(first, count, Components*...) is called for each run
+	 * of new entities sharing a chunk, with 'first' counting from the start of the batch, and must write every
+	 * component. The handles are appended to 'entities' when given.
+	 */
+	template<typename... Components, typename Function>
+	void Create(uint32_t count, Function&& init, std::vector<Entity>* entities = nullptr);
+	// Invalid and already destroyed entities are skipped
+	void Destroy(const Entity* entities, size_t count);
+	void Destroy(Entity entity) { Destroy(&entity, 1); }
+	void Clear();
+
+	bool IsAlive(Entity entity) const { return m_Entities.Get(entity) != nullptr; }
+	// Null when the entity is not alive or does not have the component
+	template<typename Component>
+	Component* Get(Entity entity);
+
+	template<typename... Components, typename Function>
+	void Each(Function&& function);
+	// Like Each with chunks spread over the job system, returns once every chunk is done
+	template<typename... Components, typename Function>
+	void ParallelEach(Function&& function);
+	template<typename... Components>
+	uint32_t Count() const;
+
+	uint32_t GetEntityCount() const { return m_Entities.Size(); }
+	uint32_t GetChunkCount() const;
+	// Incremented whenever entities are created or destroyed
+	uint64_t GetVersion() const { return m_Version; }
+
+private:
+	struct alignas(64) CacheLine {
+		unsigned char bytes[64];
+	};
+
+	struct Chunk {
+		std::unique_ptr<CacheLine[]> data;
+		uint32_t count = 0;
+		std::array<Entity, ChunkCapacity> entities;
+	};
+
+	struct Archetype {
+		ComponentMask mask = 0;
+		// Start of each component's array in a chunk's data, each on its own cache lines
+		std::array<uint32_t, ComponentCount> offsets{};
+		uint32_t chunkLines = 0;
+		std::vector<std::unique_ptr<Chunk>> chunks;
+		uint32_t entityCount = 0;
+	};
+
+	struct Location {
+		uint32_t archetype;
+		uint32_t chunk;
+		uint32_t row;
+	};
+
+	// A chunk matched by a query and the number of matching entities before it
+	struct ChunkRef {
+		Archetype* archetype;
+		Chunk* chunk;
+		uint32_t first;
+	};
+
+	uint32_t GetArchetype(ComponentMask mask);
+	// Index of the archetype's last chunk, adding one when it is full
+	uint32_t GetChunkWithSpace(Archetype& archetype);
+	std::vector<ChunkRef> GetChunks(ComponentMask mask);
+
+	template<typename Component>
+	static Component* GetArray(const Archetype& archetype, Chunk& chunk)
+	{
+		const uint32_t offset = archetype.offsets[static_cast<uint32_t>(ComponentInfo<Component>::Type)];
+		return reinterpret_cast<Component*>(reinterpret_cast<unsigned char*>(chunk.data.get()) + offset);
+	}
+
+	std::vector<Archetype> m_Archetypes;
+	ResourcePool<Location, Entity> m_Entities;
+	uint64_t m_Version = 0;
+};
+
+template<typename... Components, typename Function>
+void Scene::Create(uint32_t count, Function&& init, std::vector<Entity>* entities)
+{
+	const uint32_t archetypeIndex = GetArchetype(MaskOf<Components...>());
+	Archetype& archetype = m_Archetypes[archetypeIndex];
+	if (entities)
+		entities->reserve(entities->size() + count);
+
+	for (uint32_t created = 0; created < count;)
+	{
+		const uint32_t chunkIndex = GetChunkWithSpace(archetype);
+		Chunk& chunk = *archetype.chunks[chunkIndex];
+		const uint32_t row = chunk.count;
+		const uint32_t runCount = std::min(count - created, ChunkCapacity - row);
+		for (uint32_t i = 0; i < runCount; ++i)
+		{
+			const Entity entity = m_Entities.Add({ archetypeIndex, chunkIndex, row + i });
+			chunk.entities[row + i] = entity;
+			if (entities)
+				entities->push_back(entity);
+		}
+		chunk.count += runCount;
+		archetype.entityCount += runCount;
+
+		init(created, runCount, (GetArray<Components>(archetype, chunk) + row)...);
+		created += runCount;
+	}
+	++m_Version;
+}
+
+template<typename Component>
+Component* Scene::Get(Entity entity)
+{
+	const Location* location = m_Entities.Get(entity);
+	if (!location)
+		return nullptr;
+
+	const Archetype& archetype = m_Archetypes[location->archetype];
+	if (!(archetype.mask & MaskOf<Component>()))
+		return nullptr;
+	return GetArray<Component>(archetype, *archetype.chunks[location->chunk]) + location->row;
+}
+
+template<typename... Components, typename Function>
+void Scene::Each(Function&& function)
+{
+	constexpr ComponentMask mask = MaskOf<Components...>();
+	uint32_t first = 0;
+	for (Archetype& archetype : m_Archetypes)
+	{
+		if ((archetype.mask & mask) != mask)
+			continue;
+		for (const std::unique_ptr<Chunk>& chunk : archetype.chunks)
+		{
+			function(first, chunk->count, GetArray<Components>(archetype, *chunk)...);
+			first += chunk->count;
+		}
+	}
+}
+
+template<typename... Components, typename Function>
+void Scene::ParallelEach(Function&& function)
+{
+	const std::vector<ChunkRef> chunks = GetChunks(MaskOf<Components...>());
+	JobSystem::ParallelFor(static_cast<uint32_t>(chunks.size()), [&chunks, &function](uint32_t begin, uint32_t end) {
+		for (uint32_t i = begin; i < end; ++i)
+		{
+			const ChunkRef& ref = chunks[i];
+			function(ref.first, ref.chunk->count, GetArray<Components>(*ref.archetype, *ref.chunk)...);
+		}
+	});
+}
+
+template<typename... Components>
+uint32_t Scene::Count() const
+{
+	constexpr ComponentMask mask = MaskOf<Components...>();
+	uint32_t count = 0;
+	for (const Archetype& archetype : m_Archetypes)
+	{
+		if ((archetype.mask & mask) == mask)
+			count += archetype.entityCount;
+	}
+	return count;
+}
+}
+
+#endif // SCENE_HPP
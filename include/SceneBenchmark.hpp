@@ -0,0 +1,17 @@
+#ifndef SCENEBENCHMARK_HPP
+#define SCENEBENCHMARK_HPP
+
+namespace atcp
+{
+class SceneBenchmark
+{
+public:
+    /**
+     * Time creating, iterating, updating and destroying a million entities in the scene, against the same update
+     * over an array of structs, and check both give the same result. Returns non-zero if a check failed.
+     */
+    static int Run();
+};
+} // namespace atcp
+
+#endif // SCENEBENCHMARK_HPP
@@ -1,6 +1,7 @@
+#ifndef SIMPLEMESHPARSER_HPP
+#define SIMPLEMESHPARSER_HPP
+
 #include <filesystem>
-#include <fstream>
-#include <sstream>
 #include <string>
 #include <vector>
 
@@ -9,6 +10,20 @@ namespace atcp
 class SimpleMeshParser
 {
 public:
-    static bool LoadGeometry(const std::filesystem::path& path, std::vector<float>& vertexData, std::vector<uint16_t>& indexData);
+    static constexpr size_t VertexComponents = 5;
+    static constexpr size_t IndexComponents = 3;
+    // Inputs smaller than this per thread are not worth splitting
+    static constexpr size_t MinParallelChunkSize = 1 << 20;
+
+    static bool LoadGeometry(const std::filesystem::path& path, std::vector<float>& vertexData, std::vector<uint32_t>& indexData);
+    /**
+     * Parse a mesh held in memory. Large inputs are split into up to 'threadCount' newline aligned chunks parsed as
+     * jobs (0 uses one per job system thread), the output is identical to parsing on one thread.
+     */
+    static bool ParseGeometry(const char* begin, const char* end, std::vector<float>& vertexData, std::vector<uint32_t>& indexData, const std::string& sourceName = "<memory>", unsigned threadCount = 0);
+
+    static bool ReadFile(const std::filesystem::path& path, std::string& contents);
 };
 } // namespace atcp
+
+#endif // SIMPLEMESHPARSER_HPP
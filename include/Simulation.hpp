@@ -0,0 +1,89 @@
+#ifndef SIMULATION_HPP
+#define SIMULATION_HPP
+
+#include <array>
+#include <condition_variable>
+#include <cstdint>
+#include <mutex>
+#include <thread>
+
+namespace atcp {
+// Advanced only by whole fixed steps. Only the clock for now, the scene is animated from the interpolated
+// FrameState::time when rendering and culling, so the steps themselves are cheap
+struct SimulationState {
+	double time = 0.0;
+	uint64_t step = 0;
+};
+
+// What the renderer needs from the simulation, interpolated between the last two steps
+struct FrameState {
+	float time = 0.0f;
+	// Fixed steps run to produce this frame
+	uint32_t steps = 0;
+};
+
+/**
+ * Runs the simulation at a fixed rate regardless of the frame rate. Real time is accumulated and consumed in whole
+ * steps, the remainder blends the last two states so motion stays smooth between steps.
+ *
+ * When pipelined, the steps for the next frame run on a worker thread while the caller renders the current one,
+ * frame states are double buffered so the renderer reads one while the worker writes the other.
+ */
+class Simulation
+{
+public:
+	Simulation() = default;
+	Simulation(const Simulation&) = delete;
+	Simulation& operator=(const Simulation&) = delete;
+	~Simulation();
+
+	/**
+	 * 'maxStepsPerFrame' bounds the work done for one frame, time beyond it is dropped so a slow frame does not
+	 * make every following frame slower as well.
+	 */
+	void Init(double stepInterval, uint32_t maxStepsPerFrame, bool pipelined);
+	void Shutdown();
+
+	/**
+	 * Add 'elapsed' seconds of real time and return the state to render, valid until the next call.
+	 * When pipelined the state returned was simulated during the previous call so it lags one frame behind.
+	 */
+	const FrameState& Advance(double elapsed);
+
+	bool IsPipelined() const { return m_Thread.joinable(); }
+
+	// Statistics below are written by the worker, read them after Shutdown when pipelined
+	uint64_t GetStepCount() const { return m_Current.step; }
+	// Frames that hit the step limit and dropped time
+	uint64_t GetClampedFrameCount() const { return m_ClampedFrames; }
+	// Seconds the caller spent waiting for the worker to finish a frame
+	double GetWaitTime() const { return m_WaitTime; }
+
+private:
+	FrameState Step(double elapsed);
+	// Per step work goes here, it runs on the worker when pipelined so it must not touch render state
+	static void Update(SimulationState& state, double deltaTime);
+	void WorkerMain();
+
+	double m_StepInterval = 0.01;
+	uint32_t m_MaxStepsPerFrame = 8;
+	double m_Accumulator = 0.0;
+	SimulationState m_Previous;
+	SimulationState m_Current;
+	uint64_t m_ClampedFrames = 0;
+
+	std::array<FrameState, 2> m_Frames;
+	// Slot the worker is writing, or last wrote when it is idle
+	uint32_t m_WriteIndex = 0;
+	double m_RequestedElapsed = 0.0;
+	bool m_Requested = false;
+	bool m_Stop = false;
+	double m_WaitTime = 0.0;
+
+	std::thread m_Thread;
+	std::mutex m_Mutex;
+	std::condition_variable m_Condition;
+};
+}
+
+#endif // SIMULATION_HPP
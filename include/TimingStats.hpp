@@ -0,0 +1,33 @@
+#ifndef TIMINGSTATS_HPP
+#define TIMINGSTATS_HPP
+
+#include <cstddef>
+#include <vector>
+
+namespace atcp
+{
+/**
+ * Collects durations in seconds and reports their distribution.
+ */
+class TimingStats
+{
+public:
+    void Reserve(size_t count) { m_Samples.reserve(count); }
+    void Add(double seconds);
+    void Clear();
+
+    size_t GetCount() const { return m_Samples.size(); }
+    double GetAverage() const;
+    // Nearest rank percentile, 'percentile' in [0, 100]
+    double GetPercentile(double percentile);
+
+    // Average, min, p50, p95, p99 and max in milliseconds
+    void Log(const char* name);
+
+private:
+    std::vector<double> m_Samples;
+    bool m_Sorted = true;
+};
+}
+
+#endif // TIMINGSTATS_HPP
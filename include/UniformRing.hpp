@@ -0,0 +1,79 @@
+#ifndef UNIFORMRING_HPP
+#define UNIFORMRING_HPP
+
+#include <webgpu/webgpu.hpp>
+#include <cstdint>
+#include <memory>
+#include <vector>
+
+namespace atcp {
+/**
+ * Uniform buffer split into one region per frame in flight, each holding a fixed number of slots.
+ * A frame's uniforms are staged on the CPU and uploaded with a single writeBuffer, draws select their slot
+ * with a dynamic offset into one bind group covering the whole buffer.
+ */
+class UniformRing
+{
+public:
+	UniformRing() = default;
+	UniformRing(const UniformRing&) = delete;
+	UniformRing& operator=(const UniformRing&) = delete;
+	~UniformRing();
+
+	static uint64_t GetBufferSize(uint32_t frameCount, uint32_t slotsPerFrame, uint32_t slotSize, uint32_t alignment);
+
+	bool Init(wgpu::Device device, wgpu::Queue queue, uint32_t frameCount, uint32_t slotsPerFrame, uint32_t slotSize, uint32_t alignment);
+	// Waits for the GPU to finish with every frame
+	void Release();
+
+	// Start staging into the next frame's region, waiting if the GPU is still reading it
+	void BeginFrame();
+
+	/**
+	 * Copy 'size' bytes into the next free slot and return its dynamic offset, or UINT32_MAX when the frame is full.
+	 */
+	uint32_t Allocate(const void* data, uint32_t size);
+
+	template<typename T>
+	uint32_t Push(const T& value) { return Allocate(&value, static_cast<uint32_t>(sizeof(T))); }
+
+	// Upload the frame's uniforms, call before submitting the commands that use them
+	void Upload();
+	// Call once the frame's commands have been submitted
+	void EndFrame();
+
+	wgpu::Buffer GetBuffer() const { return m_Buffer; }
+	uint32_t GetSlotSize() const { return m_SlotSize; }
+	// Region being staged, the dynamic offset of a frame's n-th allocation only depends on this
+	uint32_t GetFrameIndex() const { return m_Frame; }
+
+	uint64_t GetBytesUploaded() const { return m_BytesUploaded; }
+	uint64_t GetStallCount() const { return m_StallCount; }
+	uint64_t GetOverflowCount() const { return m_OverflowCount; }
+
+private:
+	void WaitForFrame(uint32_t frame);
+
+	wgpu::Device m_Device = nullptr;
+	wgpu::Queue m_Queue = nullptr;
+	wgpu::Buffer m_Buffer = nullptr;
+
+	uint32_t m_FrameCount = 0;
+	uint32_t m_SlotsPerFrame = 0;
+	uint32_t m_SlotSize = 0;
+	uint32_t m_Stride = 0;
+
+	uint32_t m_Frame = 0;
+	uint32_t m_SlotCount = 0;
+	std::vector<unsigned char> m_Staging;
+	std::vector<char> m_InFlight;
+	std::vector<std::unique_ptr<wgpu::QueueWorkDoneCallback>> m_WorkDoneCallbacks;
+
+	// Bytes written by the last Upload
+	uint64_t m_BytesUploaded = 0;
+	uint64_t m_StallCount = 0;
+	uint64_t m_OverflowCount = 0;
+};
+}
+
+#endif // UNIFORMRING_HPP
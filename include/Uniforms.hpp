@@ -1,12 +1,31 @@
+#ifndef UNIFORMS_HPP
+#define UNIFORMS_HPP
+
 #include <array>
 
 namespace atcp
 {
 struct MyUniform {
     std::array<float, 4> colour;
+    // Dequantizes mesh positions: { scale.x, scale.y, offset.x, offset.y }
+    std::array<float, 4> positionTransform;
     float time;
     float _pad[3];
 
 };
 static_assert(sizeof(MyUniform) % 16 == 0, "Struct must be 16 byte aligned");
+
+// One per drawn instance in a storage buffer, indexed with @builtin(instance_index)
+struct InstanceData {
+    std::array<float, 2> offset;
+    float scale;
+    // Orbit angle is time * speed + phase, a negative speed orbits clockwise
+    float speed;
+    std::array<float, 4> colour;
+    float phase;
+    float _pad[3];
+};
+static_assert(sizeof(InstanceData) == 48, "Must match the storage buffer layout in shader.wgsl");
 } // namespace atcp
+
+#endif // UNIFORMS_HPP
@@ -0,0 +1,103 @@
+#ifndef UPLOADMANAGER_HPP
+#define UPLOADMANAGER_HPP
+
+#include <webgpu/webgpu.hpp>
+#include <cstdint>
+#include <memory>
+#include <vector>
+
+namespace atcp {
+struct UploadStats {
+	uint64_t bytesUploaded = 0;
+	uint64_t copyCount = 0;
+	uint64_t submitCount = 0;
+	// Seconds spent copying into staging memory and submitting, throughput is measured against this
+	double stagingTime = 0.0;
+	// Writes that found every staging buffer in use and waited for the GPU to return one
+	uint64_t stallCount = 0;
+	double stallTime = 0.0;
+	// Static buffers created with their contents mapped at creation
+	uint64_t staticBufferCount = 0;
+	uint64_t staticBytes = 0;
+};
+
+/**
+ * Copies data to GPU buffers through a ring of MapWrite staging buffers. Writes land straight in mapped staging
+ * memory and Submit turns every write since the last call into copyBufferToBuffer commands in one submission.
+ * Submitted staging buffers are mapped again with mapAsync, which completes once the GPU has finished the copies,
+ * and are written to again from then on. When every staging buffer is busy and the limit is reached a write
+ * waits for the GPU.
+ *
+ * Use CreateBuffer instead for data that is only ever written once.
+ */
+class UploadManager
+{
+public:
+	UploadManager() = default;
+	UploadManager(const UploadManager&) = delete;
+	UploadManager& operator=(const UploadManager&) = delete;
+	~UploadManager();
+
+	// Staging buffers are created on demand, up to 'maxBlocks' of 'blockSize' bytes
+	bool Init(wgpu::Device device, wgpu::Queue queue, uint64_t blockSize, uint32_t maxBlocks);
+	// Waits for the GPU to finish with every staging buffer
+	void Release();
+
+	/**
+	 * Stage 'size' bytes for 'destination' at 'offset', which must be a multiple of 4. The copy is rounded up to
+	 * a multiple of 4 bytes with zeros so 'destination' must be large enough to take the padding.
+	 */
+	bool Write(wgpu::Buffer destination, uint64_t offset, const void* data, uint64_t size);
+	// Submit the copies staged since the last call, call before submitting commands that read the destinations
+	void Submit();
+
+	// A buffer holding 'data' from the start, written through mappedAtCreation without any staging
+	wgpu::Buffer CreateBuffer(const char* label, WGPUBufferUsageFlags usage, const void* data, uint64_t size);
+
+	// Staging memory allocated, and the part of it holding data not yet copied by the GPU
+	uint64_t GetStagingSize() const { return m_Blocks.size() * m_BlockSize; }
+	uint64_t GetStagingInUse() const;
+	UploadStats GetStats() const { return m_Stats; }
+	void LogStats() const;
+
+private:
+	struct StagingBlock {
+		wgpu::Buffer buffer = nullptr;
+		// Null while the GPU may still be reading the buffer
+		unsigned char* data = nullptr;
+		// Bytes written since the buffer was last mapped
+		uint64_t used = 0;
+		// Waiting for the GPU to finish copying from it
+		bool mapping = false;
+		std::unique_ptr<wgpu::BufferMapCallback> mapCallback;
+	};
+
+	struct PendingCopy {
+		uint32_t block;
+		uint64_t sourceOffset;
+		wgpu::Buffer destination;
+		uint64_t destinationOffset;
+		uint64_t size;
+	};
+
+	// A mapped block with room for at least 4 bytes, waiting for one if they are all busy
+	StagingBlock* GetBlock();
+	bool CreateBlock();
+	// Wait for the device to make progress, false when it cannot be waited on from here
+	bool Poll();
+
+	wgpu::Device m_Device = nullptr;
+	wgpu::Queue m_Queue = nullptr;
+	uint64_t m_BlockSize = 0;
+	uint32_t m_MaxBlocks = 0;
+
+	// Unique pointers so the map callbacks can hold on to their block
+	std::vector<std::unique_ptr<StagingBlock>> m_Blocks;
+	uint32_t m_CurrentBlock = 0;
+	std::vector<PendingCopy> m_Copies;
+
+	UploadStats m_Stats;
+};
+}
+
+#endif // UPLOADMANAGER_HPP
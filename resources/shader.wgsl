@@ -1,9 +1,19 @@
 struct MyUniform {
 	color: vec4f,
+	positionTransform: vec4f,
 	time: f32,
 };
 
+struct InstanceData {
+	offset: vec2f,
+	scale: f32,
+	speed: f32,
+	color: vec4f,
+	phase: f32,
+};
+
 @group(0) @binding(0) var<uniform> uMyUniform: MyUniform;
+@group(0) @binding(1) var<storage, read> instances: array<InstanceData>;
 
 struct VertexInput {
 	@location(0) position: vec2f,
@@ -16,13 +26,17 @@ struct VertexOutput {
 }
 
 @vertex
-fn vs_main(in: VertexInput) -> VertexOutput {
-    var offset = vec2f(-0.0, -0.0);
-    offset += 0.3 * vec2f(cos(uMyUniform.time), sin(uMyUniform.time));
-    
+fn vs_main(in: VertexInput, @builtin(instance_index) instanceIndex: u32) -> VertexOutput {
+	let instance = instances[instanceIndex];
+	let angle = uMyUniform.time * instance.speed + instance.phase;
+	let offset = instance.offset + 0.3 * instance.scale * vec2f(cos(angle), sin(angle));
+
+	// Positions may be stored quantized, snorm and half floats decode through the per mesh scale and offset
+	let position = (in.position * uMyUniform.positionTransform.xy + uMyUniform.positionTransform.zw) * instance.scale;
+
 	var out: VertexOutput;
-	out.position = vec4f(in.position.x + offset.x, in.position.y + offset.y, 0.0, 1.0);
-	out.color = in.color;
+	out.position = vec4f(position.x + offset.x, position.y + offset.y, 0.0, 1.0);
+	out.color = in.color * instance.color.rgb;
 	return out;
 }
 